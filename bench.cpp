@@ -0,0 +1,864 @@
+﻿/*
+ | Cirno
+ | 文件名称: bench.cpp
+ | 文件作用: 性能测试(每个公开操作的耗时, 输出CSV或JSON)
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+  
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+// 用法: bench [--json] [--no-header] [--filter 子串] [--check]
+// --check不测性能, 而是检查量化格式的往返误差, 有超出上界的项时返回1
+// 每个操作对N组随机输入循环计算, 重复若干轮取最快的一轮, 输出:
+//   build      编译方式: scalar(不定义_MATHLIB_USE_SSE)或sse
+//   type, op   类型和操作
+//   kernel     批量操作使用的内核(运行时分派的级别), 单个值的操作为"-"
+//   ns_per_op  每个元素的耗时(纳秒), mops为每秒处理的元素个数(百万)
+//   cycles_per_op  每个元素的TSC周期数(rdtsc, 参考频率而非实际频率), 不支持时为0
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#define _MATHLIB_USE_PARALLEL                           // 并行批量运算的测试需要线程池
+#include "cirno/cirno.hpp"
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif // _MSC_VER
+
+using namespace cirno;
+
+namespace
+{
+    const size_t N = 1024;                                  // 每轮处理的元素个数(数据都在L1/L2缓存中)
+    const int Rounds = 7;                                   // 取最快的一轮
+    const double MinRoundNs = 2.0e6;                        // 每轮至少2ms
+
+#if defined(_MATHLIB_USE_SSE)
+    const char *BuildName = "sse";
+#else
+    const char *BuildName = "scalar";
+#endif // _MATHLIB_USE_SSE
+
+    struct Options
+    {
+        bool json = false;
+        bool header = true;
+        const char *filter = nullptr;
+        bool check = false;
+    } options;
+    bool first_record = true;
+
+    // 输出缓冲区, 保存每个结果, 防止编译器把计算优化掉
+    alignas(64) unsigned char sink[N][64];
+
+    template<class T>
+    inline void Keep(size_t i, const T &v)
+    {
+        static_assert(sizeof(T) <= 64, "result too large");
+        memcpy(sink[i], &v, sizeof(T));
+    }
+    inline uint64_t ReadTsc()
+    {
+    #if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #else
+        return 0;
+    #endif // _MSC_VER, __x86_64__, __i386__
+    }
+    float32 Random(float32 lo, float32 hi)
+    {
+        return lo + (hi - lo) * static_cast<float32>(rand()) / static_cast<float32>(RAND_MAX);
+    }
+    // 计时: body每次调用处理n个元素
+    void Run(const char *type, const char *op, const char *kernel, const std::function<void()> &body, size_t n = N)
+    {
+        char name[128];
+        snprintf(name, sizeof(name), "%s.%s", type, op);
+        if (options.filter != nullptr && strstr(name, options.filter) == nullptr)
+        {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        // 预热并确定每轮的调用次数
+        size_t calls = 1;
+        for (;;)
+        {
+            const auto t0 = Clock::now();
+            for (size_t k = 0; k < calls; k += 1)
+            {
+                body();
+            }
+            const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+            if (ns >= MinRoundNs || calls >= (1u << 24))
+            {
+                break;
+            }
+            calls *= 2;
+        }
+        double best_ns = 1e300;
+        double best_cycles = 1e300;
+        for (int r = 0; r < Rounds; r += 1)
+        {
+            const auto t0 = Clock::now();
+            const uint64_t c0 = ReadTsc();
+            for (size_t k = 0; k < calls; k += 1)
+            {
+                body();
+            }
+            const uint64_t c1 = ReadTsc();
+            const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+            if (ns < best_ns)
+            {
+                best_ns = ns;
+                best_cycles = static_cast<double>(c1 - c0);
+            }
+        }
+        const double ops = static_cast<double>(calls) * static_cast<double>(n);
+        const double ns_per_op = best_ns / ops;
+        const double mops = 1.0e3 / ns_per_op;
+        const double cycles_per_op = best_cycles / ops;
+        if (options.json)
+        {
+            printf("%s  {\"build\": \"%s\", \"type\": \"%s\", \"op\": \"%s\", \"kernel\": \"%s\", \"ns_per_op\": %.4f, \"mops\": %.2f, \"cycles_per_op\": %.3f}",
+                   first_record ? "" : ",\n", BuildName, type, op, kernel, ns_per_op, mops, cycles_per_op);
+        }
+        else {
+            printf("%s,%s,%s,%s,%.4f,%.2f,%.3f\n", BuildName, type, op, kernel, ns_per_op, mops, cycles_per_op);
+        }
+        first_record = false;
+        fflush(stdout);
+    }
+    // 单个值的操作
+    void RunScalar(const char *type, const char *op, const std::function<void()> &body)
+    {
+        Run(type, op, "-", body);
+    }
+    // 对每个可用的指令集级别各调用一次body(级别的名称)
+    void ForEachLevel(const std::function<void(const char *)> &body)
+    {
+        const SimdLevel detected = DetectSimdLevel();
+        for (uint32_t k = 0; k <= static_cast<uint32_t>(detected); k += 1)
+        {
+            const SimdLevel level = SetSimdLevel(static_cast<SimdLevel>(k));
+            if (level != static_cast<SimdLevel>(k))
+            {
+                continue;                                   // 不运行时分派时只有编译期确定的级别
+            }
+            body(SimdLevelName(level));
+        }
+        SetSimdLevel(detected);
+    }
+    // 批量操作, 对每个可用的指令集级别各测一次
+    void RunBatch(const char *type, const char *op, const std::function<void()> &body)
+    {
+        ForEachLevel([&](const char *level) { Run(type, op, level, body); });
+    }
+
+    // 输入数据
+    Vector2 v2a[N], v2b[N];
+    Vector3 v3a[N], v3b[N];
+    Vector4 v4a[N], v4b[N];
+    Quaternion qa[N], qb[N];
+    Matrix4 ma[N], mb[N], mrigid[N];
+    DualQuaternion dqa[N], dqb[N];
+    float32 fa[N];
+    // 蒙皮: 每个顶点4个骨骼, 骨骼从Bones个中随机选取
+    const size_t Bones = 64;
+    uint16_t joints[4 * N];
+    float32 weights[4 * N];
+
+    void InitData()
+    {
+        srand(9);
+        for (size_t i = 0; i < N; i += 1)
+        {
+            v2a[i] = Vector2(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+            v2b[i] = Vector2(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+            v3a[i] = Vector3(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+            v3b[i] = Vector3(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+            v4a[i] = Vector4(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(0.5f, 2.0f));
+            v4b[i] = Vector4(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(0.5f, 2.0f));
+            qa[i] = Quaternion(Random(-3.0f, 3.0f), v3a[i]);
+            qb[i] = Quaternion(Random(-3.0f, 3.0f), v3b[i]);
+            fa[i] = Random(0.0f, 1.0f);
+            for (int c = 0; c < 4; c += 1)
+            {
+                for (int r = 0; r < 4; r += 1)
+                {
+                    ma[i][c][r] = Random(-2.0f, 2.0f);
+                    mb[i][c][r] = Random(-2.0f, 2.0f);
+                }
+            }
+            mrigid[i] = Matrix4::TranslationTransform(v3a[i]) * Matrix4::RotateTransform(qa[i]);
+            dqa[i] = DualQuaternion(qa[i], v3a[i]);
+            dqb[i] = DualQuaternion(qb[i], v3b[i]);
+            float32 sum = 0.0f;
+            for (size_t j = 0; j < 4; j += 1)
+            {
+                joints[4 * i + j] = static_cast<uint16_t>(rand() % Bones);
+                weights[4 * i + j] = Random(0.0f, 1.0f);
+                sum += weights[4 * i + j];
+            }
+            for (size_t j = 0; j < 4; j += 1)
+            {
+                weights[4 * i + j] /= sum;
+            }
+        }
+    }
+
+// 单个值的操作: 对每个i计算expr并保存结果
+#define BENCH(type, op, expr)                                           \
+    RunScalar(type, op, [&]() {                                         \
+        for (size_t i = 0; i < N; i += 1)                               \
+        {                                                               \
+            Keep(i, expr);                                              \
+        }                                                               \
+    })
+
+    void BenchVector2()
+    {
+        BENCH("Vector2", "operator+", v2a[i] + v2b[i]);
+        BENCH("Vector2", "operator-", v2a[i] - v2b[i]);
+        BENCH("Vector2", "operator+=", Vector2(v2a[i]) += v2b[i]);
+        BENCH("Vector2", "operator*=", Vector2(v2a[i]) *= fa[i]);
+        BENCH("Vector2", "DotMul", v2a[i].DotMul(v2b[i]));
+        BENCH("Vector2", "Length", v2a[i].Length());
+        BENCH("Vector2", "GetNormalize", v2a[i].GetNormalize());
+    }
+    void BenchVector3()
+    {
+        BENCH("Vector3", "operator+", v3a[i] + v3b[i]);
+        BENCH("Vector3", "operator-", v3a[i] - v3b[i]);
+        BENCH("Vector3", "operator+=", Vector3(v3a[i]) += v3b[i]);
+        BENCH("Vector3", "operator*=", Vector3(v3a[i]) *= fa[i]);
+        BENCH("Vector3", "DotMul", v3a[i].DotMul(v3b[i]));
+        BENCH("Vector3", "DotMulV", v3a[i].DotMulV(v3b[i]));
+        BENCH("Vector3", "a + b * s", v3a[i] + v3b[i] * fa[i]);
+        BENCH("Vector3", "a + b * s (expr)", Vector3(expr::Lazy(v3a[i]) + expr::Lazy(v3b[i]) * fa[i]));
+        BENCH("Vector3", "CrossMul", v3a[i].CrossMul(v3b[i]));
+        BENCH("Vector3", "Length", v3a[i].Length());
+        BENCH("Vector3", "LengthV", v3a[i].LengthV());
+        BENCH("Vector3", "GetNormalize", v3a[i].GetNormalize());
+        BENCH("Vector3", "GetNormalize<Fast>", v3a[i].GetNormalize<precision::Fast>());
+        BENCH("Vector3", "GetNormalize<Exact>", v3a[i].GetNormalize<precision::Exact>());
+    }
+    void BenchVector4()
+    {
+        BENCH("Vector4", "operator+", v4a[i] + v4b[i]);
+        BENCH("Vector4", "operator-", v4a[i] - v4b[i]);
+        BENCH("Vector4", "operator+=", Vector4(v4a[i]) += v4b[i]);
+        BENCH("Vector4", "operator*=", Vector4(v4a[i]) *= fa[i]);
+        BENCH("Vector4", "DotMul", v4a[i].DotMul(v4b[i]));
+        BENCH("Vector4", "Length", v4a[i].Length());
+        BENCH("Vector4", "GetNormalize", v4a[i].GetNormalize());
+    }
+    void BenchQuaternion()
+    {
+        BENCH("Quaternion", "operator*", Quaternion(qa[i]) * qb[i]);
+        BENCH("Quaternion", "operator+", qa[i] + qb[i]);
+        BENCH("Quaternion", "GetConjugate", qa[i].GetConjugate());
+        BENCH("Quaternion", "GetInverse", qa[i].GetInverse());
+        BENCH("Quaternion", "GetInverse<Fast>", qa[i].GetInverse<precision::Fast>());
+        BENCH("Quaternion", "GetInverse<Exact>", qa[i].GetInverse<precision::Exact>());
+        BENCH("Quaternion", "RotateAxis", Quaternion::RotateAxis(fa[i], v3a[i]));
+        BENCH("Quaternion", "EulerAngle", Quaternion::EulerAngle(fa[i], v3a[i].X(), v3a[i].Y()));
+        BENCH("Quaternion", "Nlerp", Quaternion::Nlerp(qa[i], qb[i], fa[i]));
+        BENCH("Quaternion", "Slerp", Quaternion::Slerp(qa[i], qb[i], fa[i]));
+        BENCH("Quaternion", "Rotate", qa[i].Rotate(v3a[i]));
+        BENCH("Quaternion", "Rotate(via Matrix4)", Matrix4::RotateTransform(qa[i]) * v3a[i]);
+
+        static Quaternion out[N];
+        RunBatch("Quaternion", "Nlerp[]", [&]() { Quaternion::Nlerp(qa, qb, fa, out, N); });
+        RunBatch("Quaternion", "Slerp[]", [&]() { Quaternion::Slerp(qa, qb, fa, out, N); });
+        Vector3Stream sin(v3a, N), sout(N);
+        RunBatch("Quaternion", "Rotate(Vector3Stream)", [&]() { Quaternion::Rotate(qa, sin, sout); });
+    }
+    void BenchMatrix4()
+    {
+        BENCH("Matrix4", "operator*(Matrix4)", ma[i] * mb[i]);
+        BENCH("Matrix4", "AddTransform", ma[i].AddTransform(mb[i]));
+        BENCH("Matrix4", "operator*(Vector4)", ma[i] * v4a[i]);
+        BENCH("Matrix4", "operator*(Vector3)", Matrix4(mrigid[i]) * v3a[i]);
+        BENCH("Matrix4", "GetDeterminant", ma[i].GetDeterminant());
+        BENCH("Matrix4", "GetInverse", ma[i].GetInverse());
+        BENCH("Matrix4", "GetAffineInverse", mrigid[i].GetAffineInverse());
+        BENCH("Matrix4", "GetNormalMatrix", mrigid[i].GetNormalMatrix());
+        BENCH("Matrix4", "GetTransposition", ma[i].GetTransposition());
+        BENCH("Matrix4", "RotateTransform", Matrix4::RotateTransform(qa[i]));
+        BENCH("Matrix4", "FromTRS", Matrix4::FromTRS(v3a[i], qa[i], v3b[i]));
+        BENCH("Matrix4", "SetTRS", Matrix4(ma[i]).SetTRS(v3a[i], qa[i], v3b[i]));
+        BENCH("Matrix4", "FromTRS(via T * R * S)", Matrix4::TranslationTransform(v3a[i]) * Matrix4::RotateTransform(qa[i]) * Matrix4::ScaleTransform(fa[i]));
+        RunScalar("Matrix4", "Decompose", [&]() {
+            Vector3 t, s;
+            Quaternion r;
+            for (size_t i = 0; i < N; i += 1)
+            {
+                mrigid[i].Decompose(t, r, s);
+                Keep(i, r);
+            }
+        });
+        BENCH("Matrix4", "PerspectiveProject", Matrix4::PerspectiveProject(fa[i] + 0.5f, 1.5f, 0.1f, 100.0f));
+        BENCH("Matrix4", "LookAt", Matrix4::LookAt(v3a[i], v3b[i], Vector3(0.0f, 1.0f, 0.0f)));
+
+        static Matrix4 mout[N];
+        static Vector3 vout[N];
+        static Vector4 v4out[N];
+        RunBatch("Matrix4", "Multiply[]", [&]() { Matrix4::Multiply(ma, mb, mout, N); });
+        RunBatch("Matrix4", "Inverse[]", [&]() { Matrix4::Inverse(ma, mout, N); });
+        RunBatch("Matrix4", "AffineInverse[]", [&]() { Matrix4::AffineInverse(mrigid, mout, N); });
+        RunBatch("Matrix4", "NormalMatrix[]", [&]() { Matrix4::NormalMatrix(mrigid, mout, N); });
+        RunBatch("Matrix4", "RotateTransform[]", [&]() { Matrix4::RotateTransform(qa, mout, N); });
+        Vector3Stream tin(v3a, N), scin(v3b, N);
+        RunBatch("Matrix4", "FromTRS[]", [&]() { Matrix4::FromTRS(tin, qa, scin, mout); });
+        static Quaternion qout[N];
+        Vector3Stream tout, scout;
+        RunBatch("Matrix4", "Decompose[]", [&]() { Matrix4::Decompose(mrigid, tout, qout, scout, N); });
+        RunBatch("Matrix4", "TransformPoints[]", [&]() { mrigid[0].TransformPoints(v3a, vout, N); });
+        RunBatch("Matrix4", "TransformHomogeneous[]", [&]() { ma[0].TransformHomogeneous(v4a, v4out, N); });
+        Vector3Stream sin(v3a, N), sout(N);
+        RunBatch("Matrix4", "TransformPoints(Vector3Stream)", [&]() { mrigid[0].TransformPoints(sin, sout); });
+    }
+    void BenchDouble()
+    {
+        static Vector3d pd[N];
+        static Quaterniond qd[N];
+        static Matrix4d md[N];
+        const Vector3d eye(1.0e8, -2.0e8, 3.0e7);               // 远离原点的摄像机
+        for (size_t i = 0; i < N; i += 1)
+        {
+            pd[i] = Vector3d(v3a[i]) + eye;
+            qd[i] = Quaterniond(qa[i]);
+            md[i] = Matrix4d::FromTRS(pd[i], qd[i], Vector3d(1.0));
+        }
+        BENCH("Vector3d", "CrossMul", pd[i].CrossMul(pd[N - 1 - i]));
+        BENCH("Vector3d", "ToVector3(origin)", pd[i].ToVector3(eye));
+        BENCH("Quaterniond", "operator*", qd[i] * qd[N - 1 - i]);
+        BENCH("Quaterniond", "Rotate", qd[i].Rotate(pd[i]));
+        BENCH("Matrix4d", "operator*", (md[i] * md[N - 1 - i]).GetTranslation());
+        BENCH("Matrix4d", "TransformPoint", md[i].TransformPoint(pd[N - 1 - i]));
+        BENCH("Matrix4d", "GetAffineInverse", md[i].GetAffineInverse().GetTranslation());
+        RunScalar("Matrix4d", "ToMatrix4(origin)", [&]() {
+            for (size_t i = 0; i < N; i += 1)
+            {
+                const Matrix4 m = md[i].ToMatrix4(eye);
+                Keep(i, m);
+            }
+        });
+
+        static Vector3 vout[N];
+        static Matrix4 mout[N];
+        RunBatch("Vector3d", "CameraRelative[]", [&]() { Vector3d::CameraRelative(pd, eye, vout, N); });
+        RunBatch("Matrix4d", "CameraRelative[]", [&]() { Matrix4d::CameraRelative(md, eye, mout, N); });
+    }
+    void BenchDualQuaternion()
+    {
+        BENCH("DualQuaternion", "operator*", dqa[i] * dqb[i]);
+        BENCH("DualQuaternion", "GetNormalize", dqa[i].GetNormalize());
+        BENCH("DualQuaternion", "TransformPoint", dqa[i].TransformPoint(v3b[i]));
+        BENCH("DualQuaternion", "GetMatrix", dqa[i].GetMatrix());
+        BENCH("DualQuaternion", "Blend(4)", DualQuaternion::Blend(dqa + (i & ~size_t(3)), weights + 4 * i, 4));
+
+        Vector3Stream pos(v3a, N), nrm(v3b, N), out_pos, out_nrm;
+        RunBatch("DualQuaternion", "Skin[]", [&]() { DualQuaternion::Skin(dqa, joints, weights, pos, out_pos); });
+        RunBatch("DualQuaternion", "Skin[](with normals)", [&]() { DualQuaternion::Skin(dqa, joints, weights, pos, nrm, out_pos, out_nrm); });
+    }
+    void BenchSkinning()
+    {
+        static float32 vb[8 * N];                           // 位置 + 法线 + 纹理坐标
+        RunScalar("LinearBlendSkinning", "Skin(via Matrix4 * Vector4)", [&]() {
+            for (size_t i = 0; i < N; i += 1)
+            {
+                const Vector4 p(v3a[i].X(), v3a[i].Y(), v3a[i].Z(), 1.0f);
+                Vector4 r = mrigid[joints[4 * i]] * p * weights[4 * i];
+                r += mrigid[joints[4 * i + 1]] * p * weights[4 * i + 1];
+                r += mrigid[joints[4 * i + 2]] * p * weights[4 * i + 2];
+                r += mrigid[joints[4 * i + 3]] * p * weights[4 * i + 3];
+                memcpy(vb + 8 * i, r.GetPtr(), 3 * sizeof(float32));
+            }
+        });
+        Vector3Stream pos(v3a, N), nrm(v3b, N);
+        const SkinVertexBuffer out = { vb, vb + 3, 8 };
+        const SkinVertexBuffer out_pos = { vb, nullptr, 8 };
+        RunBatch("LinearBlendSkinning", "Skin[]", [&]() { LinearBlendSkinning::Skin(mrigid, joints, weights, pos, out_pos, 1); });
+        RunBatch("LinearBlendSkinning", "Skin[](with normals)", [&]() { LinearBlendSkinning::Skin(mrigid, joints, weights, pos, nrm, out, 1); });
+    }
+    void BenchHierarchy()
+    {
+        // 前4个节点是根节点, 其余节点的父节点从它之前的节点中随机选取; 每次修改所有的本地矩阵后再计算世界矩阵
+        static uint32_t parents[N];
+        TransformHierarchy h;
+        h.Reserve(N);
+        for (size_t i = 0; i < N; i += 1)
+        {
+            parents[i] = i < 4 ? TransformHierarchy::NoParent : static_cast<uint32_t>(rand() % i);
+            h.AddNode(parents[i], mrigid[i]);
+        }
+        static Matrix4 world[N];
+        RunScalar("TransformHierarchy", "Update(via Matrix4 * Matrix4)", [&]() {
+            for (size_t i = 0; i < N; i += 1)                   // 父节点的编号较小, 按编号顺序计算即可
+            {
+                world[i] = parents[i] == TransformHierarchy::NoParent ? mrigid[i] : world[parents[i]] * mrigid[i];
+            }
+            Keep(0, world[N - 1]);
+        });
+        RunBatch("TransformHierarchy", "Update", [&]() {
+            for (size_t i = 0; i < N; i += 1)
+            {
+                h.SetLocal(static_cast<TransformHierarchy::NodeId>(i), mrigid[i]);
+            }
+            h.Update(1);
+        });
+        Keep(0, h.GetWorld(static_cast<TransformHierarchy::NodeId>(N - 1)));
+    }
+    void BenchPacked()
+    {
+        BENCH("HalfVector3", "Encode", HalfVector3::Encode(v3a[i]));
+        BENCH("OctNormal", "Encode", OctNormal::Encode(v3b[i]));
+        BENCH("PackedQuaternion48", "Encode", PackedQuaternion48::Encode(qa[i]));
+
+        static HalfVector3 half[N];
+        static OctNormal oct[N];
+        static Packed1010102 p1010102[N];
+        static PackedQuaternion48 q48[N];
+        static PackedQuaternion64 q64[N];
+        static Vector3 vout[N];
+        static Quaternion qout[N];
+        RunBatch("HalfVector3", "Encode[]", [&]() { HalfVector3::Encode(v3a, half, N); });
+        RunBatch("HalfVector3", "Decode[]", [&]() { HalfVector3::Decode(half, vout, N); });
+        RunBatch("OctNormal", "Encode[]", [&]() { OctNormal::Encode(v3b, oct, N); });
+        RunBatch("OctNormal", "Decode[]", [&]() { OctNormal::Decode(oct, vout, N); });
+        RunBatch("Packed1010102", "Encode[]", [&]() { Packed1010102::Encode(v3b, p1010102, N); });
+        RunBatch("Packed1010102", "Decode[]", [&]() { Packed1010102::Decode(p1010102, vout, N); });
+        RunBatch("PackedQuaternion48", "Encode[]", [&]() { PackedQuaternion48::Encode(qa, q48, N); });
+        RunBatch("PackedQuaternion48", "Decode[]", [&]() { PackedQuaternion48::Decode(q48, qout, N); });
+        RunBatch("PackedQuaternion64", "Encode[]", [&]() { PackedQuaternion64::Encode(qa, q64, N); });
+        RunBatch("PackedQuaternion64", "Decode[]", [&]() { PackedQuaternion64::Decode(q64, qout, N); });
+    }
+    void BenchVector3Stream()
+    {
+        Vector3Stream a(v3a, N), b(v3b, N), r(N);
+        static float32 out[N];
+        RunBatch("Vector3Stream", "operator+=", [&]() { r += a; });
+        RunBatch("Vector3Stream", "a + b * s - a", [&]() { r = b; r *= 0.5f; r += a; r -= a; });
+        RunBatch("Vector3Stream", "a + b * s - a (expr)", [&]() { expr::Assign(r, expr::Lazy(a) + expr::Lazy(b) * 0.5f - a); });
+        RunBatch("Vector3Stream", "DotMul", [&]() { a.DotMul(b, out); });
+        RunBatch("Vector3Stream", "CrossMul", [&]() { a.CrossMul(b, r); });
+        RunBatch("Vector3Stream", "SetNormalize", [&]() { r = a; r.SetNormalize(); });
+        RunBatch("Vector3Stream", "SetNormalize<Fast>", [&]() { r = a; r.SetNormalize<precision::Fast>(); });
+        RunBatch("Vector3Stream", "SetNormalize<Exact>", [&]() { r = a; r.SetNormalize<precision::Exact>(); });
+    }
+    // 矩形: 单个值的操作, SoA批量运算和网格查询
+    void BenchRect()
+    {
+        static RectF ra[N], rb[N];
+        for (size_t i = 0; i < N; i += 1)
+        {
+            ra[i] = RectF(v2a[i].X(), v2a[i].X() + fa[i] * 4.0f, v2a[i].Y(), v2a[i].Y() + fa[i] * 4.0f);
+            rb[i] = RectF(v2b[i].X(), v2b[i].X() + 3.0f, v2b[i].Y(), v2b[i].Y() + 3.0f);
+        }
+        BENCH("RectF", "Intersects", ra[i].Intersects(rb[i]));
+        BENCH("RectF", "GetIntersection", ra[i].GetIntersection(rb[i]));
+        BENCH("RectF", "GetUnion", ra[i].GetUnion(rb[i]));
+
+        RectFStream stream(ra, N), clipped(N);
+        static uint32_t hits[N];
+        const RectF query(-2.0f, 2.0f, -2.0f, 2.0f);
+        RunBatch("RectFStream", "Overlaps", [&]() { Keep(0, stream.Overlaps(query, hits)); });
+        RunBatch("RectFStream", "ContainPoint", [&]() { Keep(0, stream.ContainPoint(0.5f, 0.5f, hits)); });
+        RunBatch("RectFStream", "Clip", [&]() { clipped = stream; clipped.Clip(query); });
+        RunBatch("RectFStream", "Bounds", [&]() { Keep(0, stream.Bounds()); });
+        // 网格: 10万个小矩形, 每次查询一个约占1/2500面积的矩形
+        const size_t GridN = 100000;
+        std::vector<RectF> rects(GridN);
+        for (size_t i = 0; i < GridN; i += 1)
+        {
+            const float32 x = Random(0.0f, 1000.0f), y = Random(0.0f, 1000.0f);
+            rects[i] = RectF(x, x + Random(0.5f, 4.0f), y, y + Random(0.5f, 4.0f));
+        }
+        RectGrid grid;
+        std::vector<uint32_t> found;
+        Run("RectGrid", "Build(100000)", "-", [&]() { grid.Build(rects.data(), GridN); }, GridN);
+        RunBatch("RectGrid", "Query", [&]() {
+            for (size_t i = 0; i < N; i += 1)
+            {
+                const float32 x = v2a[i].X() * 50.0f + 500.0f, y = v2a[i].Y() * 50.0f + 500.0f;
+                found.clear();
+                Keep(i, grid.Query(RectF(x, x + 20.0f, y, y + 20.0f), found));
+            }
+        });
+    }
+    // 并行批量操作的扩展性: 数据较大(超出L2缓存), 线程数从1开始每次翻倍, 直到所有硬件线程
+    void BenchParallel()
+    {
+        const size_t BigN = 1 << 18;
+        AlignedVector<Vector3> points(BigN);
+        AlignedVector<Matrix4> ms(BigN), mout(BigN);
+        for (size_t i = 0; i < BigN; i += 1)
+        {
+            points[i] = v3a[i % N];
+            ms[i] = ma[i % N];
+        }
+        Vector3Stream sin(points.data(), BigN), sout(BigN);
+        AlignedVector<Vector3> vout(BigN);
+        const char *level = SimdLevelName(GetSimdLevel());
+        size_t hw = std::thread::hardware_concurrency();
+        hw = hw == 0 ? 1 : hw;
+        if (hw == 1)
+        {
+            fprintf(stderr, "only 1 hardware thread: Parallel rows show the pool overhead, not the scaling\n");
+        }
+        for (size_t threads = 1; ; threads = threads * 2 < hw ? threads * 2 : hw)
+        {
+            ThreadPool pool(threads);
+            char op[64];
+            snprintf(op, sizeof(op), "TransformPoints(Vector3Stream, %zu threads)", threads);
+            Run("Parallel", op, level, [&]() { mrigid[0].TransformPoints(pool, sin, sout); }, BigN);
+            snprintf(op, sizeof(op), "TransformPoints[](%zu threads)", threads);
+            Run("Parallel", op, level, [&]() { mrigid[0].TransformPoints(pool, points.data(), vout.data(), BigN); }, BigN);
+            snprintf(op, sizeof(op), "Multiply[](%zu threads)", threads);
+            Run("Parallel", op, level, [&]() { Matrix4::Multiply(pool, ms.data(), ms.data(), mout.data(), BigN); }, BigN);
+            snprintf(op, sizeof(op), "Inverse[](%zu threads)", threads);
+            Run("Parallel", op, level, [&]() { Matrix4::Inverse(pool, ms.data(), mout.data(), BigN); }, BigN);
+            if (threads == hw)
+            {
+                break;
+            }
+        }
+    }
+#undef BENCH
+
+    // --check: 量化格式的往返误差不超过packed.hpp中注释给出的上界
+    // 单个值的Encode/Decode(kernel为"-")和每个指令集级别的批量版本都检查, 输出每项的最大误差
+    int check_failed = 0;
+
+    void Expect(const char *type, const char *metric, const char *kernel, double err, double bound)
+    {
+        const bool ok = err <= bound;
+        printf("%s,%s,%s,%s,%.4g,%.4g,%s\n", BuildName, type, metric, kernel, err, bound, ok ? "ok" : "FAIL");
+        check_failed += ok ? 0 : 1;
+    }
+    // 随机单位向量, 包括坐标轴和对角线方向
+    void RandomDirections(AlignedVector<Vector3> &v, size_t n)
+    {
+        v.clear();
+        const float32 s = 0.57735027f;
+        const Vector3 fixed[] = {
+            Vector3(1.0f, 0.0f, 0.0f), Vector3(-1.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f),
+            Vector3(0.0f, -1.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, -1.0f),
+            Vector3(s, s, s), Vector3(-s, s, -s), Vector3(s, -s, -s), Vector3(-s, -s, -s),
+        };
+        v.assign(fixed, fixed + sizeof(fixed) / sizeof(fixed[0]));
+        while (v.size() < n)
+        {
+            const double x = Random(-1.0f, 1.0f), y = Random(-1.0f, 1.0f), z = Random(-1.0f, 1.0f);
+            const double len = sqrt(x * x + y * y + z * z);
+            if (len > 1e-3 && len <= 1.0)
+            {
+                v.push_back(Vector3(static_cast<float32>(x / len), static_cast<float32>(y / len), static_cast<float32>(z / len)));
+            }
+        }
+    }
+    // 随机单位四元数, 包括单位元和只有两个非零分量的; 一半的分量都接近±1/2, 这时由单位长度求得的分量误差最大
+    void RandomQuaternions(AlignedVector<Quaternion> &q, size_t n)
+    {
+        q.clear();
+        const float32 s = 0.70710678f;
+        const Quaternion fixed[] = {
+            Quaternion(1.0f, 0.0f, 0.0f, 0.0f), Quaternion(0.0f, 0.0f, 0.0f, -1.0f),
+            Quaternion(s, s, 0.0f, 0.0f), Quaternion(0.0f, -s, 0.0f, s), Quaternion(0.5f, -0.5f, 0.5f, -0.5f),
+        };
+        q.assign(fixed, fixed + sizeof(fixed) / sizeof(fixed[0]));
+        while (q.size() < n)
+        {
+            double e[4], len = 0.0;
+            for (int k = 0; k < 4; k += 1)
+            {
+                e[k] = q.size() % 2 == 0 ? Random(-1.0f, 1.0f) : Random(0.49f, 0.51f) * (rand() % 2 == 0 ? 1.0f : -1.0f);
+                len += e[k] * e[k];
+            }
+            len = sqrt(len);
+            if (len > 1e-3 && len <= 1.0)
+            {
+                q.push_back(Quaternion(static_cast<float32>(e[0] / len), static_cast<float32>(e[1] / len),
+                                       static_cast<float32>(e[2] / len), static_cast<float32>(e[3] / len)));
+            }
+        }
+    }
+    // 两个方向的夹角(弧度)
+    double Angle(const Vector3 a, const Vector3 b)
+    {
+        const double ax = a.X(), ay = a.Y(), az = a.Z(), bx = b.X(), by = b.Y(), bz = b.Z();
+        const double cx = ay * bz - az * by, cy = az * bx - ax * bz, cz = ax * by - ay * bx;
+        return atan2(sqrt(cx * cx + cy * cy + cz * cz), ax * bx + ay * by + az * bz);
+    }
+    // 四元数的往返误差: 存储的三个分量, 由单位长度求得的分量(原来绝对值最大的), 旋转角(度)
+    void QuaternionError(const Quaternion *in, const Quaternion *out, size_t n, double *err)
+    {
+        err[0] = err[1] = err[2] = 0.0;
+        for (size_t i = 0; i < n; i += 1)
+        {
+            const float32 *a = in[i].GetPtr(), *b = out[i].GetPtr();
+            double dot = 0.0;
+            size_t big = 0;
+            for (size_t k = 0; k < 4; k += 1)
+            {
+                dot += static_cast<double>(a[k]) * b[k];
+                big = fabsf(a[big]) < fabsf(a[k]) ? k : big;
+            }
+            const double sign = dot < 0.0 ? -1.0 : 1.0;         // q与-q表示同一个旋转
+            double cross = 0.0;
+            for (size_t k = 0; k < 4; k += 1)
+            {
+                const double d = fabs(a[k] - sign * b[k]);
+                err[k == big ? 1 : 0] = d > err[k == big ? 1 : 0] ? d : err[k == big ? 1 : 0];
+                cross += d * d;
+            }
+            // 两个单位四元数的距离为|a - b| = 2sin(θ/4), θ为相对旋转的角度
+            const double angle = 4.0 * asin(sqrt(cross) / 2.0 < 1.0 ? sqrt(cross) / 2.0 : 1.0) * 180.0 / 3.14159265358979;
+            err[2] = angle > err[2] ? angle : err[2];
+        }
+    }
+    int CheckPacked()
+    {
+        const size_t M = 1 << 16;
+        srand(7);
+        AlignedVector<Vector3> dirs, vout(M);
+        RandomDirections(dirs, M);
+        AlignedVector<Quaternion> quats, qout(M);
+        RandomQuaternions(quats, M);
+        // 下面的上界都由量化步长推导, 不是按本机测得的最大值拟合的: 量化误差不超过半个步长,
+        // 再加上编码和解码时几次float32舍入的误差(每次不超过eps乘以参与运算的数的绝对值, 数都不超过1)
+        const double eps = ldexp(1.0, -24);                 // float32的单位舍入误差
+        // 半精度: 正规数范围内的相对误差, 非规格化数范围内的绝对误差
+        AlignedVector<Vector3> values(M);
+        for (size_t i = 0; i < M; i += 1)
+        {
+            float32 e[3];
+            for (int k = 0; k < 3; k += 1)
+            {
+                e[k] = ldexpf(Random(1.0f, 2.0f), static_cast<int>(Random(-26.0f, 15.0f))) * (rand() % 2 == 0 ? 1.0f : -1.0f);
+                e[k] = fabsf(e[k]) < 65504.0f ? e[k] : 65504.0f;
+            }
+            values[i] = Vector3(e[0], e[1], e[2]);
+        }
+        std::vector<HalfVector3> half(M);
+        auto half_error = [&](const char *kernel) {
+            double rel = 0.0, abs_err = 0.0;
+            for (size_t i = 0; i < M; i += 1)
+            {
+                const float32 a[3] = { values[i].X(), values[i].Y(), values[i].Z() }, b[3] = { vout[i].X(), vout[i].Y(), vout[i].Z() };
+                for (int k = 0; k < 3; k += 1)
+                {
+                    const double d = fabs(static_cast<double>(a[k]) - b[k]);
+                    if (fabsf(a[k]) >= 6.1035156e-5f)
+                    {
+                        rel = d / fabsf(a[k]) > rel ? d / fabsf(a[k]) : rel;
+                    }
+                    else {
+                        abs_err = d > abs_err ? d : abs_err;
+                    }
+                }
+            }
+            // 11位有效位, 就近舍入的相对误差不超过2^-11; 非规格化数的步长是2^-24, 绝对误差不超过一半; 解包是精确的
+            Expect("HalfVector3", "relative", kernel, rel, ldexp(1.0, -11));
+            Expect("HalfVector3", "subnormal absolute", kernel, abs_err, ldexp(1.0, -25));
+        };
+        for (size_t i = 0; i < M; i += 1)
+        {
+            vout[i] = HalfVector3::Encode(values[i]).Decode();
+        }
+        half_error("-");
+        ForEachLevel([&](const char *level) {
+            HalfVector3::Encode(values.data(), half.data(), M);
+            HalfVector3::Decode(half.data(), vout.data(), M);
+            half_error(level);
+        });
+        // 八面体映射: 夹角
+        // u, v是snorm16(步长1 / 32767), 每个的误差h不超过半个步长加上投影时的舍入; 八面体上的点p = (u, v, 1 - |u| - |v|)
+        // 移动|dp| <= √6 h, 而|p| >= 1 / √3, 所以夹角不超过√18 h = 3√2 h弧度, 再加上解包后归一化的舍入
+        const double oct_h = 0.5 / 32767.0 + 4.0 * eps;
+        const double oct_bound = 3.0 * sqrt(2.0) * oct_h + 4.0 * eps;
+        std::vector<OctNormal> oct(M);
+        auto oct_error = [&](const char *kernel) {
+            double angle = 0.0;
+            for (size_t i = 0; i < M; i += 1)
+            {
+                const double a = Angle(dirs[i], vout[i]);
+                angle = a > angle ? a : angle;
+            }
+            Expect("OctNormal", "angle (rad)", kernel, angle, oct_bound);
+        };
+        for (size_t i = 0; i < M; i += 1)
+        {
+            vout[i] = OctNormal::Encode(dirs[i]).Decode();
+        }
+        oct_error("-");
+        ForEachLevel([&](const char *level) {
+            OctNormal::Encode(dirs.data(), oct.data(), M);
+            OctNormal::Decode(oct.data(), vout.data(), M);
+            oct_error(level);
+        });
+        // 10:10:10:2: 每个分量的绝对误差, w(-1, 0, 1)无损
+        // 10位snorm的步长是1 / 511, 误差不超过半个步长, 加上编码(乘以511)和解码(乘以1 / 511)的舍入
+        const double p1010102_bound = 0.5 / 511.0 + 4.0 * eps;
+        std::vector<Packed1010102> p1010102(M);
+        AlignedVector<Vector4> dirs4(M), vout4(M);
+        for (size_t i = 0; i < M; i += 1)
+        {
+            dirs4[i] = Vector4(dirs[i].X(), dirs[i].Y(), dirs[i].Z(), static_cast<float32>(static_cast<int>(i % 3) - 1));
+        }
+        auto p1010102_error = [&](const char *kernel) {
+            double comp = 0.0, w = 0.0;
+            for (size_t i = 0; i < M; i += 1)
+            {
+                const float32 *a = dirs4[i].GetPtr(), *b = vout4[i].GetPtr();
+                for (int k = 0; k < 3; k += 1)
+                {
+                    comp = fabs(static_cast<double>(a[k]) - b[k]) > comp ? fabs(static_cast<double>(a[k]) - b[k]) : comp;
+                }
+                w = fabsf(a[3] - b[3]) > w ? fabsf(a[3] - b[3]) : w;
+            }
+            Expect("Packed1010102", "component", kernel, comp, p1010102_bound);
+            Expect("Packed1010102", "w", kernel, w, 0.0);
+        };
+        for (size_t i = 0; i < M; i += 1)
+        {
+            const Packed1010102 p = Packed1010102::Encode(dirs[i], dirs4[i].W());
+            const Vector3 v = p.Decode();
+            vout4[i] = Vector4(v.X(), v.Y(), v.Z(), p.W());
+        }
+        p1010102_error("-");
+        ForEachLevel([&](const char *level) {
+            Packed1010102::Encode(dirs4.data(), p1010102.data(), M);
+            Packed1010102::Decode(p1010102.data(), vout4.data(), M);
+            p1010102_error(level);
+        });
+        // 最小三分量四元数, scale是snorm的最大整数(15位: 16383, 20位: 524287)
+        // 存储的分量在[-1/√2, 1/√2]内, 步长(1/√2) / scale, 误差d不超过半个步长, 加上编码(乘以√2和scale)与解码(乘以(1/√2) / scale)的舍入;
+        // 求得的分量w = sqrt(1 - Σf^2)是最大的(w >= |f_i|, w >= 1/2), |dw| <= Σ|f_i|d / w <= 3d, 再加上1 - Σf^2和sqrt的舍入;
+        // 两个四元数的距离不超过sqrt(3d^2 + (3d)^2) = √12 d, 旋转角θ = 4asin(距离 / 2)
+        auto quaternion_error = [&](const char *type, const char *kernel, double scale) {
+            const double stored = sqrt(0.5) / (2.0 * scale) + 8.0 * sqrt(0.5) * eps;
+            const double derived = 3.0 * stored + 6.0 * eps;
+            const double angle = 4.0 * asin(sqrt(12.0) * stored / 2.0) * 180.0 / 3.14159265358979;
+            double err[3];
+            QuaternionError(quats.data(), qout.data(), M, err);
+            Expect(type, "stored component", kernel, err[0], stored);
+            Expect(type, "derived component", kernel, err[1], derived);
+            Expect(type, "angle (deg)", kernel, err[2], angle);
+        };
+        std::vector<PackedQuaternion48> q48(M);
+        for (size_t i = 0; i < M; i += 1)
+        {
+            qout[i] = PackedQuaternion48::Encode(quats[i]).Decode();
+        }
+        quaternion_error("PackedQuaternion48", "-", 16383.0);
+        ForEachLevel([&](const char *level) {
+            PackedQuaternion48::Encode(quats.data(), q48.data(), M);
+            PackedQuaternion48::Decode(q48.data(), qout.data(), M);
+            quaternion_error("PackedQuaternion48", level, 16383.0);
+        });
+        std::vector<PackedQuaternion64> q64(M);
+        for (size_t i = 0; i < M; i += 1)
+        {
+            qout[i] = PackedQuaternion64::Encode(quats[i]).Decode();
+        }
+        quaternion_error("PackedQuaternion64", "-", 524287.0);
+        ForEachLevel([&](const char *level) {
+            PackedQuaternion64::Encode(quats.data(), q64.data(), M);
+            PackedQuaternion64::Decode(q64.data(), qout.data(), M);
+            quaternion_error("PackedQuaternion64", level, 524287.0);
+        });
+        return check_failed;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i += 1)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            options.json = true;
+        }
+        else if (strcmp(argv[i], "--no-header") == 0)
+        {
+            options.header = false;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            options.filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            options.check = true;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--json] [--no-header] [--filter substring] [--check]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.check)
+    {
+        if (options.header)
+        {
+            printf("build,type,metric,kernel,max_error,bound,result\n");
+        }
+        return CheckPacked() == 0 ? 0 : 1;
+    }
+    InitData();
+    if (options.json)
+    {
+        printf("[\n");
+    }
+    else if (options.header)
+    {
+        printf("build,type,op,kernel,ns_per_op,mops,cycles_per_op\n");
+    }
+    BenchVector2();
+    BenchVector3();
+    BenchVector4();
+    BenchQuaternion();
+    BenchMatrix4();
+    BenchDouble();
+    BenchDualQuaternion();
+    BenchSkinning();
+    BenchHierarchy();
+    BenchPacked();
+    BenchVector3Stream();
+    BenchRect();
+    BenchParallel();
+    if (options.json)
+    {
+        printf("\n]\n");
+    }
+    unsigned int check = 0;                                 // 读一次输出缓冲区, 确保结果被使用
+    for (size_t i = 0; i < N; i += 1)
+    {
+        check += sink[i][0];
+    }
+    fprintf(stderr, "checksum %u\n", check);
+    return 0;
+}
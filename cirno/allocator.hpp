@@ -0,0 +1,234 @@
+﻿/*
+ | Cirno
+ | 文件名称: allocator.hpp
+ | 文件作用: 对齐的内存分配: STL分配器与每帧重置的线性分配器
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 分配按align字节对齐的内存(align是2的幂), 失败时返回nullptr, 用AlignedFree释放
+    inline void* AlignedAlloc(size_t bytes, size_t align) noexcept
+    {
+        assert(align != 0 && (align & (align - 1)) == 0);
+        align = align < sizeof(void*) ? sizeof(void*) : align;     // posix_memalign要求至少是指针大小
+        bytes = bytes == 0 ? align : bytes;
+    #if defined(_MSC_VER)
+        return _aligned_malloc(bytes, align);
+    #else
+        void *p = nullptr;
+        if (posix_memalign(&p, align, bytes) != 0)
+        {
+            return nullptr;
+        }
+        return p;
+    #endif // _MSC_VER
+    }
+    // 释放AlignedAlloc分配的内存, p可以是nullptr
+    inline void AlignedFree(void *p) noexcept
+    {
+    #if defined(_MSC_VER)
+        _aligned_free(p);
+    #else
+        free(p);
+    #endif // _MSC_VER
+    }
+
+    // 对齐的STL分配器, 默认按64字节(缓存行)对齐, 例如std::vector<Matrix4, AlignedAllocator<Matrix4>>
+    // C++17之前operator new只保证alignof(max_align_t)(32位平台上通常是8), 直接用std::vector存放Vector4等类型可能不对齐
+    template<class T, size_t Align = 64>
+    class AlignedAllocator
+    {
+    public:
+        static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0, "Align must be a power of 2 and at least alignof(T)");
+        using value_type = T;
+        template<class U>
+        struct rebind
+        {
+            using other = AlignedAllocator<U, Align>;
+        };
+
+        AlignedAllocator() noexcept
+        {
+            // nothing to do
+        }
+        template<class U>
+        AlignedAllocator(const AlignedAllocator<U, Align> &) noexcept
+        {
+            // nothing to do
+        }
+        // 分配n个元素的空间, 失败时抛出std::bad_alloc(STL的要求)
+        T* allocate(size_t n)
+        {
+            if (n > static_cast<size_t>(-1) / sizeof(T))
+            {
+                throw std::bad_alloc();
+            }
+            void *p = AlignedAlloc(n * sizeof(T), Align);
+            if (p == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(p);
+        }
+        void deallocate(T *p, size_t) noexcept
+        {
+            AlignedFree(p);
+        }
+    };
+    template<class T, class U, size_t Align>
+    inline bool operator==(const AlignedAllocator<T, Align> &, const AlignedAllocator<U, Align> &) noexcept
+    {
+        return true;
+    }
+    template<class T, class U, size_t Align>
+    inline bool operator!=(const AlignedAllocator<T, Align> &, const AlignedAllocator<U, Align> &) noexcept
+    {
+        return false;
+    }
+    // 元素按64字节对齐的std::vector
+    template<class T>
+    using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+    // 线性分配器(arena): 构造时分配一整块内存, Alloc只移动偏移量, Reset一次释放全部
+    // 用于每帧的临时数组(例如批量内核的输出), 每帧开始时Reset, 稳定后不再有堆分配; 空间不足时返回nullptr, 不会扩容
+    // 不是线程安全的, 每个线程使用自己的FrameArena
+    class FrameArena final
+    {
+    public:
+        // 内存块的对齐, 也是Alloc允许的最大对齐
+        static const size_t MaxAlignment = 64;
+
+        FrameArena() noexcept : buff(nullptr), capacity(0), offset(0), peak(0)
+        {
+            // nothing to do
+        }
+        // 预先分配bytes字节, 失败时Capacity()为0
+        explicit FrameArena(size_t bytes) noexcept : buff(nullptr), capacity(0), offset(0), peak(0)
+        {
+            Reserve(bytes);
+        }
+        FrameArena(FrameArena &&b) noexcept : buff(b.buff), capacity(b.capacity), offset(b.offset), peak(b.peak)
+        {
+            b.buff = nullptr;
+            b.capacity = 0;
+            b.offset = 0;
+            b.peak = 0;
+        }
+        FrameArena& operator=(FrameArena &&b) noexcept
+        {
+            std::swap(buff, b.buff);
+            std::swap(capacity, b.capacity);
+            std::swap(offset, b.offset);
+            std::swap(peak, b.peak);
+            return *this;
+        }
+        FrameArena(const FrameArena &) = delete;
+        FrameArena& operator=(const FrameArena &) = delete;
+        ~FrameArena()
+        {
+            AlignedFree(buff);
+        }
+        // 重新分配bytes字节的内存块, 原有的分配全部失效. 失败返回false, 原有内存块保持不变
+        bool Reserve(size_t bytes) noexcept
+        {
+            unsigned char *p = static_cast<unsigned char*>(AlignedAlloc(bytes, MaxAlignment));
+            if (p == nullptr)
+            {
+                return false;
+            }
+            AlignedFree(buff);
+            buff = p;
+            capacity = bytes;
+            offset = 0;
+            peak = 0;
+            return true;
+        }
+        // 分配bytes字节, 按align(2的幂, 不超过MaxAlignment)对齐; 空间不足时返回nullptr
+        void* Allocate(size_t bytes, size_t align = 16) noexcept
+        {
+            assert(align != 0 && (align & (align - 1)) == 0 && align <= MaxAlignment);
+            const size_t begin = (offset + align - 1) & ~(align - 1);
+            if (begin > capacity || bytes > capacity - begin)
+            {
+                return nullptr;
+            }
+            offset = begin + bytes;
+            peak = offset > peak ? offset : peak;
+            return buff + begin;
+        }
+        // 分配n个T的空间, 不调用构造函数(内容未初始化), 用于写入批量内核的输出
+        template<class T>
+        T* Alloc(size_t n, size_t align = alignof(T) > 16 ? alignof(T) : 16) noexcept
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "FrameArena never calls destructors");
+            if (n > static_cast<size_t>(-1) / sizeof(T))
+            {
+                return nullptr;
+            }
+            return static_cast<T*>(Allocate(n * sizeof(T), align));
+        }
+        // 当前位置, 配合Rewind释放这之后的所有分配(例如一个函数内部的临时数组)
+        inline size_t Mark() const noexcept
+        {
+            return offset;
+        }
+        // 回到Mark返回的位置
+        inline void Rewind(size_t mark) noexcept
+        {
+            assert(mark <= offset);
+            offset = mark;
+        }
+        // 释放全部分配(每帧开始时调用), 不释放内存块
+        inline void Reset() noexcept
+        {
+            offset = 0;
+        }
+        // 已使用的字节数
+        inline size_t Used() const noexcept
+        {
+            return offset;
+        }
+        // 内存块的大小
+        inline size_t Capacity() const noexcept
+        {
+            return capacity;
+        }
+        // 自Reserve以来使用的最大字节数, 可以据此确定需要预留的大小
+        inline size_t Peak() const noexcept
+        {
+            return peak;
+        }
+    private:
+        unsigned char *buff;
+        size_t         capacity;
+        size_t         offset;                              // 下一次分配的起点
+        size_t         peak;
+    };
+}
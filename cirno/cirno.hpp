@@ -3,7 +3,7 @@
  | 文件名称: cirno.hpp
  | 文件作用: 共同的头文件
  | 创建日期: 2021-04-17
- | 更新日期: 2021-04-17
+ | 更新日期: 2026-10-17
  | 开发人员: JuYan
 +----------------------------
  Copyright (C) JuYan, all rights reserved.
@@ -40,32 +40,120 @@
 #else
     #define MATHLIB_CALL(ret)   ret
 #endif // _MATHLIB_USE_SSE, _MSC_VER
+// 编译期求值: 构造函数和只有一条return语句的函数直接是constexpr
+// 有多条语句或修改成员的函数使用MATHLIB_CONSTEXPR14, 需要C++14放宽的constexpr规则, C++11下不是constexpr
+// 带SIMD路径的函数使用MATHLIB_CONSTEXPR_SIMD, 编译期求值时(MATHLIB_IS_CONSTANT_EVALUATED()为true)走标量路径, 运行时仍然使用SIMD
+// 编译器不提供__builtin_is_constant_evaluated(C++20的std::is_constant_evaluated的实现)或者不是C++14时, 这些函数不是constexpr
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+    #define _MATHLIB_HAS_CONSTEXPR14            1
+    #define MATHLIB_CONSTEXPR14                 constexpr
+#else
+    #define MATHLIB_CONSTEXPR14
+#endif // __cplusplus, _MSVC_LANG
+#if defined(__has_builtin)
+    #if __has_builtin(__builtin_is_constant_evaluated)
+        #define _MATHLIB_HAS_CONSTANT_EVALUATED     1
+    #endif
+#endif // __has_builtin
+#if !defined(_MATHLIB_HAS_CONSTANT_EVALUATED) && ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+    #define _MATHLIB_HAS_CONSTANT_EVALUATED         1
+#endif // __GNUC__, _MSC_VER
+#if defined(_MATHLIB_HAS_CONSTANT_EVALUATED) && defined(_MATHLIB_HAS_CONSTEXPR14)
+    #define MATHLIB_IS_CONSTANT_EVALUATED()     __builtin_is_constant_evaluated()
+    #define MATHLIB_CONSTEXPR_SIMD              constexpr
+#else
+    #define MATHLIB_IS_CONSTANT_EVALUATED()     false
+    #define MATHLIB_CONSTEXPR_SIMD
+#endif // _MATHLIB_HAS_CONSTANT_EVALUATED, _MATHLIB_HAS_CONSTEXPR14
+// 批量运算的运行时分派: x86/AMD64上默认开启, 按CPUID选择内核; 定义_MATHLIB_NO_DISPATCH则只使用编译选项允许的指令集
+#if !defined(_MATHLIB_NO_DISPATCH) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+    #define _MATHLIB_USE_DISPATCH   1
+#endif // _MATHLIB_NO_DISPATCH
+// 没有定义_MATHLIB_USE_SSE时, GCC/Clang使用编译器的向量扩展实现4路float32运算(f32x4.hpp), 在ARM等平台上也能生成向量指令
+// 定义_MATHLIB_NO_VECTOR_EXT则退回普通数组
+#if !defined(_MATHLIB_USE_SSE) && !defined(_MATHLIB_NO_VECTOR_EXT) && defined(__GNUC__)
+    #define _MATHLIB_USE_VECTOR_EXT     1
+#endif // _MATHLIB_USE_SSE, _MATHLIB_NO_VECTOR_EXT, __GNUC__
+// 线程池(parallel.hpp)和接受ThreadPool的批量运算重载需要在包括本文件之前定义_MATHLIB_USE_PARALLEL, 旧的GCC/Clang工具链链接时还需要-pthread
+// 没有定义时不包括<thread>等头文件, 需要线程数参数的接口(TransformHierarchy::Update, LinearBlendSkinning::Skin)在调用者的线程中计算
 #if defined(_MATHLIB_USE_SSE)
     #include <xmmintrin.h>
+    #include <emmintrin.h>
 #endif // _MATHLIB_USE_SSE
+#if defined(_MATHLIB_USE_DISPATCH) || defined(__SSE4_1__)
+    #include <immintrin.h>
+#endif // _MATHLIB_USE_DISPATCH, __SSE4_1__
 //
 #include <math.h>
 #include <utility>
+#include <type_traits>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <limits>
+#if defined(_MATHLIB_USE_PARALLEL)
+    #include <thread>
+    #include <mutex>
+    #include <condition_variable>
+    #include <deque>
+#endif // _MATHLIB_USE_PARALLEL
 // 运算数据类型
 namespace cirno
 {
     using float32 = float;
     using float64 = double;
 }
+// CPU特性检测与批量运算内核
+#include "cpu.hpp"
+#include "kernel.hpp"
+#if defined(_MATHLIB_USE_PARALLEL)
+// 线程池
+#include "parallel.hpp"
+#endif // _MATHLIB_USE_PARALLEL
+// 对齐的内存分配
+#include "allocator.hpp"
+// 精度策略
+#include "precision.hpp"
+// 水平归约
+#include "reduce.hpp"
+// 4 x float32
+#include "f32x4.hpp"
 // Vector2
 #include "vector2.hpp"
 // Vector3
 #include "vector3.hpp"
+#include "vector3stream.hpp"
 // Vector4
 #include "vector4.hpp"
 // Quaternion
 #include "quater.hpp"
+// 表达式模板
+#include "expr.hpp"
 // Matrix 4x4
 #include "matrix4.hpp"
+// 双精度类型
+#include "f64x4.hpp"
+#include "vector3d.hpp"
+#include "vector4d.hpp"
+#include "quaterd.hpp"
+#include "matrix4d.hpp"
+// 对偶四元数
+#include "dualquater.hpp"
+// 蒙皮
+#include "skinning.hpp"
+// 量化存储格式
+#include "packed.hpp"
+// 变换层级
+#include "hierarchy.hpp"
+// 视锥体剔除
+#include "frustum.hpp"
 // Utils
 #include "rect.hpp"
+#include "rectgrid.hpp"
 
@@ -0,0 +1,223 @@
+﻿/*
+ | Cirno
+ | 文件名称: cpu.hpp
+ | 文件作用: CPU特性检测与运行时分派
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#if defined(_MATHLIB_USE_DISPATCH)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif // _MSC_VER
+#endif // _MATHLIB_USE_DISPATCH
+namespace cirno
+{
+    // 批量运算内核使用的指令集级别, 数值越大越新
+    enum class SimdLevel : uint32_t
+    {
+        Scalar = 0,                                         // 不使用SIMD指令
+        SSE41  = 1,                                         // SSE4.1, 4路
+        AVX2   = 2,                                         // AVX2 + FMA3 + F16C, 8路
+        AVX512 = 3,                                         // AVX-512F, 16路
+    };
+    // 取得指令集级别的名称, 与环境变量CIRNO_SIMD的取值相同
+    inline const char* SimdLevelName(SimdLevel level) noexcept
+    {
+        switch (level)
+        {
+        case SimdLevel::SSE41:
+            return "sse4.1";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+        }
+    }
+    // 编译期就能确定可用的最高级别(由编译选项-msse4.1, -mavx2 -mfma -mf16c, -mavx512f等决定)
+    inline SimdLevel CompiledSimdLevel() noexcept
+    {
+    #if defined(__AVX512F__)
+        return SimdLevel::AVX512;
+    #elif defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+        return SimdLevel::AVX2;
+    #elif defined(__SSE4_1__)
+        return SimdLevel::SSE41;
+    #else
+        return SimdLevel::Scalar;
+    #endif // __AVX512F__, __AVX2__, __SSE4_1__
+    }
+    // 通过CPUID检测当前CPU(和操作系统)支持的最高级别
+    inline SimdLevel DetectSimdLevel() noexcept
+    {
+    #if defined(_MATHLIB_USE_DISPATCH)
+        uint32_t r1[4] = { 0 };                             // leaf 1: eax, ebx, ecx, edx
+        uint32_t r7[4] = { 0 };                             // leaf 7, subleaf 0
+        uint32_t max_leaf;
+    #if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        max_leaf = static_cast<uint32_t>(regs[0]);
+        __cpuid(regs, 1);
+        memcpy(r1, regs, sizeof(r1));
+        if (max_leaf >= 7)
+        {
+            __cpuidex(regs, 7, 0);
+            memcpy(r7, regs, sizeof(r7));
+        }
+    #else
+        max_leaf = __get_cpuid_max(0, nullptr);
+        __get_cpuid(1, &r1[0], &r1[1], &r1[2], &r1[3]);
+        if (max_leaf >= 7)
+        {
+            __cpuid_count(7, 0, r7[0], r7[1], r7[2], r7[3]);
+        }
+    #endif // _MSC_VER
+        const bool sse41 = (r1[2] & (1u << 19)) != 0;
+        const bool fma = (r1[2] & (1u << 12)) != 0;
+        const bool f16c = (r1[2] & (1u << 29)) != 0;
+        const bool osxsave = (r1[2] & (1u << 27)) != 0;
+        const bool avx = (r1[2] & (1u << 28)) != 0;
+        const bool avx2 = (r7[1] & (1u << 5)) != 0;
+        const bool avx512f = (r7[1] & (1u << 16)) != 0;
+        // 操作系统必须保存对应的寄存器状态(XCR0), 否则即使CPU支持也不能使用
+        uint64_t xcr0 = 0;
+        if (osxsave)
+        {
+        #if defined(_MSC_VER)
+            xcr0 = _xgetbv(0);
+        #else
+            uint32_t lo, hi;
+            __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            xcr0 = (static_cast<uint64_t>(hi) << 32) | lo;
+        #endif // _MSC_VER
+        }
+        const bool ymm_os = (xcr0 & 0x06) == 0x06;         // XMM, YMM
+        const bool zmm_os = (xcr0 & 0xe6) == 0xe6;         // XMM, YMM, opmask, ZMM_Hi256, Hi16_ZMM
+
+        if (avx512f && avx2 && fma && f16c && avx && zmm_os)
+        {
+            return SimdLevel::AVX512;
+        }
+        if (avx2 && fma && f16c && avx && ymm_os)
+        {
+            return SimdLevel::AVX2;
+        }
+        if (sse41)
+        {
+            return SimdLevel::SSE41;
+        }
+        return SimdLevel::Scalar;
+    #else
+        return CompiledSimdLevel();
+    #endif // _MATHLIB_USE_DISPATCH
+    }
+    // 解析指令集级别的名称, 无法识别时返回false
+    inline bool ParseSimdLevel(const char *name, SimdLevel &level) noexcept
+    {
+        static const struct
+        {
+            const char *name;
+            SimdLevel   level;
+        } table[] = {
+            { "scalar", SimdLevel::Scalar },
+            { "sse4.1", SimdLevel::SSE41 },
+            { "sse41",  SimdLevel::SSE41 },
+            { "avx2",   SimdLevel::AVX2 },
+            { "avx512", SimdLevel::AVX512 },
+        };
+        for (const auto &t : table)
+        {
+            if (strcmp(name, t.name) == 0)
+            {
+                level = t.level;
+                return true;
+            }
+        }
+        return false;
+    }
+    // 初始化时选择的指令集级别: 检测到的最高级别, 环境变量CIRNO_SIMD可以强制指定更低的级别, 例如CIRNO_SIMD=sse4.1
+    inline SimdLevel InitialSimdLevel() noexcept
+    {
+        const SimdLevel detected = DetectSimdLevel();
+        SimdLevel forced;
+        const char *env = getenv("CIRNO_SIMD");
+        if (env != nullptr && ParseSimdLevel(env, forced) && forced < detected)
+        {
+            return forced;                                  // 只能降级, 不能使用CPU不支持的指令
+        }
+        return detected;
+    }
+    // 当前使用的指令集级别(存储位置), 第一次使用时检测一次
+    // 线程池的工作线程在MATHLIB_DISPATCH中读取, 所以是原子变量; 级别之间没有其他数据依赖, 使用relaxed即可
+    inline std::atomic<SimdLevel>& CurrentSimdLevel() noexcept
+    {
+        static std::atomic<SimdLevel> level(InitialSimdLevel());
+        return level;
+    }
+    // 取得当前使用的指令集级别
+    inline SimdLevel GetSimdLevel() noexcept
+    {
+    #if defined(_MATHLIB_USE_DISPATCH)
+        return CurrentSimdLevel().load(std::memory_order_relaxed);
+    #else
+        return CompiledSimdLevel();
+    #endif // _MATHLIB_USE_DISPATCH
+    }
+    // 强制使用某个指令集级别(用于对比测试), 超过CPU支持的级别时使用检测到的最高级别, 返回实际使用的级别
+    // 任何线程都可以调用; 其他线程上正在进行的并行批量运算可能有一部分块仍然使用原来的级别
+    inline SimdLevel SetSimdLevel(SimdLevel level) noexcept
+    {
+    #if defined(_MATHLIB_USE_DISPATCH)
+        const SimdLevel detected = DetectSimdLevel();
+        CurrentSimdLevel().store(level < detected ? level : detected, std::memory_order_relaxed);
+    #else
+        (void)level;
+    #endif // _MATHLIB_USE_DISPATCH
+        return GetSimdLevel();
+    }
+}
+// 按照当前的指令集级别调用cirno::kernel::<级别>::func(...)
+#if defined(_MATHLIB_USE_DISPATCH)
+    #define MATHLIB_DISPATCH(func, ...)                                                         \
+        do {                                                                                    \
+            switch (::cirno::GetSimdLevel())                                                    \
+            {                                                                                   \
+            case ::cirno::SimdLevel::AVX512: ::cirno::kernel::avx512::func(__VA_ARGS__); break; \
+            case ::cirno::SimdLevel::AVX2:   ::cirno::kernel::avx2::func(__VA_ARGS__); break;   \
+            case ::cirno::SimdLevel::SSE41:  ::cirno::kernel::sse41::func(__VA_ARGS__); break;  \
+            default:                         ::cirno::kernel::scalar::func(__VA_ARGS__); break; \
+            }                                                                                   \
+        } while (0)
+#else
+    #define MATHLIB_DISPATCH(func, ...)     ::cirno::kernel::native::func(__VA_ARGS__)
+#endif // _MATHLIB_USE_DISPATCH
@@ -0,0 +1,293 @@
+﻿/*
+ | Cirno
+ | 文件名称: dualquater.hpp
+ | 文件作用: 对偶四元数(刚体变换, 蒙皮)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "vector3stream.hpp"
+#include "quater.hpp"
+#include "matrix4.hpp"
+#include "kernel.hpp"
+namespace cirno
+{
+    // 对偶四元数: q = r + εd, 表示刚体变换(先旋转再平移), 不能表示缩放
+    // r是旋转(单位四元数), d = 0.5 * t * r, t是平移(纯虚四元数); 8个float32, 是Matrix4的一半
+    // 用于蒙皮时对偶四元数的线性混合不会像矩阵混合那样在关节处体积收缩
+    class DualQuaternion final
+    {
+    public:
+        DualQuaternion() noexcept : real(), dual(0.0f, 0.0f, 0.0f, 0.0f)
+        {
+            // nothing to do...
+        }
+        DualQuaternion(const Quaternion r, const Quaternion d) noexcept : real(r), dual(d)
+        {
+            // nothing to do...
+        }
+        DualQuaternion(const Quaternion r, const Vector3 t) noexcept
+        {
+            SetByRotateTranslate(r, t);
+        }
+        explicit DualQuaternion(const Matrix4 &m) noexcept
+        {
+            SetByMatrix(m);
+        }
+        ~DualQuaternion() = default;
+        DualQuaternion(const DualQuaternion &) = default;
+        DualQuaternion& operator=(const DualQuaternion &) = default;
+        // 由旋转和平移设置: 先旋转r, 再平移t; r必须是归一化的
+        MATHLIB_CALL(DualQuaternion&) SetByRotateTranslate(const Quaternion r, const Vector3 t) noexcept
+        {
+            real = r;
+            dual = Quaternion(t) * r * 0.5f;
+            return *this;
+        }
+        // 由旋转和平移创建(static)
+        static MATHLIB_CALL(DualQuaternion) RotateTranslate(const Quaternion r, const Vector3 t) noexcept
+        {
+            return DualQuaternion().SetByRotateTranslate(r, t);
+        }
+        // 由刚体变换矩阵设置, 缩放被忽略(只保留旋转和平移)
+        MATHLIB_CALL(DualQuaternion&) SetByMatrix(const Matrix4 &m) noexcept
+        {
+            Vector3 t, s;
+            Quaternion r;
+            m.Decompose(t, r, s);
+            return SetByRotateTranslate(r, t);
+        }
+        // 由刚体变换矩阵创建(static)
+        static MATHLIB_CALL(DualQuaternion) FromMatrix(const Matrix4 &m) noexcept
+        {
+            return DualQuaternion().SetByMatrix(m);
+        }
+        // 转换为矩阵, 必须是归一化的
+        MATHLIB_CALL(Matrix4) GetMatrix() const noexcept
+        {
+            return Matrix4::FromTRS(GetTranslation(), real, Vector3(1.0f, 1.0f, 1.0f));
+        }
+        // 取得实部(旋转)
+        MATHLIB_CALL(Quaternion) GetReal() const noexcept
+        {
+            return real;
+        }
+        // 取得对偶部
+        MATHLIB_CALL(Quaternion) GetDual() const noexcept
+        {
+            return dual;
+        }
+        // 设置实部
+        MATHLIB_CALL(DualQuaternion&) SetReal(const Quaternion r) noexcept
+        {
+            real = r;
+            return *this;
+        }
+        // 设置对偶部
+        MATHLIB_CALL(DualQuaternion&) SetDual(const Quaternion d) noexcept
+        {
+            dual = d;
+            return *this;
+        }
+        // 取得旋转, 必须是归一化的
+        MATHLIB_CALL(Quaternion) GetRotation() const noexcept
+        {
+            return real;
+        }
+        // 取得平移: t = 2 * d * r共轭的虚部, 必须是归一化的
+        MATHLIB_CALL(Vector3) GetTranslation() const noexcept
+        {
+            return (dual * real.GetConjugate()).GetImaginaryPart() * 2.0f;
+        }
+        // 实部的点乘, 为负时两个对偶四元数表示的旋转在两个半球上(混合前应取反其中一个)
+        MATHLIB_CALL(float32) DotMul(const DualQuaternion b) const noexcept
+        {
+            return real.DotMul(b.real);
+        }
+        // 归一化: 实部长度为1, 对偶部与实部正交; 实部长度为0时保持不变
+        DualQuaternion& SetNormalize() noexcept
+        {
+            const float32 len = real.DotMul(real);
+            if (len == 0.0f)
+            {
+                return *this;
+            }
+            const float32 k = 1.0f / sqrtf(len);
+            real *= k;
+            dual *= k;
+            dual -= real * real.DotMul(dual);                   // 去掉对偶部中与实部平行的分量
+            return *this;
+        }
+        // 取得归一化的结果
+        MATHLIB_CALL(DualQuaternion) GetNormalize() const noexcept
+        {
+            return DualQuaternion(*this).SetNormalize();
+        }
+        // 共轭: (r共轭, d共轭), 对于归一化的对偶四元数就是逆变换
+        DualQuaternion& SetConjugate() noexcept
+        {
+            real.SetConjugate();
+            dual.SetConjugate();
+            return *this;
+        }
+        // 取得共轭
+        MATHLIB_CALL(DualQuaternion) GetConjugate() const noexcept
+        {
+            return DualQuaternion(*this).SetConjugate();
+        }
+        // 复合变换: this * b, 与矩阵相同, 先进行b的变换再进行this的变换
+        // (r1 + εd1)(r2 + εd2) = r1r2 + ε(r1d2 + d1r2)
+        MATHLIB_CALL(DualQuaternion&) operator*=(const DualQuaternion b) noexcept
+        {
+            dual = real * b.dual + dual * b.real;
+            real *= b.real;
+            return *this;
+        }
+        // 复合变换
+        MATHLIB_CALL(DualQuaternion) operator*(const DualQuaternion b) const noexcept
+        {
+            return DualQuaternion(*this) *= b;
+        }
+        // 加法, 用于混合
+        MATHLIB_CALL(DualQuaternion&) operator+=(const DualQuaternion b) noexcept
+        {
+            real += b.real;
+            dual += b.dual;
+            return *this;
+        }
+        // 加法
+        MATHLIB_CALL(DualQuaternion) operator+(const DualQuaternion b) const noexcept
+        {
+            return DualQuaternion(real + b.real, dual + b.dual);
+        }
+        // 数乘, 用于混合
+        MATHLIB_CALL(DualQuaternion&) operator*=(const float32 v) noexcept
+        {
+            real *= v;
+            dual *= v;
+            return *this;
+        }
+        // 数乘
+        friend MATHLIB_CALL(DualQuaternion) operator*(const DualQuaternion dq, const float32 v) noexcept
+        {
+            return DualQuaternion(dq.real * v, dq.dual * v);
+        }
+        // 变换点: 先旋转再平移, 必须是归一化的
+        MATHLIB_CALL(Vector3) TransformPoint(const Vector3 p) const noexcept
+        {
+            return real.Rotate(p) + GetTranslation();
+        }
+        // 变换方向向量(法线): 只旋转, 必须是归一化的
+        MATHLIB_CALL(Vector3) TransformDirection(const Vector3 v) const noexcept
+        {
+            return real.Rotate(v);
+        }
+        // 线性混合(DLB): Σ(±w[k] * dq[k])后归一化, 与dq[0]的实部点乘为负的取反
+        static MATHLIB_CALL(DualQuaternion) Blend(const DualQuaternion *dq, const float32 *w, size_t n) noexcept
+        {
+            DualQuaternion r(Quaternion(0.0f, 0.0f, 0.0f, 0.0f), Quaternion(0.0f, 0.0f, 0.0f, 0.0f));
+            for (size_t k = 0; k < n; k += 1)
+            {
+                r += dq[k] * (dq[k].DotMul(dq[0]) < 0.0f ? -w[k] : w[k]);
+            }
+            return r.SetNormalize();
+        }
+        // 对偶四元数蒙皮(SoA): 每个顶点最多4个骨骼, joints[4 * k + j]是第k个顶点的第j个骨骼在palette中的下标,
+        // weights[4 * k + j]是对应的权重(不使用的骨骼权重为0); 输出可以就是输入
+        // 每次处理Width个顶点, 按骨骼下标转置读取palette后在寄存器中混合, 归一化后直接变换, 不生成中间的矩阵
+        static void Skin(const DualQuaternion *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, Vector3Stream &out_pos) noexcept
+        {
+            if (out_pos.Resize(pos.Size()))
+            {
+                MATHLIB_DISPATCH(DualQuaternionSkin, palette->DataPtr(), joints, weights,
+                                 pos.XPtr(), pos.YPtr(), pos.ZPtr(), nullptr, nullptr, nullptr,
+                                 out_pos.XPtr(), out_pos.YPtr(), out_pos.ZPtr(), nullptr, nullptr, nullptr, pos.Size());
+            }
+        }
+        // 对偶四元数蒙皮, 同时变换位置和法线; pos与nrm的元素个数必须相同
+        static void Skin(const DualQuaternion *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const Vector3Stream &nrm, Vector3Stream &out_pos, Vector3Stream &out_nrm) noexcept
+        {
+            assert(pos.Size() == nrm.Size());
+            if (out_pos.Resize(pos.Size()) && out_nrm.Resize(pos.Size()))
+            {
+                MATHLIB_DISPATCH(DualQuaternionSkin, palette->DataPtr(), joints, weights,
+                                 pos.XPtr(), pos.YPtr(), pos.ZPtr(), nrm.XPtr(), nrm.YPtr(), nrm.ZPtr(),
+                                 out_pos.XPtr(), out_pos.YPtr(), out_pos.ZPtr(), out_nrm.XPtr(), out_nrm.YPtr(), out_nrm.ZPtr(), pos.Size());
+            }
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 对偶四元数蒙皮, 分块后在pool中并行计算
+        static void Skin(ThreadPool &pool, const DualQuaternion *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, Vector3Stream &out_pos)
+        {
+            if (out_pos.Resize(pos.Size()))
+            {
+                pool.For(0, pos.Size(), pool.Grain(pos.Size(), ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(DualQuaternionSkin, palette->DataPtr(), joints + 4 * b, weights + 4 * b,
+                                     pos.XPtr() + b, pos.YPtr() + b, pos.ZPtr() + b, nullptr, nullptr, nullptr,
+                                     out_pos.XPtr() + b, out_pos.YPtr() + b, out_pos.ZPtr() + b, nullptr, nullptr, nullptr, e - b);
+                });
+            }
+        }
+        // 对偶四元数蒙皮, 同时变换位置和法线, 分块后在pool中并行计算
+        static void Skin(ThreadPool &pool, const DualQuaternion *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const Vector3Stream &nrm, Vector3Stream &out_pos, Vector3Stream &out_nrm)
+        {
+            assert(pos.Size() == nrm.Size());
+            if (out_pos.Resize(pos.Size()) && out_nrm.Resize(pos.Size()))
+            {
+                pool.For(0, pos.Size(), pool.Grain(pos.Size(), ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(DualQuaternionSkin, palette->DataPtr(), joints + 4 * b, weights + 4 * b,
+                                     pos.XPtr() + b, pos.YPtr() + b, pos.ZPtr() + b, nrm.XPtr() + b, nrm.YPtr() + b, nrm.ZPtr() + b,
+                                     out_pos.XPtr() + b, out_pos.YPtr() + b, out_pos.ZPtr() + b, out_nrm.XPtr() + b, out_nrm.YPtr() + b, out_nrm.ZPtr() + b, e - b);
+                });
+            }
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 取得数据区: 实部a, b, c, d, 对偶部a, b, c, d
+        inline float32* DataPtr() noexcept
+        {
+            return real.GetPtr();
+        }
+        // 取得数据区
+        inline const float32* DataPtr() const noexcept
+        {
+            return real.GetPtr();
+        }
+    private:
+        // 内存布局:
+        // | ---- 128 ---- | ---- 128 ---- |
+        // |  Quaternion r |  Quaternion d |
+        Quaternion real;
+        Quaternion dual;
+    };
+    static_assert(sizeof(DualQuaternion) == 8 * sizeof(float32), "DualQuaternion must be 8 packed float32");
+}
@@ -0,0 +1,492 @@
+﻿/*
+ | Cirno
+ | 文件名称: expr.hpp
+ | 文件作用: 表达式模板(惰性求值, 合并乘加)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "vector3stream.hpp"
+#include "vector4.hpp"
+#include "quater.hpp"
+namespace cirno
+{
+    // 表达式模板, 需要时用expr::Lazy显式开启, 不改变Vector3等类型原有的运算符
+    //   Vector3 r = expr::Lazy(a) + expr::Lazy(b) * s - c;
+    // 至少一个操作数是表达式时才使用这里的运算符, 上例中的b * s如果不写Lazy就是原来的Vector3乘法;
+    // 运算符只建立表达式树, 转换为结果类型时一次求值, 不产生中间的临时对象;
+    // x * s + y, y + x * s, x * s - y, y - x * s在建立表达式树时就合并为乘加节点, 有FMA时是一条指令(单个值需要-mfma)
+    // 流(Vector3Stream)的表达式用expr::Assign(out, e)求值, 所有分量在同一个循环中计算, 使用运行时分派的内核
+    // 支持的运算: 同类型相加减, 取负, 乘以标量; 流可以与单个Vector3相加减(广播到每个元素)
+    namespace expr
+    {
+        // 单个值求值时使用的寄存器
+        using Reg = f32x4::Reg;
+        // 由寄存器构造结果
+        template<class T>
+        struct Result;
+        template<>
+        struct Result<Vector3>
+        {
+            static MATHLIB_CALL(Vector3) From(const Reg r) noexcept
+            {
+                return Vector3(r);
+            }
+        };
+        template<>
+        struct Result<Vector4>
+        {
+            static MATHLIB_CALL(Vector4) From(const Reg r) noexcept
+            {
+                return Vector4(r);
+            }
+        };
+        template<>
+        struct Result<Quaternion>
+        {
+            static MATHLIB_CALL(Quaternion) From(const Reg r) noexcept
+            {
+                return Quaternion(r);
+            }
+        };
+        // 两个操作数的结果类型: 类型相同, 或者流与单个向量(向量广播到流的每个元素); 其他组合没有Type, 对应的运算符不存在
+        template<class A, class B>
+        struct Common
+        {
+            // nothing to do
+        };
+        template<class A>
+        struct Common<A, A>
+        {
+            using Type = A;
+        };
+        template<>
+        struct Common<Vector3Stream, Vector3>
+        {
+            using Type = Vector3Stream;
+        };
+        template<>
+        struct Common<Vector3, Vector3Stream>
+        {
+            using Type = Vector3Stream;
+        };
+        // 流的元素个数, 单个值为0; 参与运算的流的元素个数必须相同
+        inline size_t MergeSize(size_t a, size_t b) noexcept
+        {
+            assert(a == 0 || b == 0 || a == b);
+            return a > b ? a : b;
+        }
+        // 所有节点的基类, 转换为结果类型时求值
+        template<class D>
+        struct Node
+        {
+            template<class T, class E = D, class = typename std::enable_if<std::is_same<T, typename E::Type>::value>::type>
+            operator T() const noexcept                         // E = D: 推迟到使用时再取D::Type, 此时D已经是完整类型
+            {
+                return Result<T>::From(static_cast<const E&>(*this).Get());
+            }
+        };
+        // 叶节点: 单个值(按值保存, 表达式可以比操作数活得更久, 也允许结果就是操作数)
+        template<class T>
+        struct Leaf : Node<Leaf<T>>
+        {
+            using Type = T;
+
+            alignas(16) float32 v[4];
+
+            explicit Leaf(const T &t) noexcept
+            {
+                memcpy(v, t.GetPtr(), sizeof(v));
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::Load(v);
+            }
+            size_t Size() const noexcept
+            {
+                return 0;
+            }
+        };
+        // 叶节点: 按分量存放(SoA)的流S, 只保存三个分量数组的指针, 表达式不能比流活得更久
+        // S需要提供XPtr, YPtr, ZPtr, Size, 数组按16个元素填充(填充部分可读); 其他SoA容器提供AsNode和Common的特化就可以参与表达式
+        template<class S>
+        struct StreamLeaf : Node<StreamLeaf<S>>
+        {
+            using Type = S;
+
+            const float32 *p[3];
+            size_t         n;
+
+            explicit StreamLeaf(const S &s) noexcept : p{ s.XPtr(), s.YPtr(), s.ZPtr() }, n(s.Size())
+            {
+                // nothing to do
+            }
+            size_t Size() const noexcept
+            {
+                return n;
+            }
+        };
+        // l + r
+        template<class L, class R>
+        struct Sum : Node<Sum<L, R>>
+        {
+            using Type = typename Common<typename L::Type, typename R::Type>::Type;
+
+            L l;
+            R r;
+
+            Sum(const L &_l, const R &_r) noexcept : l(_l), r(_r)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::Add(l.Get(), r.Get());
+            }
+            size_t Size() const noexcept
+            {
+                return MergeSize(l.Size(), r.Size());
+            }
+        };
+        // l - r
+        template<class L, class R>
+        struct Difference : Node<Difference<L, R>>
+        {
+            using Type = typename Common<typename L::Type, typename R::Type>::Type;
+
+            L l;
+            R r;
+
+            Difference(const L &_l, const R &_r) noexcept : l(_l), r(_r)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::Sub(l.Get(), r.Get());
+            }
+            size_t Size() const noexcept
+            {
+                return MergeSize(l.Size(), r.Size());
+            }
+        };
+        // e * s
+        template<class E>
+        struct Scaled : Node<Scaled<E>>
+        {
+            using Type = typename E::Type;
+
+            E       e;
+            float32 s;
+
+            Scaled(const E &_e, const float32 _s) noexcept : e(_e), s(_s)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::Mul(e.Get(), f32x4::Splat(s));
+            }
+            size_t Size() const noexcept
+            {
+                return e.Size();
+            }
+        };
+        // -e, 乘以-1实现, 与流的内核结果相同
+        template<class E>
+        struct Negated : Node<Negated<E>>
+        {
+            using Type = typename E::Type;
+
+            E e;
+
+            explicit Negated(const E &_e) noexcept : e(_e)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::Mul(e.Get(), f32x4::Splat(-1.0f));
+            }
+            size_t Size() const noexcept
+            {
+                return e.Size();
+            }
+        };
+        // a * s + c
+        template<class A, class C>
+        struct MulAdd : Node<MulAdd<A, C>>
+        {
+            using Type = typename Common<typename A::Type, typename C::Type>::Type;
+
+            A       a;
+            float32 s;
+            C       c;
+
+            MulAdd(const A &_a, const float32 _s, const C &_c) noexcept : a(_a), s(_s), c(_c)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::MulAdd(a.Get(), f32x4::Splat(s), c.Get());
+            }
+            size_t Size() const noexcept
+            {
+                return MergeSize(a.Size(), c.Size());
+            }
+        };
+        // a * s - c
+        template<class A, class C>
+        struct MulSub : Node<MulSub<A, C>>
+        {
+            using Type = typename Common<typename A::Type, typename C::Type>::Type;
+
+            A       a;
+            float32 s;
+            C       c;
+
+            MulSub(const A &_a, const float32 _s, const C &_c) noexcept : a(_a), s(_s), c(_c)
+            {
+                // nothing to do
+            }
+            MATHLIB_CALL(Reg) Get() const noexcept
+            {
+                return f32x4::MulSub(a.Get(), f32x4::Splat(s), c.Get());
+            }
+            size_t Size() const noexcept
+            {
+                return MergeSize(a.Size(), c.Size());
+            }
+        };
+        // 把操作数转换为节点: 节点保持不变, 向量和四元数成为Leaf, 流成为StreamLeaf; IsNode表示它本来就是表达式
+        template<class T, class = void>
+        struct AsNode
+        {
+            // nothing to do
+        };
+        template<class T>
+        struct AsNode<T, typename std::enable_if<std::is_base_of<Node<T>, T>::value>::type>
+        {
+            using Type = T;
+            static const bool IsNode = true;
+
+            static const T& Make(const T &v) noexcept
+            {
+                return v;
+            }
+        };
+        template<>
+        struct AsNode<Vector3>
+        {
+            using Type = Leaf<Vector3>;
+            static const bool IsNode = false;
+
+            static Type Make(const Vector3 &v) noexcept
+            {
+                return Type(v);
+            }
+        };
+        template<>
+        struct AsNode<Vector4>
+        {
+            using Type = Leaf<Vector4>;
+            static const bool IsNode = false;
+
+            static Type Make(const Vector4 &v) noexcept
+            {
+                return Type(v);
+            }
+        };
+        template<>
+        struct AsNode<Quaternion>
+        {
+            using Type = Leaf<Quaternion>;
+            static const bool IsNode = false;
+
+            static Type Make(const Quaternion &v) noexcept
+            {
+                return Type(v);
+            }
+        };
+        template<>
+        struct AsNode<Vector3Stream>
+        {
+            using Type = StreamLeaf<Vector3Stream>;
+            static const bool IsNode = false;
+
+            static Type Make(const Vector3Stream &v) noexcept
+            {
+                return Type(v);
+            }
+        };
+        template<class T>
+        using NodeOf = typename AsNode<T>::Type;
+        // 二元运算的启用条件: 至少一个操作数已经是表达式(由Lazy开启), 并且两边的结果类型相容
+        template<class L, class R>
+        using EnableBinary = typename std::enable_if<AsNode<L>::IsNode || AsNode<R>::IsNode, typename Common<typename NodeOf<L>::Type, typename NodeOf<R>::Type>::Type>::type;
+        // 一元运算和数乘的启用条件
+        template<class E>
+        using EnableUnary = typename std::enable_if<AsNode<E>::IsNode>::type;
+
+        // 开启表达式模板: 把操作数包装为叶节点, 已经是表达式时保持不变
+        template<class T>
+        inline NodeOf<T> Lazy(const T &v) noexcept
+        {
+            return AsNode<T>::Make(v);
+        }
+        // 求值, 等同于转换为结果类型, 可以配合auto使用
+        template<class E>
+        inline typename E::Type Eval(const Node<E> &e) noexcept
+        {
+            return e;
+        }
+        // 求值后把填充部分恢复为0
+        inline void ClearPadding(Vector3Stream &out, size_t n) noexcept
+        {
+            const size_t pad = out.PaddedSize();
+            if (pad > n)                                        // 填充部分必须保持为0(例如加上一个向量后不再是0)
+            {
+                memset(out.XPtr() + n, 0, (pad - n) * sizeof(float32));
+                memset(out.YPtr() + n, 0, (pad - n) * sizeof(float32));
+                memset(out.ZPtr() + n, 0, (pad - n) * sizeof(float32));
+            }
+        }
+        // 流表达式求值: out[k] = e的第k个元素, 参与运算的流的元素个数必须相同, out会被设置为相同的大小
+        // out可以出现在e中; 内存分配失败时返回false
+        template<class E>
+        inline bool Assign(Vector3Stream &out, const Node<E> &e) noexcept
+        {
+            static_assert(std::is_same<typename E::Type, Vector3Stream>::value, "expression must contain a Vector3Stream");
+            const E &x = static_cast<const E&>(e);
+            const size_t n = x.Size();
+            if (!out.Resize(n))
+            {
+                return false;
+            }
+            const size_t pad = out.PaddedSize();
+            MATHLIB_DISPATCH(EvalExpr, x, out.XPtr(), out.YPtr(), out.ZPtr(), 0, pad);
+            ClearPadding(out, n);
+            return true;
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 流表达式求值, 分块后在pool中并行计算
+        template<class E>
+        inline bool Assign(ThreadPool &pool, Vector3Stream &out, const Node<E> &e)
+        {
+            static_assert(std::is_same<typename E::Type, Vector3Stream>::value, "expression must contain a Vector3Stream");
+            const E &x = static_cast<const E&>(e);
+            const size_t n = x.Size();
+            if (!out.Resize(n))
+            {
+                return false;
+            }
+            const size_t pad = out.PaddedSize();
+            pool.For(0, pad, pool.Grain(pad, ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t end) {
+                MATHLIB_DISPATCH(EvalExpr, x, out.XPtr(), out.YPtr(), out.ZPtr(), b, end);
+            });
+            ClearPadding(out, n);
+            return true;
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+
+        // l + r
+        template<class L, class R, class = EnableBinary<L, R>>
+        inline Sum<NodeOf<L>, NodeOf<R>> operator+(const L &l, const R &r) noexcept
+        {
+            return Sum<NodeOf<L>, NodeOf<R>>(AsNode<L>::Make(l), AsNode<R>::Make(r));
+        }
+        // a * s + r
+        template<class A, class R, class = EnableBinary<Scaled<A>, R>>
+        inline MulAdd<A, NodeOf<R>> operator+(const Scaled<A> &l, const R &r) noexcept
+        {
+            return MulAdd<A, NodeOf<R>>(l.e, l.s, AsNode<R>::Make(r));
+        }
+        // l + b * s
+        template<class L, class B, class = EnableBinary<L, Scaled<B>>>
+        inline MulAdd<B, NodeOf<L>> operator+(const L &l, const Scaled<B> &r) noexcept
+        {
+            return MulAdd<B, NodeOf<L>>(r.e, r.s, AsNode<L>::Make(l));
+        }
+        // a * s + b * t: 第二个乘法单独计算
+        template<class A, class B, class = EnableBinary<Scaled<A>, Scaled<B>>>
+        inline MulAdd<A, Scaled<B>> operator+(const Scaled<A> &l, const Scaled<B> &r) noexcept
+        {
+            return MulAdd<A, Scaled<B>>(l.e, l.s, r);
+        }
+        // l - r
+        template<class L, class R, class = EnableBinary<L, R>>
+        inline Difference<NodeOf<L>, NodeOf<R>> operator-(const L &l, const R &r) noexcept
+        {
+            return Difference<NodeOf<L>, NodeOf<R>>(AsNode<L>::Make(l), AsNode<R>::Make(r));
+        }
+        // a * s - r
+        template<class A, class R, class = EnableBinary<Scaled<A>, R>>
+        inline MulSub<A, NodeOf<R>> operator-(const Scaled<A> &l, const R &r) noexcept
+        {
+            return MulSub<A, NodeOf<R>>(l.e, l.s, AsNode<R>::Make(r));
+        }
+        // l - b * s = b * (-s) + l, 对s取负是精确的
+        template<class L, class B, class = EnableBinary<L, Scaled<B>>>
+        inline MulAdd<B, NodeOf<L>> operator-(const L &l, const Scaled<B> &r) noexcept
+        {
+            return MulAdd<B, NodeOf<L>>(r.e, -r.s, AsNode<L>::Make(l));
+        }
+        // a * s - b * t: 第二个乘法单独计算
+        template<class A, class B, class = EnableBinary<Scaled<A>, Scaled<B>>>
+        inline MulSub<A, Scaled<B>> operator-(const Scaled<A> &l, const Scaled<B> &r) noexcept
+        {
+            return MulSub<A, Scaled<B>>(l.e, l.s, r);
+        }
+        // -e
+        template<class E, class = EnableUnary<E>>
+        inline Negated<E> operator-(const E &e) noexcept
+        {
+            return Negated<E>(e);
+        }
+        // -(a * s) = a * (-s)
+        template<class A>
+        inline Scaled<A> operator-(const Scaled<A> &e) noexcept
+        {
+            return Scaled<A>(e.e, -e.s);
+        }
+        // e * s
+        template<class E, class = EnableUnary<E>>
+        inline Scaled<E> operator*(const E &e, const float32 s) noexcept
+        {
+            return Scaled<E>(e, s);
+        }
+        // s * e
+        template<class E, class = EnableUnary<E>>
+        inline Scaled<E> operator*(const float32 s, const E &e) noexcept
+        {
+            return Scaled<E>(e, s);
+        }
+    }
+}
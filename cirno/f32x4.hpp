@@ -0,0 +1,340 @@
+﻿/*
+ | Cirno
+ | 文件名称: f32x4.hpp
+ | 文件作用: 4个float32的寄存器运算(SSE, 编译器向量扩展)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 4个float32的寄存器运算, Vector2, Vector3, Vector4, Quaternion和Matrix4的逐分量运算都只写一次, 由这里选择实现
+    // 定义_MATHLIB_USE_SSE时是__m128; 否则GCC/Clang使用编译器的向量扩展(_MATHLIB_USE_VECTOR_EXT), 在ARM等平台上生成NEON等向量指令;
+    // 其他编译器是普通数组, 由编译器自动向量化
+    // Load/Store不要求对齐; Dot2, Dot3, Dot4的结果广播到全部分量
+    namespace f32x4
+    {
+    #if defined(_MATHLIB_USE_SSE)
+        using Reg = __m128;
+
+        inline MATHLIB_CALL(Reg) Set(float32 x, float32 y, float32 z, float32 w) noexcept
+        {
+            return _mm_setr_ps(x, y, z, w);
+        }
+        inline MATHLIB_CALL(Reg) Splat(float32 v) noexcept
+        {
+            return _mm_set_ps1(v);
+        }
+        inline MATHLIB_CALL(Reg) Load(const float32 *p) noexcept
+        {
+            return _mm_loadu_ps(p);
+        }
+        inline MATHLIB_CALL(void) Store(const Reg a, float32 *p) noexcept
+        {
+            _mm_storeu_ps(p, a);
+        }
+        inline MATHLIB_CALL(Reg) Add(const Reg a, const Reg b) noexcept { return _mm_add_ps(a, b); }
+        inline MATHLIB_CALL(Reg) Sub(const Reg a, const Reg b) noexcept { return _mm_sub_ps(a, b); }
+        inline MATHLIB_CALL(Reg) Mul(const Reg a, const Reg b) noexcept { return _mm_mul_ps(a, b); }
+        inline MATHLIB_CALL(Reg) Div(const Reg a, const Reg b) noexcept { return _mm_div_ps(a, b); }
+        inline MATHLIB_CALL(Reg) Sqrt(const Reg a) noexcept { return _mm_sqrt_ps(a); }
+        // a * b + c(有FMA时融合)
+        inline MATHLIB_CALL(Reg) MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+        #if defined(__FMA__)
+            return _mm_fmadd_ps(a, b, c);
+        #else
+            return _mm_add_ps(_mm_mul_ps(a, b), c);
+        #endif // __FMA__
+        }
+        // a * b - c(有FMA时融合)
+        inline MATHLIB_CALL(Reg) MulSub(const Reg a, const Reg b, const Reg c) noexcept
+        {
+        #if defined(__FMA__)
+            return _mm_fmsub_ps(a, b, c);
+        #else
+            return _mm_sub_ps(_mm_mul_ps(a, b), c);
+        #endif // __FMA__
+        }
+        // r = (a[i0], a[i1], a[i2], a[i3])
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle(const Reg a) noexcept
+        {
+            return _mm_shuffle_ps(a, a, _MM_SHUFFLE(i3, i2, i1, i0));
+        }
+        // r = (a[i0], a[i1], b[i2], b[i3])
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle2(const Reg a, const Reg b) noexcept
+        {
+            return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0));
+        }
+        // r = (b[0], a[1], a[2], a[3])
+        inline MATHLIB_CALL(Reg) MoveFirst(const Reg a, const Reg b) noexcept
+        {
+            return _mm_move_ss(a, b);
+        }
+        // 取得a[0]
+        inline MATHLIB_CALL(float32) First(const Reg a) noexcept
+        {
+            return _mm_cvtss_f32(a);
+        }
+        inline MATHLIB_CALL(Reg) Dot2(const Reg a, const Reg b) noexcept { return reduce::Dot2(a, b); }
+        inline MATHLIB_CALL(Reg) Dot3(const Reg a, const Reg b) noexcept { return reduce::Dot3(a, b); }
+        inline MATHLIB_CALL(Reg) Dot4(const Reg a, const Reg b) noexcept { return reduce::Dot4(a, b); }
+        // r[k] = s[k] != 0 ? a[k] : 0
+        inline MATHLIB_CALL(Reg) KeepNonZero(const Reg a, const Reg s) noexcept
+        {
+            return _mm_and_ps(a, _mm_cmpneq_ps(s, _mm_setzero_ps()));
+        }
+        // r[k] = 1 / a[k], P为精度策略
+        template<class P>
+        inline MATHLIB_CALL(Reg) Recip(const Reg a, P p) noexcept
+        {
+            return precision::Recip(a, p);
+        }
+        // r[k] = 1 / sqrt(a[k]), P为精度策略
+        template<class P>
+        inline MATHLIB_CALL(Reg) RecipSqrt(const Reg a, P p) noexcept
+        {
+            return precision::RecipSqrt(a, p);
+        }
+    #elif defined(_MATHLIB_USE_VECTOR_EXT)
+        typedef float32 Reg __attribute__((vector_size(16)));
+
+        inline MATHLIB_CALL(Reg) Set(float32 x, float32 y, float32 z, float32 w) noexcept
+        {
+            return Reg{ x, y, z, w };
+        }
+        inline MATHLIB_CALL(Reg) Splat(float32 v) noexcept
+        {
+            return Reg{ v, v, v, v };
+        }
+        inline MATHLIB_CALL(Reg) Load(const float32 *p) noexcept
+        {
+            Reg r;
+            memcpy(&r, p, sizeof(r));
+            return r;
+        }
+        inline MATHLIB_CALL(void) Store(const Reg a, float32 *p) noexcept
+        {
+            memcpy(p, &a, sizeof(a));
+        }
+        inline MATHLIB_CALL(Reg) Add(const Reg a, const Reg b) noexcept { return a + b; }
+        inline MATHLIB_CALL(Reg) Sub(const Reg a, const Reg b) noexcept { return a - b; }
+        inline MATHLIB_CALL(Reg) Mul(const Reg a, const Reg b) noexcept { return a * b; }
+        inline MATHLIB_CALL(Reg) Div(const Reg a, const Reg b) noexcept { return a / b; }
+        inline MATHLIB_CALL(Reg) Sqrt(const Reg a) noexcept
+        {
+            return Reg{ sqrtf(a[0]), sqrtf(a[1]), sqrtf(a[2]), sqrtf(a[3]) };
+        }
+        // a * b + c(由编译器决定是否融合, 见-ffp-contract)
+        inline MATHLIB_CALL(Reg) MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+            return a * b + c;
+        }
+        // a * b - c
+        inline MATHLIB_CALL(Reg) MulSub(const Reg a, const Reg b, const Reg c) noexcept
+        {
+            return a * b - c;
+        }
+        // r = (a[i0], a[i1], a[i2], a[i3])
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle(const Reg a) noexcept
+        {
+        #if defined(__clang__)
+            return __builtin_shufflevector(a, a, i0, i1, i2, i3);
+        #else
+            typedef int32_t Mask __attribute__((vector_size(16)));
+            return __builtin_shuffle(a, Mask{ i0, i1, i2, i3 });
+        #endif // __clang__
+        }
+        // r = (a[i0], a[i1], b[i2], b[i3])
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle2(const Reg a, const Reg b) noexcept
+        {
+        #if defined(__clang__)
+            return __builtin_shufflevector(a, b, i0, i1, i2 + 4, i3 + 4);
+        #else
+            typedef int32_t Mask __attribute__((vector_size(16)));
+            return __builtin_shuffle(a, b, Mask{ i0, i1, i2 + 4, i3 + 4 });
+        #endif // __clang__
+        }
+        // r = (b[0], a[1], a[2], a[3])
+        inline MATHLIB_CALL(Reg) MoveFirst(Reg a, const Reg b) noexcept
+        {
+            a[0] = b[0];
+            return a;
+        }
+        // 取得a[0]
+        inline MATHLIB_CALL(float32) First(const Reg a) noexcept
+        {
+            return a[0];
+        }
+        // 按分量顺序求和, 与标量代码的结果相同
+        inline MATHLIB_CALL(Reg) Dot2(const Reg a, const Reg b) noexcept
+        {
+            const Reg t = a * b;
+            return Splat(t[0] + t[1]);
+        }
+        inline MATHLIB_CALL(Reg) Dot3(const Reg a, const Reg b) noexcept
+        {
+            const Reg t = a * b;
+            return Splat(t[0] + t[1] + t[2]);
+        }
+        inline MATHLIB_CALL(Reg) Dot4(const Reg a, const Reg b) noexcept
+        {
+            const Reg t = a * b;
+            return Splat(t[0] + t[1] + t[2] + t[3]);
+        }
+        // r[k] = s[k] != 0 ? a[k] : 0
+        inline MATHLIB_CALL(Reg) KeepNonZero(const Reg a, const Reg s) noexcept
+        {
+            typedef int32_t Mask __attribute__((vector_size(16)));
+            return (Reg)((Mask)a & (s != Splat(0.0f)));
+        }
+        // 没有近似指令, 总是使用除法和平方根
+        template<class P>
+        inline MATHLIB_CALL(Reg) Recip(const Reg a, P) noexcept
+        {
+            return Splat(1.0f) / a;
+        }
+        template<class P>
+        inline MATHLIB_CALL(Reg) RecipSqrt(const Reg a, P) noexcept
+        {
+            return Splat(1.0f) / Sqrt(a);
+        }
+    #else
+        struct Reg
+        {
+            float32 v[4];
+        };
+
+        inline MATHLIB_CALL(Reg) Set(float32 x, float32 y, float32 z, float32 w) noexcept
+        {
+            return Reg{ { x, y, z, w } };
+        }
+        inline MATHLIB_CALL(Reg) Splat(float32 v) noexcept
+        {
+            return Reg{ { v, v, v, v } };
+        }
+        inline MATHLIB_CALL(Reg) Load(const float32 *p) noexcept
+        {
+            return Reg{ { p[0], p[1], p[2], p[3] } };
+        }
+        inline MATHLIB_CALL(void) Store(const Reg a, float32 *p) noexcept
+        {
+            p[0] = a.v[0];
+            p[1] = a.v[1];
+            p[2] = a.v[2];
+            p[3] = a.v[3];
+        }
+        inline MATHLIB_CALL(Reg) Add(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+        inline MATHLIB_CALL(Reg) Sub(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+        inline MATHLIB_CALL(Reg) Mul(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+        inline MATHLIB_CALL(Reg) Div(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+        inline MATHLIB_CALL(Reg) Sqrt(const Reg a) noexcept
+        {
+            return Reg{ { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) } };
+        }
+        inline MATHLIB_CALL(Reg) MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+            return Add(Mul(a, b), c);
+        }
+        inline MATHLIB_CALL(Reg) MulSub(const Reg a, const Reg b, const Reg c) noexcept
+        {
+            return Sub(Mul(a, b), c);
+        }
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle(const Reg a) noexcept
+        {
+            return Reg{ { a.v[i0], a.v[i1], a.v[i2], a.v[i3] } };
+        }
+        template<int i0, int i1, int i2, int i3>
+        inline MATHLIB_CALL(Reg) Shuffle2(const Reg a, const Reg b) noexcept
+        {
+            return Reg{ { a.v[i0], a.v[i1], b.v[i2], b.v[i3] } };
+        }
+        inline MATHLIB_CALL(Reg) MoveFirst(const Reg a, const Reg b) noexcept
+        {
+            return Reg{ { b.v[0], a.v[1], a.v[2], a.v[3] } };
+        }
+        inline MATHLIB_CALL(float32) First(const Reg a) noexcept
+        {
+            return a.v[0];
+        }
+        inline MATHLIB_CALL(Reg) Dot2(const Reg a, const Reg b) noexcept
+        {
+            return Splat(a.v[0] * b.v[0] + a.v[1] * b.v[1]);
+        }
+        inline MATHLIB_CALL(Reg) Dot3(const Reg a, const Reg b) noexcept
+        {
+            return Splat(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]);
+        }
+        inline MATHLIB_CALL(Reg) Dot4(const Reg a, const Reg b) noexcept
+        {
+            return Splat(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]);
+        }
+        inline MATHLIB_CALL(Reg) KeepNonZero(const Reg a, const Reg s) noexcept
+        {
+            return Reg{ { s.v[0] != 0.0f ? a.v[0] : 0.0f, s.v[1] != 0.0f ? a.v[1] : 0.0f,
+                          s.v[2] != 0.0f ? a.v[2] : 0.0f, s.v[3] != 0.0f ? a.v[3] : 0.0f } };
+        }
+        template<class P>
+        inline MATHLIB_CALL(Reg) Recip(const Reg a, P) noexcept
+        {
+            return Div(Splat(1.0f), a);
+        }
+        template<class P>
+        inline MATHLIB_CALL(Reg) RecipSqrt(const Reg a, P) noexcept
+        {
+            return Div(Splat(1.0f), Sqrt(a));
+        }
+    #endif // _MATHLIB_USE_SSE, _MATHLIB_USE_VECTOR_EXT
+
+        // 以下由上面的基本运算组合而成, 所有实现共用
+
+        // 三维叉乘: r = (a.yzx * b.zxy - a.zxy * b.yzx), w分量为0
+        inline MATHLIB_CALL(Reg) Cross3(const Reg a, const Reg b) noexcept
+        {
+            return Sub(Mul(Shuffle<1, 2, 0, 3>(a), Shuffle<2, 0, 1, 3>(b)),
+                       Mul(Shuffle<2, 0, 1, 3>(a), Shuffle<1, 2, 0, 3>(b)));
+        }
+        // 把r0, r1, r2, r3看作4x4矩阵的4行(或4列), 原地转置
+        inline MATHLIB_CALL(void) Transpose(Reg &r0, Reg &r1, Reg &r2, Reg &r3) noexcept
+        {
+            const Reg t0 = Shuffle2<0, 1, 0, 1>(r0, r1);           // (r00, r01, r10, r11)
+            const Reg t1 = Shuffle2<0, 1, 0, 1>(r2, r3);           // (r20, r21, r30, r31)
+            const Reg t2 = Shuffle2<2, 3, 2, 3>(r0, r1);           // (r02, r03, r12, r13)
+            const Reg t3 = Shuffle2<2, 3, 2, 3>(r2, r3);           // (r22, r23, r32, r33)
+            r0 = Shuffle2<0, 2, 0, 2>(t0, t1);
+            r1 = Shuffle2<1, 3, 1, 3>(t0, t1);
+            r2 = Shuffle2<0, 2, 0, 2>(t2, t3);
+            r3 = Shuffle2<1, 3, 1, 3>(t2, t3);
+        }
+    }
+}
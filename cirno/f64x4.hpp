@@ -0,0 +1,220 @@
+﻿/*
+ | Cirno
+ | 文件名称: f64x4.hpp
+ | 文件作用: 4个float64的寄存器运算(SSE2, AVX)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 4个float64的寄存器运算, 供双精度类型(Vector3d, Vector4d, Quaterniond, Matrix4d)使用
+    // 定义_MATHLIB_USE_SSE时使用两个__m128d(SSE2), 编译选项再打开AVX(-mavx)时使用一个__m256d, 否则是普通数组
+    // Reg只用于运算, 双精度类型按float64[4]存储, 用Load/Store(不要求对齐)读写
+    namespace f64x4
+    {
+    #if defined(_MATHLIB_USE_SSE) && defined(__AVX__)
+        using Reg = __m256d;
+
+        inline Reg Set(float64 x, float64 y, float64 z, float64 w) noexcept
+        {
+            return _mm256_setr_pd(x, y, z, w);
+        }
+        inline Reg Splat(float64 v) noexcept
+        {
+            return _mm256_set1_pd(v);
+        }
+        inline Reg Load(const float64 *p) noexcept
+        {
+            return _mm256_loadu_pd(p);
+        }
+        inline void Store(const Reg a, float64 *p) noexcept
+        {
+            _mm256_storeu_pd(p, a);
+        }
+        inline Reg Add(const Reg a, const Reg b) noexcept { return _mm256_add_pd(a, b); }
+        inline Reg Sub(const Reg a, const Reg b) noexcept { return _mm256_sub_pd(a, b); }
+        inline Reg Mul(const Reg a, const Reg b) noexcept { return _mm256_mul_pd(a, b); }
+        inline Reg Div(const Reg a, const Reg b) noexcept { return _mm256_div_pd(a, b); }
+        // a * b + c(有FMA时融合)
+        inline Reg MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+        #if defined(__FMA__)
+            return _mm256_fmadd_pd(a, b, c);
+        #else
+            return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+        #endif // __FMA__
+        }
+        // a[0] + a[1] + a[2] + a[3]
+        inline float64 Sum4(const Reg a) noexcept
+        {
+            const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));  // (x + z, y + w)
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+        // a[0] * b[0] + a[1] * b[1] + a[2] * b[2], 不读取第4个分量
+        inline float64 Dot3(const Reg a, const Reg b) noexcept
+        {
+            return Sum4(_mm256_blend_pd(_mm256_mul_pd(a, b), _mm256_setzero_pd(), 0x8));
+        }
+        inline float64 Dot4(const Reg a, const Reg b) noexcept
+        {
+            return Sum4(_mm256_mul_pd(a, b));
+        }
+        // 转为4个float32
+        inline f32x4::Reg ToFloat(const Reg a) noexcept
+        {
+            return _mm256_cvtpd_ps(a);
+        }
+        // 转为4个float32写入p
+        inline void StoreFloat(const Reg a, float32 *p) noexcept
+        {
+            _mm_storeu_ps(p, ToFloat(a));
+        }
+    #elif defined(_MATHLIB_USE_SSE)
+        struct Reg
+        {
+            __m128d lo, hi;                                 // lo = (x, y), hi = (z, w)
+        };
+
+        inline Reg Set(float64 x, float64 y, float64 z, float64 w) noexcept
+        {
+            return Reg{ _mm_setr_pd(x, y), _mm_setr_pd(z, w) };
+        }
+        inline Reg Splat(float64 v) noexcept
+        {
+            const __m128d t = _mm_set1_pd(v);
+            return Reg{ t, t };
+        }
+        inline Reg Load(const float64 *p) noexcept
+        {
+            return Reg{ _mm_loadu_pd(p), _mm_loadu_pd(p + 2) };
+        }
+        inline void Store(const Reg a, float64 *p) noexcept
+        {
+            _mm_storeu_pd(p, a.lo);
+            _mm_storeu_pd(p + 2, a.hi);
+        }
+        inline Reg Add(const Reg a, const Reg b) noexcept { return Reg{ _mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi) }; }
+        inline Reg Sub(const Reg a, const Reg b) noexcept { return Reg{ _mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi) }; }
+        inline Reg Mul(const Reg a, const Reg b) noexcept { return Reg{ _mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi) }; }
+        inline Reg Div(const Reg a, const Reg b) noexcept { return Reg{ _mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi) }; }
+        // a * b + c(有FMA时融合)
+        inline Reg MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+        #if defined(__FMA__)
+            return Reg{ _mm_fmadd_pd(a.lo, b.lo, c.lo), _mm_fmadd_pd(a.hi, b.hi, c.hi) };
+        #else
+            return Add(Mul(a, b), c);
+        #endif // __FMA__
+        }
+        // a[0] + a[1] + a[2] + a[3]
+        inline float64 Sum4(const Reg a) noexcept
+        {
+            const __m128d s = _mm_add_pd(a.lo, a.hi);       // (x + z, y + w)
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+        // a[0] * b[0] + a[1] * b[1] + a[2] * b[2], 不读取第4个分量
+        inline float64 Dot3(const Reg a, const Reg b) noexcept
+        {
+            const __m128d lo = _mm_mul_pd(a.lo, b.lo);
+            const __m128d s = _mm_add_sd(lo, _mm_mul_sd(a.hi, b.hi));   // (x + z, y)
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+        inline float64 Dot4(const Reg a, const Reg b) noexcept
+        {
+            return Sum4(Mul(a, b));
+        }
+        // 转为4个float32
+        inline f32x4::Reg ToFloat(const Reg a) noexcept
+        {
+            return _mm_movelh_ps(_mm_cvtpd_ps(a.lo), _mm_cvtpd_ps(a.hi));
+        }
+        // 转为4个float32写入p
+        inline void StoreFloat(const Reg a, float32 *p) noexcept
+        {
+            _mm_storeu_ps(p, ToFloat(a));
+        }
+    #else
+        struct Reg
+        {
+            float64 v[4];
+        };
+
+        inline Reg Set(float64 x, float64 y, float64 z, float64 w) noexcept
+        {
+            return Reg{ { x, y, z, w } };
+        }
+        inline Reg Splat(float64 v) noexcept
+        {
+            return Reg{ { v, v, v, v } };
+        }
+        inline Reg Load(const float64 *p) noexcept
+        {
+            return Reg{ { p[0], p[1], p[2], p[3] } };
+        }
+        inline void Store(const Reg a, float64 *p) noexcept
+        {
+            p[0] = a.v[0];
+            p[1] = a.v[1];
+            p[2] = a.v[2];
+            p[3] = a.v[3];
+        }
+        inline Reg Add(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+        inline Reg Sub(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+        inline Reg Mul(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+        inline Reg Div(const Reg a, const Reg b) noexcept { return Reg{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+        inline Reg MulAdd(const Reg a, const Reg b, const Reg c) noexcept
+        {
+            return Add(Mul(a, b), c);
+        }
+        inline float64 Sum4(const Reg a) noexcept
+        {
+            return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]);
+        }
+        inline float64 Dot3(const Reg a, const Reg b) noexcept
+        {
+            return (a.v[0] * b.v[0] + a.v[2] * b.v[2]) + a.v[1] * b.v[1];
+        }
+        inline float64 Dot4(const Reg a, const Reg b) noexcept
+        {
+            return Sum4(Mul(a, b));
+        }
+        inline f32x4::Reg ToFloat(const Reg a) noexcept
+        {
+            return f32x4::Set(static_cast<float32>(a.v[0]), static_cast<float32>(a.v[1]), static_cast<float32>(a.v[2]), static_cast<float32>(a.v[3]));
+        }
+        inline void StoreFloat(const Reg a, float32 *p) noexcept
+        {
+            p[0] = static_cast<float32>(a.v[0]);
+            p[1] = static_cast<float32>(a.v[1]);
+            p[2] = static_cast<float32>(a.v[2]);
+            p[3] = static_cast<float32>(a.v[3]);
+        }
+    #endif // _MATHLIB_USE_SSE, __AVX__
+    }
+}
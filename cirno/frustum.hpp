@@ -0,0 +1,218 @@
+﻿/*
+ | Cirno
+ | 文件名称: frustum.hpp
+ | 文件作用: 视锥体平面提取与可见性裁剪
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "vector4.hpp"
+#include "matrix4.hpp"
+#include "vector3stream.hpp"
+#include "kernel.hpp"
+namespace cirno
+{
+    // 视锥体, 由6个法线朝内的归一化平面(a, b, c, d)组成, 点p在内侧当且仅当(a, b, c) · p + d >= 0
+    class Frustum final
+    {
+    public:
+        // 平面编号
+        enum Plane : uint32_t
+        {
+            Left   = 0,
+            Right  = 1,
+            Bottom = 2,
+            Top    = 3,
+            Near   = 4,
+            Far    = 5,
+        };
+
+        Frustum() noexcept
+        {
+            // nothing to do
+        }
+        // 从观察投影矩阵(投影矩阵 * 观察矩阵)提取平面, 参见SetByMatrix
+        explicit Frustum(const Matrix4 &view_proj, bool zero_to_one = false) noexcept
+        {
+            SetByMatrix(view_proj, zero_to_one);
+        }
+        ~Frustum() = default;
+        Frustum(const Frustum &) = default;
+        Frustum& operator=(const Frustum &) = default;
+        // 从观察投影矩阵提取平面(Gribb-Hartmann方法), 得到的是世界空间中的平面; 只传入投影矩阵则得到观察空间中的平面
+        // zero_to_one指定裁剪空间的深度范围是[0, 1](D3D, Vulkan), 否则是[-1, 1](OpenGL, 即SetPerspectiveProject)
+        MATHLIB_CALL(Frustum&) SetByMatrix(const Matrix4 &m, bool zero_to_one = false) noexcept
+        {
+            // 按列存放, 所以第i行为(m[0][i], m[1][i], m[2][i], m[3][i]); 裁剪空间中-w <= x, y, z <= w
+            Vector4 row[4];
+            for (int i = 0; i < 4; i += 1)
+            {
+                row[i] = Vector4(m[0][i], m[1][i], m[2][i], m[3][i]);
+            }
+            planes[Left]   = row[3] + row[0];
+            planes[Right]  = row[3] - row[0];
+            planes[Bottom] = row[3] + row[1];
+            planes[Top]    = row[3] - row[1];
+            planes[Near]   = zero_to_one ? row[2] : row[3] + row[2];
+            planes[Far]    = row[3] - row[2];
+            for (auto &p : planes)
+            {
+                const float32 *v = p.GetPtr();
+                const float32 s = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                if (s != 0.0f)                                  // 长度精确为0, 不进行计算
+                {
+                    p *= 1.0f / s;
+                }
+            }
+            return *this;
+        }
+        // 取得第i个平面
+        inline const Vector4& GetPlane(uint32_t i) const noexcept
+        {
+            assert(i < 6);
+            return planes[i];
+        }
+        // 球体是否(部分)在视锥体内
+        MATHLIB_CALL(bool) IsSphereVisible(const Vector3 center, const float32 radius) const noexcept
+        {
+            for (const auto &p : planes)
+            {
+                const float32 *v = p.GetPtr();
+                if (v[0] * center.X() + v[1] * center.Y() + v[2] * center.Z() + v[3] < -radius)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        // AABB(中心, 半边长)是否(部分)在视锥体内, 保守测试: 可能把视锥体角落附近的少数不可见的包围盒判为可见
+        MATHLIB_CALL(bool) IsBoxVisible(const Vector3 center, const Vector3 extents) const noexcept
+        {
+            for (const auto &p : planes)
+            {
+                const float32 *v = p.GetPtr();
+                const float32 d = v[0] * center.X() + v[1] * center.Y() + v[2] * center.Z() + v[3];
+                const float32 r = fabsf(v[0]) * extents.X() + fabsf(v[1]) * extents.Y() + fabsf(v[2]) * extents.Z();
+                if (d + r < 0.0f)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        // 批量裁剪球体(SoA), 可见物体的下标按顺序写入visible(至少n个元素), 返回可见物体的个数
+        // last_plane(可选, n个元素, 初始化为0xff)记录拒绝每个物体的平面, 下一帧先用它测试: 连续Width个物体都被同一个平面拒绝时跳过其余平面;
+        // 物体按空间位置排列时有效, 随机排列时记录的开销可能超过收益
+        size_t CullSpheres(const float32 *x, const float32 *y, const float32 *z, const float32 *radius, size_t n,
+                           uint32_t *visible, uint8_t *last_plane = nullptr) const noexcept
+        {
+            size_t count = 0;
+            MATHLIB_DISPATCH(FrustumCullSpheres, planes[0].GetPtr(), x, y, z, radius, n, visible, last_plane, count);
+            return count;
+        }
+        // 批量裁剪球体, radius有centers.Size()个元素
+        size_t CullSpheres(const Vector3Stream &centers, const float32 *radius, uint32_t *visible, uint8_t *last_plane = nullptr) const noexcept
+        {
+            return CullSpheres(centers.XPtr(), centers.YPtr(), centers.ZPtr(), radius, centers.Size(), visible, last_plane);
+        }
+        // 批量裁剪AABB(SoA, 中心和半边长), 参见CullSpheres
+        size_t CullBoxes(const float32 *cx, const float32 *cy, const float32 *cz, const float32 *ex, const float32 *ey, const float32 *ez, size_t n,
+                         uint32_t *visible, uint8_t *last_plane = nullptr) const noexcept
+        {
+            size_t count = 0;
+            MATHLIB_DISPATCH(FrustumCullBoxes, planes[0].GetPtr(), cx, cy, cz, ex, ey, ez, n, visible, last_plane, count);
+            return count;
+        }
+        // 批量裁剪AABB, centers和extents的元素个数必须相同
+        size_t CullBoxes(const Vector3Stream &centers, const Vector3Stream &extents, uint32_t *visible, uint8_t *last_plane = nullptr) const noexcept
+        {
+            assert(centers.Size() == extents.Size());
+            return CullBoxes(centers.XPtr(), centers.YPtr(), centers.ZPtr(), extents.XPtr(), extents.YPtr(), extents.ZPtr(), centers.Size(), visible, last_plane);
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量裁剪球体, 分块后在pool中并行计算, 结果与CullSpheres相同(下标按顺序排列)
+        size_t CullSpheres(ThreadPool &pool, const float32 *x, const float32 *y, const float32 *z, const float32 *radius, size_t n,
+                           uint32_t *visible, uint8_t *last_plane = nullptr) const
+        {
+            return ParallelCull(pool, n, visible, [&](size_t b, size_t e, size_t &count) {
+                MATHLIB_DISPATCH(FrustumCullSpheres, planes[0].GetPtr(), x + b, y + b, z + b, radius + b, e - b,
+                                 visible + b, last_plane != nullptr ? last_plane + b : nullptr, count);
+            });
+        }
+        // 批量裁剪球体, 分块后在pool中并行计算
+        size_t CullSpheres(ThreadPool &pool, const Vector3Stream &centers, const float32 *radius, uint32_t *visible, uint8_t *last_plane = nullptr) const
+        {
+            return CullSpheres(pool, centers.XPtr(), centers.YPtr(), centers.ZPtr(), radius, centers.Size(), visible, last_plane);
+        }
+        // 批量裁剪AABB, 分块后在pool中并行计算, 结果与CullBoxes相同
+        size_t CullBoxes(ThreadPool &pool, const float32 *cx, const float32 *cy, const float32 *cz, const float32 *ex, const float32 *ey, const float32 *ez, size_t n,
+                         uint32_t *visible, uint8_t *last_plane = nullptr) const
+        {
+            return ParallelCull(pool, n, visible, [&](size_t b, size_t e, size_t &count) {
+                MATHLIB_DISPATCH(FrustumCullBoxes, planes[0].GetPtr(), cx + b, cy + b, cz + b, ex + b, ey + b, ez + b, e - b,
+                                 visible + b, last_plane != nullptr ? last_plane + b : nullptr, count);
+            });
+        }
+        // 批量裁剪AABB, 分块后在pool中并行计算
+        size_t CullBoxes(ThreadPool &pool, const Vector3Stream &centers, const Vector3Stream &extents, uint32_t *visible, uint8_t *last_plane = nullptr) const
+        {
+            assert(centers.Size() == extents.Size());
+            return CullBoxes(pool, centers.XPtr(), centers.YPtr(), centers.ZPtr(), extents.XPtr(), extents.YPtr(), extents.ZPtr(), centers.Size(), visible, last_plane);
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+    private:
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 并行裁剪: 每一块的可见下标先写入visible中这一块自己的范围(相对于块的起点), 全部完成后按块的顺序移到前面并加上起点
+        // 移动的目标位置不超过这一块的起点, 所以按顺序移动不会覆盖还没有移动的块
+        template<class F>
+        static size_t ParallelCull(ThreadPool &pool, size_t n, uint32_t *visible, const F &cull)
+        {
+            const size_t grain = pool.Grain(n, ThreadPool::MinGrain, Vector3Stream::Alignment);
+            const size_t chunks = (n + grain - 1) / grain;
+            std::vector<size_t> counts(chunks, 0);
+            pool.For(0, n, grain, [&](size_t b, size_t e) {
+                cull(b, e, counts[b / grain]);
+            });
+            size_t total = 0;
+            for (size_t k = 0; k < chunks; k += 1)
+            {
+                const size_t b = k * grain;
+                for (size_t i = 0; i < counts[k]; i += 1)
+                {
+                    visible[total + i] = visible[b + i] + static_cast<uint32_t>(b);
+                }
+                total += counts[k];
+            }
+            return total;
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+
+        Vector4 planes[6];                                  // 按Plane的顺序排列
+    };
+}
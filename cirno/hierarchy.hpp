@@ -0,0 +1,303 @@
+﻿/*
+ | Cirno
+ | 文件名称: hierarchy.hpp
+ | 文件作用: 变换层次结构(按深度排列的扁平数组, 逐层计算世界矩阵)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "quater.hpp"
+#include "matrix4.hpp"
+#include "kernel.hpp"
+#include "allocator.hpp"
+namespace cirno
+{
+    // 变换层次结构: 每个节点有一个父节点(或没有), 世界矩阵 = 父节点的世界矩阵 * 本地矩阵
+    // 节点按深度排列在扁平数组中(同一层的兄弟节点相邻), Update时逐层计算, 层内用SIMD内核, 较宽的层再分块交给线程池(定义了_MATHLIB_USE_PARALLEL时);
+    // 只重新计算本地矩阵被修改过的节点及其子树
+    class TransformHierarchy final
+    {
+    public:
+        // 节点编号, 由AddNode返回, 不随内部排列变化
+        using NodeId = uint32_t;
+        // 没有父节点
+        static const NodeId NoParent = 0xffffffffu;
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 一个层至少有这么多节点时才分块并行计算, 每块至少有这么多节点
+        static const size_t ParallelGrain = 2048;
+    #endif // _MATHLIB_USE_PARALLEL
+
+        TransformHierarchy() : rebuild(false), changed(false)
+        {
+            // nothing to do
+        }
+        ~TransformHierarchy() = default;
+        TransformHierarchy(const TransformHierarchy &) = default;
+        TransformHierarchy& operator=(const TransformHierarchy &) = default;
+        // 预留空间
+        void Reserve(size_t n)
+        {
+            local.reserve(n);
+            world.reserve(n);
+            parent.reserve(n);
+            dirty.reserve(n);
+            update.reserve(n);
+            id_to_index.reserve(n);
+            index_to_id.reserve(n);
+        }
+        // 清空所有节点
+        void Clear() noexcept
+        {
+            local.clear();
+            world.clear();
+            parent.clear();
+            dirty.clear();
+            update.clear();
+            id_to_index.clear();
+            index_to_id.clear();
+            level_begin.clear();
+            rebuild = false;
+            changed = false;
+        }
+        // 添加一个节点, 父节点必须已经存在(因此不会出现环); 本地矩阵初始为单位矩阵
+        NodeId AddNode(NodeId parent_id = NoParent, const Matrix4 &local_matrix = Matrix4())
+        {
+            assert(parent_id == NoParent || parent_id < id_to_index.size());
+            const NodeId id = static_cast<NodeId>(id_to_index.size());
+            const uint32_t index = static_cast<uint32_t>(local.size());
+
+            local.push_back(local_matrix);
+            world.push_back(local_matrix);
+            uint32_t parent_index = NoParent;
+            if (parent_id != NoParent)
+            {
+                parent_index = id_to_index[parent_id];
+            }
+            parent.push_back(parent_index);
+            dirty.push_back(1);
+            update.push_back(0);
+            id_to_index.push_back(index);
+            index_to_id.push_back(id);
+
+            rebuild = true;                                 // 新节点排在最后, 下次Update时重新按深度排列
+            changed = true;
+            return id;
+        }
+        // 节点个数
+        inline size_t Size() const noexcept
+        {
+            return local.size();
+        }
+        // 取得父节点, 没有时返回NoParent
+        NodeId GetParent(NodeId id) const noexcept
+        {
+            const uint32_t p = parent[id_to_index[id]];
+            return p == NoParent ? NoParent : index_to_id[p];
+        }
+        // 设置本地矩阵
+        void SetLocal(NodeId id, const Matrix4 &m) noexcept
+        {
+            const uint32_t i = id_to_index[id];
+            local[i] = m;
+            dirty[i] = 1;
+            changed = true;
+        }
+        // 用平移, 旋转(归一化的四元数), 缩放设置本地矩阵: local = T * R * S
+        void SetLocal(NodeId id, const Vector3 t, const Quaternion r, const Vector3 s) noexcept
+        {
+            SetLocal(id, Matrix4::FromTRS(t, r, s));
+        }
+        // 取得本地矩阵
+        const Matrix4& GetLocal(NodeId id) const noexcept
+        {
+            return local[id_to_index[id]];
+        }
+        // 取得世界矩阵, 本地矩阵修改后需要先调用Update
+        const Matrix4& GetWorld(NodeId id) const noexcept
+        {
+            return world[id_to_index[id]];
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 计算所有需要更新的世界矩阵, 在默认线程池中计算, threads为最多使用的线程数(包括调用者), 0表示不限制
+        void Update(size_t threads = 0)
+        {
+            Update(ThreadPool::Default(), threads);
+        }
+        // 计算所有需要更新的世界矩阵, 较宽的层在pool中并行计算, threads的含义同上
+        void Update(ThreadPool &pool, size_t threads = 0)
+        {
+            UpdateLevels([&](size_t begin, size_t end) {
+                size_t grain = pool.Grain(end - begin, ParallelGrain);
+                if (threads != 0)
+                {
+                    const size_t step = (end - begin + threads - 1) / threads;
+                    grain = grain > step ? grain : step;
+                }
+                pool.For(begin, end, grain, [this](size_t b, size_t e) { UpdateRange(b, e); });
+            });
+        }
+    #else
+        // 计算所有需要更新的世界矩阵, 没有定义_MATHLIB_USE_PARALLEL时在调用者的线程中逐层计算, 忽略threads
+        void Update(size_t threads = 0)
+        {
+            (void)threads;
+            UpdateLevels([this](size_t begin, size_t end) { UpdateRange(begin, end); });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+    private:
+        // 逐层计算, 每一层只依赖上一层的结果; 第1层起每一层的[begin, end)交给update_level计算
+        template<class F>
+        void UpdateLevels(const F &update_level)
+        {
+            if (rebuild)
+            {
+                Rebuild();
+            }
+            if (!changed)
+            {
+                return;
+            }
+            // 第0层都是根节点, 世界矩阵就是本地矩阵
+            const size_t roots = level_begin.size() > 1 ? level_begin[1] : 0;
+            for (size_t i = 0; i < roots; i += 1)
+            {
+                update[i] = dirty[i];
+                if (dirty[i] != 0)
+                {
+                    world[i] = local[i];
+                }
+            }
+            for (size_t level = 1; level + 1 < level_begin.size(); level += 1)
+            {
+                update_level(level_begin[level], level_begin[level + 1]);
+            }
+            std::fill(dirty.begin(), dirty.end(), static_cast<uint8_t>(0));
+            changed = false;
+        }
+        // 计算[begin, end)中的节点: 本地矩阵被修改过, 或者父节点被重新计算过
+        void UpdateRange(size_t begin, size_t end) noexcept
+        {
+            for (size_t i = begin; i < end; i += 1)
+            {
+                update[i] = dirty[i] | update[parent[i]];
+            }
+            MATHLIB_DISPATCH(MatrixMultiplyGather, world[0].DataPtr(), &parent[begin], local[begin].DataPtr(),
+                             world[begin].DataPtr(), &update[begin], end - begin);
+        }
+        // 重新按深度排列: 广度优先遍历, 所以同一层内兄弟节点相邻, 并且按父节点的顺序排列
+        void Rebuild()
+        {
+            const size_t n = local.size();
+            // 按父节点统计子节点(压缩的邻接表), 子节点按添加顺序排列
+            std::vector<uint32_t> child_begin(n + 1, 0);
+            std::vector<uint32_t> children(n);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (parent[i] != NoParent)
+                {
+                    child_begin[parent[i] + 1] += 1;
+                }
+            }
+            for (size_t i = 0; i < n; i += 1)
+            {
+                child_begin[i + 1] += child_begin[i];
+            }
+            std::vector<uint32_t> fill(child_begin.begin(), child_begin.end() - 1);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (parent[i] != NoParent)
+                {
+                    children[fill[parent[i]]++] = static_cast<uint32_t>(i);
+                }
+            }
+            // order[新下标] = 旧下标
+            std::vector<uint32_t> order;
+            order.reserve(n);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (parent[i] == NoParent)
+                {
+                    order.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            level_begin.assign(1, 0);
+            size_t head = 0;
+            while (head < order.size())
+            {
+                const size_t tail = order.size();
+                level_begin.push_back(tail);
+                for (; head < tail; head += 1)
+                {
+                    const uint32_t p = order[head];
+                    order.insert(order.end(), children.begin() + child_begin[p], children.begin() + child_begin[p + 1]);
+                }
+            }
+            if (n == 0)
+            {
+                level_begin.clear();
+            }
+            // 按新顺序重新排列所有数组
+            std::vector<uint32_t> remap(n);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                remap[order[i]] = static_cast<uint32_t>(i);
+            }
+            AlignedVector<Matrix4> new_local(n), new_world(n);
+            std::vector<uint32_t> new_parent(n), new_index_to_id(n);
+            std::vector<uint8_t> new_dirty(n);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                const uint32_t k = order[i];
+                new_local[i] = local[k];
+                new_world[i] = world[k];
+                new_parent[i] = parent[k] == NoParent ? NoParent : remap[parent[k]];
+                new_dirty[i] = dirty[k];
+                new_index_to_id[i] = index_to_id[k];
+                id_to_index[index_to_id[k]] = static_cast<uint32_t>(i);
+            }
+            local.swap(new_local);
+            world.swap(new_world);
+            parent.swap(new_parent);
+            dirty.swap(new_dirty);
+            index_to_id.swap(new_index_to_id);
+            rebuild = false;
+        }
+
+        AlignedVector<Matrix4> local;                       // 本地矩阵, 按深度排列
+        AlignedVector<Matrix4> world;                       // 世界矩阵
+        std::vector<uint32_t>  parent;                      // 父节点的下标, 根节点为NoParent
+        std::vector<uint8_t>   dirty;                       // 本地矩阵是否被修改过
+        std::vector<uint8_t>   update;                      // 本次Update是否重新计算了世界矩阵
+        std::vector<uint32_t>  id_to_index;                 // 节点编号 -> 下标
+        std::vector<uint32_t>  index_to_id;                 // 下标 -> 节点编号
+        std::vector<size_t>    level_begin;                 // 第k层的节点为[level_begin[k], level_begin[k + 1])
+        bool rebuild;                                       // 是否需要重新排列
+        bool changed;                                       // 是否有本地矩阵被修改过
+    };
+}
@@ -0,0 +1,935 @@
+﻿/*
+ | Cirno
+ | 文件名称: kernel.hpp
+ | 文件作用: 批量运算内核的各指令集后端
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "cpu.hpp"
+// 每个后端都是一个命名空间cirno::kernel::<级别>, 其中定义了Pack(一组float32)和PackMask(比较结果),
+// 然后包含kernel.inl, 用同一份代码生成该指令集的全部内核.
+// 运行时分派时每个后端用#pragma target单独编译, 因此不需要-mavx2等编译选项; 只能在同一个后端内传递Pack.
+//
+// Pack的接口:
+//   Width                          每个Pack中float32的个数, 总是4的倍数
+//   LoadU(p), StoreU(p)            不要求对齐的读写
+//   Set(v), Zero()                 广播一个值
+//   Broadcast4(p)                  把p[0 .. 3]重复填满整个Pack
+//   Splat4<k>(v)                   每4个一组, 组内广播第k个元素
+//   + - * /, MulAdd(a, b, c)       a * b + c(有FMA时融合)
+//   MulSub(a, b, c)                a * b - c
+//   Sqrt, RSqrt, Rcp, Min, Max     RSqrt和Rcp是近似值(约12位以上精度)
+//   CmpNeq, CmpLt, CmpLe           得到PackMask, Select(m, a, b) = m ? a : b
+//   Bits(m)                        PackMask转为位掩码, 第k位对应第k个元素
+//   LoadTranspose4(p, stride, r)   读取Width条记录(第l条从p + stride * l开始)的前4个float32并转置, r[j]的第l个分量 = p[stride * l + j]
+//   StoreTranspose4(r, stride, p)  LoadTranspose4的逆操作
+//   GatherTranspose4(p, ofs, r)    同LoadTranspose4, 但第l条记录从p + ofs[l]开始(例如按骨骼下标读取)
+//   LoadHalf(p), StoreHalf(a, p)   读写Width个半精度浮点数(uint16_t), 舍入到最近的偶数; AVX2和AVX-512使用F16C指令
+//   LoadDoubleSub(p, o)            读取Width个float64, 在float64下减去o[0 .. Width - 1]后转为float32
+//
+// PackI(一组int32_t, 与Pack的元素个数相同)的接口, 用于量化格式的打包与解包和整数矩形:
+//   LoadU(p), StoreU(p), Set(v)
+//   + - & |, Min, Max              按元素运算(Min, Max按有符号数比较)
+//   CmpLt, Select                  有符号数比较, 得到PackMask; Select(m, a, b) = m ? a : b
+//   ShiftL<k>, ShiftR<k>           左移, 逻辑右移; ShiftRA<k>算术右移(用于符号扩展)
+//   ToInt(a), ToFloat(i)           float32与int32转换, ToInt舍入到最近的偶数
+namespace cirno
+{
+    // 表达式模板的节点(定义在expr.hpp), 内核中的求值只需要声明
+    namespace expr
+    {
+        template<class T> struct Leaf;
+        template<class S> struct StreamLeaf;
+        template<class L, class R> struct Sum;
+        template<class L, class R> struct Difference;
+        template<class E> struct Scaled;
+        template<class E> struct Negated;
+        template<class A, class C> struct MulAdd;
+        template<class A, class C> struct MulSub;
+    }
+    namespace kernel
+    {
+        // float32转为半精度(IEEE 754 binary16), 舍入到最近的偶数; 超出范围为无穷大, NaN为0x7e00
+        // 与SSE4.1后端的StoreHalf是同一个算法
+        inline uint16_t FloatToHalf(float32 f) noexcept
+        {
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            const uint32_t sign = u & 0x80000000u;
+            u ^= sign;
+            uint32_t o;
+            if (u >= 0x47800000u)                               // >= 65536(舍入后的上限), 无穷大或NaN
+            {
+                o = u > 0x7f800000u ? 0x7e00u : 0x7c00u;
+            }
+            else if (u < 0x38800000u)                           // < 2^-14, 结果是非规格化数: 加上0.5让硬件完成移位和舍入
+            {
+                float32 t;
+                memcpy(&t, &u, sizeof(t));
+                t += 0.5f;
+                memcpy(&o, &t, sizeof(o));
+                o -= 0x3f000000u;
+            }
+            else {
+                const uint32_t odd = (u >> 13) & 1u;            // 尾数被舍去部分之前的最低位, 用于舍入到偶数
+                o = (u + 0xc8000fffu + odd) >> 13;              // 指数偏移127 -> 15, 加上0x0fff舍入
+            }
+            return static_cast<uint16_t>(o | (sign >> 16));
+        }
+        // 半精度转为float32, 结果是精确的
+        inline float32 HalfToFloat(uint16_t h) noexcept
+        {
+            const uint32_t em = static_cast<uint32_t>(h & 0x7fffu) << 13;
+            float32 f;
+            memcpy(&f, &em, sizeof(f));
+            f *= 5.192296858534828e+33f;                        // 2^112: 把指数偏移15调整为127, 非规格化数同样成立
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            if ((h & 0x7fffu) >= 0x7c00u)                       // 无穷大或NaN
+            {
+                u |= 0x7f800000u;
+            }
+            u |= static_cast<uint32_t>(h & 0x8000u) << 16;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+        // 标量后端, 不使用指令集相关的代码; GCC/Clang下Pack是编译器的向量扩展(_MATHLIB_USE_VECTOR_EXT), 四则运算生成目标平台的向量指令,
+        // 其余运算按分量循环(可能被编译器自动向量化)
+        namespace scalar
+        {
+        #if defined(_MATHLIB_USE_VECTOR_EXT)
+            typedef float32 Float4 __attribute__((vector_size(16)));
+        #else
+            typedef float32 Float4[4];
+        #endif // _MATHLIB_USE_VECTOR_EXT
+            struct Pack
+            {
+                static const size_t Width = 4;
+
+                Float4 v;
+
+                static inline Pack LoadU(const float32 *p) noexcept
+                {
+                    return Pack{ { p[0], p[1], p[2], p[3] } };
+                }
+                inline void StoreU(float32 *p) const noexcept
+                {
+                    p[0] = v[0];
+                    p[1] = v[1];
+                    p[2] = v[2];
+                    p[3] = v[3];
+                }
+                static inline Pack Set(float32 a) noexcept
+                {
+                    return Pack{ { a, a, a, a } };
+                }
+                static inline Pack Zero() noexcept
+                {
+                    return Set(0.0f);
+                }
+                static inline Pack Broadcast4(const float32 *p) noexcept
+                {
+                    return LoadU(p);
+                }
+                template<int k>
+                static inline Pack Splat4(const Pack a) noexcept
+                {
+                    return Set(a.v[k]);
+                }
+            };
+            struct PackMask
+            {
+                bool m[4];
+            };
+        #define MATHLIB_SCALAR_PACK_OP(name, expr)                                  \
+            inline Pack name(const Pack a, const Pack b) noexcept                   \
+            {                                                                       \
+                Pack r;                                                             \
+                for (int i = 0; i < 4; i += 1)                                      \
+                {                                                                   \
+                    const float32 x = a.v[i], y = b.v[i];                           \
+                    r.v[i] = (expr);                                                \
+                }                                                                   \
+                return r;                                                           \
+            }
+        #define MATHLIB_SCALAR_PACK_CMP(name, expr)                                 \
+            inline PackMask name(const Pack a, const Pack b) noexcept               \
+            {                                                                       \
+                PackMask r;                                                         \
+                for (int i = 0; i < 4; i += 1)                                      \
+                {                                                                   \
+                    const float32 x = a.v[i], y = b.v[i];                           \
+                    r.m[i] = (expr);                                                \
+                }                                                                   \
+                return r;                                                           \
+            }
+        #if defined(_MATHLIB_USE_VECTOR_EXT)
+            inline Pack operator+(const Pack a, const Pack b) noexcept { return Pack{ a.v + b.v }; }
+            inline Pack operator-(const Pack a, const Pack b) noexcept { return Pack{ a.v - b.v }; }
+            inline Pack operator*(const Pack a, const Pack b) noexcept { return Pack{ a.v * b.v }; }
+            inline Pack operator/(const Pack a, const Pack b) noexcept { return Pack{ a.v / b.v }; }
+        #else
+            MATHLIB_SCALAR_PACK_OP(operator+, x + y)
+            MATHLIB_SCALAR_PACK_OP(operator-, x - y)
+            MATHLIB_SCALAR_PACK_OP(operator*, x * y)
+            MATHLIB_SCALAR_PACK_OP(operator/, x / y)
+        #endif // _MATHLIB_USE_VECTOR_EXT
+            MATHLIB_SCALAR_PACK_OP(Min, x < y ? x : y)
+            MATHLIB_SCALAR_PACK_OP(Max, x > y ? x : y)
+            MATHLIB_SCALAR_PACK_CMP(CmpNeq, x != y)
+            MATHLIB_SCALAR_PACK_CMP(CmpLt, x < y)
+            MATHLIB_SCALAR_PACK_CMP(CmpLe, x <= y)
+        #undef MATHLIB_SCALAR_PACK_OP
+        #undef MATHLIB_SCALAR_PACK_CMP
+            inline Pack MulAdd(const Pack a, const Pack b, const Pack c) noexcept
+            {
+                return a * b + c;
+            }
+            inline Pack MulSub(const Pack a, const Pack b, const Pack c) noexcept
+            {
+                return a * b - c;
+            }
+            inline Pack Sqrt(const Pack a) noexcept
+            {
+                return Pack{ { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) } };
+            }
+            inline Pack RSqrt(const Pack a) noexcept
+            {
+                return Pack::Set(1.0f) / Sqrt(a);
+            }
+            inline Pack Rcp(const Pack a) noexcept
+            {
+                return Pack::Set(1.0f) / a;
+            }
+            inline Pack Select(const PackMask m, const Pack a, const Pack b) noexcept
+            {
+                Pack r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = m.m[i] ? a.v[i] : b.v[i];
+                }
+                return r;
+            }
+            inline uint32_t Bits(const PackMask m) noexcept
+            {
+                return (m.m[0] ? 1u : 0u) | (m.m[1] ? 2u : 0u) | (m.m[2] ? 4u : 0u) | (m.m[3] ? 8u : 0u);
+            }
+            inline void LoadTranspose4(const float32 *p, size_t stride, Pack *r) noexcept
+            {
+                for (size_t j = 0; j < 4; j += 1)                   // 每个r[j]整体构造, 不逐个分量写入未初始化的Pack
+                {
+                    r[j] = Pack{ { p[j], p[stride + j], p[2 * stride + j], p[3 * stride + j] } };
+                }
+            }
+            inline void StoreTranspose4(const Pack *r, size_t stride, float32 *p) noexcept
+            {
+                for (size_t l = 0; l < 4; l += 1)
+                {
+                    for (size_t j = 0; j < 4; j += 1)
+                    {
+                        p[stride * l + j] = r[j].v[l];
+                    }
+                }
+            }
+            inline void GatherTranspose4(const float32 *p, const uint32_t *ofs, Pack *r) noexcept
+            {
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    r[j] = Pack{ { p[ofs[0] + j], p[ofs[1] + j], p[ofs[2] + j], p[ofs[3] + j] } };
+                }
+            }
+            inline Pack LoadHalf(const uint16_t *p) noexcept
+            {
+                return Pack{ { HalfToFloat(p[0]), HalfToFloat(p[1]), HalfToFloat(p[2]), HalfToFloat(p[3]) } };
+            }
+            inline void StoreHalf(const Pack a, uint16_t *p) noexcept
+            {
+                for (int i = 0; i < 4; i += 1)
+                {
+                    p[i] = FloatToHalf(a.v[i]);
+                }
+            }
+            struct PackI
+            {
+                int32_t v[4];
+
+                static inline PackI LoadU(const int32_t *p) noexcept
+                {
+                    return PackI{ { p[0], p[1], p[2], p[3] } };
+                }
+                inline void StoreU(int32_t *p) const noexcept
+                {
+                    p[0] = v[0];
+                    p[1] = v[1];
+                    p[2] = v[2];
+                    p[3] = v[3];
+                }
+                static inline PackI Set(int32_t a) noexcept
+                {
+                    return PackI{ { a, a, a, a } };
+                }
+            };
+        #define MATHLIB_SCALAR_PACKI_OP(name, expr)                                 \
+            inline PackI name(const PackI a, const PackI b) noexcept                \
+            {                                                                       \
+                PackI r;                                                            \
+                for (int i = 0; i < 4; i += 1)                                      \
+                {                                                                   \
+                    const uint32_t x = static_cast<uint32_t>(a.v[i]);               \
+                    const uint32_t y = static_cast<uint32_t>(b.v[i]);               \
+                    r.v[i] = static_cast<int32_t>(expr);                            \
+                }                                                                   \
+                return r;                                                           \
+            }
+            MATHLIB_SCALAR_PACKI_OP(operator+, x + y)
+            MATHLIB_SCALAR_PACKI_OP(operator-, x - y)
+            MATHLIB_SCALAR_PACKI_OP(operator&, x & y)
+            MATHLIB_SCALAR_PACKI_OP(operator|, x | y)
+        #undef MATHLIB_SCALAR_PACKI_OP
+            inline PackI Min(const PackI a, const PackI b) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+                }
+                return r;
+            }
+            inline PackI Max(const PackI a, const PackI b) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+                }
+                return r;
+            }
+            inline PackMask CmpLt(const PackI a, const PackI b) noexcept
+            {
+                PackMask r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.m[i] = a.v[i] < b.v[i];
+                }
+                return r;
+            }
+            inline PackI Select(const PackMask m, const PackI a, const PackI b) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = m.m[i] ? a.v[i] : b.v[i];
+                }
+                return r;
+            }
+            template<int k>
+            inline PackI ShiftL(const PackI a) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) << k);
+                }
+                return r;
+            }
+            template<int k>
+            inline PackI ShiftR(const PackI a) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) >> k);
+                }
+                return r;
+            }
+            template<int k>
+            inline PackI ShiftRA(const PackI a) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = a.v[i] >> k;                       // 有符号数右移: 主流编译器都是算术右移
+                }
+                return r;
+            }
+            inline PackI ToInt(const Pack a) noexcept
+            {
+                PackI r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = static_cast<int32_t>(nearbyintf(a.v[i]));
+                }
+                return r;
+            }
+            inline Pack ToFloat(const PackI a) noexcept
+            {
+                Pack r;
+                for (int i = 0; i < 4; i += 1)
+                {
+                    r.v[i] = static_cast<float32>(a.v[i]);
+                }
+                return r;
+            }
+            inline Pack LoadDoubleSub(const float64 *p, const float64 *o) noexcept
+            {
+                return Pack{ { static_cast<float32>(p[0] - o[0]), static_cast<float32>(p[1] - o[1]),
+                               static_cast<float32>(p[2] - o[2]), static_cast<float32>(p[3] - o[3]) } };
+            }
+
+            #include "kernel.inl"
+        }
+    #if defined(_MATHLIB_USE_DISPATCH) || defined(__SSE4_1__)
+        // SSE4.1后端, 4路
+        namespace sse41
+        {
+        #if defined(__clang__)
+            #pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+        #elif defined(__GNUC__)
+            #pragma GCC push_options
+            #pragma GCC target("sse4.1")
+        #endif // __clang__, __GNUC__
+            struct Pack
+            {
+                static const size_t Width = 4;
+
+                __m128 v;
+
+                static inline Pack LoadU(const float32 *p) noexcept
+                {
+                    return Pack{ _mm_loadu_ps(p) };
+                }
+                inline void StoreU(float32 *p) const noexcept
+                {
+                    _mm_storeu_ps(p, v);
+                }
+                static inline Pack Set(float32 a) noexcept
+                {
+                    return Pack{ _mm_set1_ps(a) };
+                }
+                static inline Pack Zero() noexcept
+                {
+                    return Pack{ _mm_setzero_ps() };
+                }
+                static inline Pack Broadcast4(const float32 *p) noexcept
+                {
+                    return Pack{ _mm_loadu_ps(p) };
+                }
+                template<int k>
+                static inline Pack Splat4(const Pack a) noexcept
+                {
+                    return Pack{ _mm_shuffle_ps(a.v, a.v, k * 0x55) };
+                }
+            };
+            struct PackMask
+            {
+                __m128 m;
+            };
+            inline Pack operator+(const Pack a, const Pack b) noexcept { return Pack{ _mm_add_ps(a.v, b.v) }; }
+            inline Pack operator-(const Pack a, const Pack b) noexcept { return Pack{ _mm_sub_ps(a.v, b.v) }; }
+            inline Pack operator*(const Pack a, const Pack b) noexcept { return Pack{ _mm_mul_ps(a.v, b.v) }; }
+            inline Pack operator/(const Pack a, const Pack b) noexcept { return Pack{ _mm_div_ps(a.v, b.v) }; }
+            inline Pack MulAdd(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) }; }
+            inline Pack MulSub(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm_sub_ps(_mm_mul_ps(a.v, b.v), c.v) }; }
+            inline Pack Sqrt(const Pack a) noexcept { return Pack{ _mm_sqrt_ps(a.v) }; }
+            inline Pack RSqrt(const Pack a) noexcept { return Pack{ _mm_rsqrt_ps(a.v) }; }
+            inline Pack Rcp(const Pack a) noexcept { return Pack{ _mm_rcp_ps(a.v) }; }
+            inline Pack Min(const Pack a, const Pack b) noexcept { return Pack{ _mm_min_ps(a.v, b.v) }; }
+            inline Pack Max(const Pack a, const Pack b) noexcept { return Pack{ _mm_max_ps(a.v, b.v) }; }
+            inline PackMask CmpNeq(const Pack a, const Pack b) noexcept { return PackMask{ _mm_cmpneq_ps(a.v, b.v) }; }
+            inline PackMask CmpLt(const Pack a, const Pack b) noexcept { return PackMask{ _mm_cmplt_ps(a.v, b.v) }; }
+            inline PackMask CmpLe(const Pack a, const Pack b) noexcept { return PackMask{ _mm_cmple_ps(a.v, b.v) }; }
+            inline Pack Select(const PackMask m, const Pack a, const Pack b) noexcept { return Pack{ _mm_blendv_ps(b.v, a.v, m.m) }; }
+            inline uint32_t Bits(const PackMask m) noexcept { return static_cast<uint32_t>(_mm_movemask_ps(m.m)); }
+            inline void LoadTranspose4(const float32 *p, size_t stride, Pack *r) noexcept
+            {
+                __m128 r0 = _mm_loadu_ps(p);
+                __m128 r1 = _mm_loadu_ps(p + stride);
+                __m128 r2 = _mm_loadu_ps(p + 2 * stride);
+                __m128 r3 = _mm_loadu_ps(p + 3 * stride);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                r[0].v = r0;
+                r[1].v = r1;
+                r[2].v = r2;
+                r[3].v = r3;
+            }
+            inline void StoreTranspose4(const Pack *r, size_t stride, float32 *p) noexcept
+            {
+                __m128 r0 = r[0].v, r1 = r[1].v, r2 = r[2].v, r3 = r[3].v;
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(p, r0);
+                _mm_storeu_ps(p + stride, r1);
+                _mm_storeu_ps(p + 2 * stride, r2);
+                _mm_storeu_ps(p + 3 * stride, r3);
+            }
+            inline void GatherTranspose4(const float32 *p, const uint32_t *ofs, Pack *r) noexcept
+            {
+                __m128 r0 = _mm_loadu_ps(p + ofs[0]);
+                __m128 r1 = _mm_loadu_ps(p + ofs[1]);
+                __m128 r2 = _mm_loadu_ps(p + ofs[2]);
+                __m128 r3 = _mm_loadu_ps(p + ofs[3]);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                r[0].v = r0;
+                r[1].v = r1;
+                r[2].v = r2;
+                r[3].v = r3;
+            }
+            struct PackI
+            {
+                __m128i v;
+
+                static inline PackI LoadU(const int32_t *p) noexcept
+                {
+                    return PackI{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+                }
+                inline void StoreU(int32_t *p) const noexcept
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+                }
+                static inline PackI Set(int32_t a) noexcept
+                {
+                    return PackI{ _mm_set1_epi32(a) };
+                }
+            };
+            inline PackI operator+(const PackI a, const PackI b) noexcept { return PackI{ _mm_add_epi32(a.v, b.v) }; }
+            inline PackI operator-(const PackI a, const PackI b) noexcept { return PackI{ _mm_sub_epi32(a.v, b.v) }; }
+            inline PackI operator&(const PackI a, const PackI b) noexcept { return PackI{ _mm_and_si128(a.v, b.v) }; }
+            inline PackI operator|(const PackI a, const PackI b) noexcept { return PackI{ _mm_or_si128(a.v, b.v) }; }
+            inline PackI Min(const PackI a, const PackI b) noexcept { return PackI{ _mm_min_epi32(a.v, b.v) }; }
+            inline PackI Max(const PackI a, const PackI b) noexcept { return PackI{ _mm_max_epi32(a.v, b.v) }; }
+            inline PackMask CmpLt(const PackI a, const PackI b) noexcept { return PackMask{ _mm_castsi128_ps(_mm_cmplt_epi32(a.v, b.v)) }; }
+            inline PackI Select(const PackMask m, const PackI a, const PackI b) noexcept
+            {
+                return PackI{ _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(b.v), _mm_castsi128_ps(a.v), m.m)) };
+            }
+            template<int k> inline PackI ShiftL(const PackI a) noexcept { return PackI{ _mm_slli_epi32(a.v, k) }; }
+            template<int k> inline PackI ShiftR(const PackI a) noexcept { return PackI{ _mm_srli_epi32(a.v, k) }; }
+            template<int k> inline PackI ShiftRA(const PackI a) noexcept { return PackI{ _mm_srai_epi32(a.v, k) }; }
+            inline PackI ToInt(const Pack a) noexcept { return PackI{ _mm_cvtps_epi32(a.v) }; }
+            inline Pack ToFloat(const PackI a) noexcept { return Pack{ _mm_cvtepi32_ps(a.v) }; }
+            // 没有F16C时用整数运算转换, 与FloatToHalf, HalfToFloat的结果相同
+            inline Pack LoadHalf(const uint16_t *p) noexcept
+            {
+                const __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+                const __m128i em = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+                const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(em, 13)), _mm_set1_ps(5.192296858534828e+33f));
+                const __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(em, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+                const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, em), 16);
+                return Pack{ _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan))) };
+            }
+            inline void StoreHalf(const Pack a, uint16_t *p) noexcept
+            {
+                const __m128i u = _mm_castps_si128(a.v);
+                const __m128i sign = _mm_and_si128(u, _mm_set1_epi32(static_cast<int32_t>(0x80000000u)));
+                const __m128i abs = _mm_xor_si128(u, sign);
+                const __m128i nan = _mm_and_si128(_mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x0200));
+                const __m128i inf_nan = _mm_or_si128(nan, _mm_set1_epi32(0x7c00));
+                const __m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), abs);
+                const __m128i sub = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), abs);
+                // 非规格化数: 加上0.5让硬件完成移位和舍入
+                const __m128i r_sub = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(abs), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+                // 规格化数: 调整指数偏移, 加上0x0fff和尾数的最低位舍入到偶数
+                const __m128i odd = _mm_and_si128(_mm_srli_epi32(abs, 13), _mm_set1_epi32(1));
+                const __m128i r_norm = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(abs, _mm_set1_epi32(static_cast<int32_t>(0xc8000fffu))), odd), 13);
+                __m128i r = _mm_blendv_epi8(r_norm, r_sub, sub);
+                r = _mm_blendv_epi8(inf_nan, r, regular);
+                r = _mm_or_si128(r, _mm_srli_epi32(sign, 16));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi32(r, r));
+            }
+            inline Pack LoadDoubleSub(const float64 *p, const float64 *o) noexcept
+            {
+                const __m128 lo = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(p), _mm_loadu_pd(o)));
+                const __m128 hi = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(p + 2), _mm_loadu_pd(o + 2)));
+                return Pack{ _mm_movelh_ps(lo, hi) };
+            }
+
+            #include "kernel.inl"
+        #if defined(__clang__)
+            #pragma clang attribute pop
+        #elif defined(__GNUC__)
+            #pragma GCC pop_options
+        #endif // __clang__, __GNUC__
+        }
+    #endif // _MATHLIB_USE_DISPATCH, __SSE4_1__
+    #if defined(_MATHLIB_USE_DISPATCH) || (defined(__AVX2__) && defined(__FMA__) && defined(__F16C__))
+        // AVX2 + FMA3 + F16C后端, 8路
+        namespace avx2
+        {
+        #if defined(__clang__)
+            #pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+        #elif defined(__GNUC__)
+            #pragma GCC push_options
+            #pragma GCC target("avx2,fma,f16c")
+        #endif // __clang__, __GNUC__
+            struct Pack
+            {
+                static const size_t Width = 8;
+
+                __m256 v;
+
+                static inline Pack LoadU(const float32 *p) noexcept
+                {
+                    return Pack{ _mm256_loadu_ps(p) };
+                }
+                inline void StoreU(float32 *p) const noexcept
+                {
+                    _mm256_storeu_ps(p, v);
+                }
+                static inline Pack Set(float32 a) noexcept
+                {
+                    return Pack{ _mm256_set1_ps(a) };
+                }
+                static inline Pack Zero() noexcept
+                {
+                    return Pack{ _mm256_setzero_ps() };
+                }
+                static inline Pack Broadcast4(const float32 *p) noexcept
+                {
+                    __m128 t = _mm_loadu_ps(p);
+                    return Pack{ _mm256_insertf128_ps(_mm256_castps128_ps256(t), t, 1) };
+                }
+                template<int k>
+                static inline Pack Splat4(const Pack a) noexcept
+                {
+                    return Pack{ _mm256_permute_ps(a.v, k * 0x55) };
+                }
+            };
+            struct PackMask
+            {
+                __m256 m;
+            };
+            inline Pack operator+(const Pack a, const Pack b) noexcept { return Pack{ _mm256_add_ps(a.v, b.v) }; }
+            inline Pack operator-(const Pack a, const Pack b) noexcept { return Pack{ _mm256_sub_ps(a.v, b.v) }; }
+            inline Pack operator*(const Pack a, const Pack b) noexcept { return Pack{ _mm256_mul_ps(a.v, b.v) }; }
+            inline Pack operator/(const Pack a, const Pack b) noexcept { return Pack{ _mm256_div_ps(a.v, b.v) }; }
+            inline Pack MulAdd(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+            inline Pack MulSub(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm256_fmsub_ps(a.v, b.v, c.v) }; }
+            inline Pack Sqrt(const Pack a) noexcept { return Pack{ _mm256_sqrt_ps(a.v) }; }
+            inline Pack RSqrt(const Pack a) noexcept { return Pack{ _mm256_rsqrt_ps(a.v) }; }
+            inline Pack Rcp(const Pack a) noexcept { return Pack{ _mm256_rcp_ps(a.v) }; }
+            inline Pack Min(const Pack a, const Pack b) noexcept { return Pack{ _mm256_min_ps(a.v, b.v) }; }
+            inline Pack Max(const Pack a, const Pack b) noexcept { return Pack{ _mm256_max_ps(a.v, b.v) }; }
+            inline PackMask CmpNeq(const Pack a, const Pack b) noexcept { return PackMask{ _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; }
+            inline PackMask CmpLt(const Pack a, const Pack b) noexcept { return PackMask{ _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+            inline PackMask CmpLe(const Pack a, const Pack b) noexcept { return PackMask{ _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+            inline Pack Select(const PackMask m, const Pack a, const Pack b) noexcept { return Pack{ _mm256_blendv_ps(b.v, a.v, m.m) }; }
+            inline uint32_t Bits(const PackMask m) noexcept { return static_cast<uint32_t>(_mm256_movemask_ps(m.m)); }
+            // 每个128位通道内做4x4转置(同_MM_TRANSPOSE4_PS)
+            inline void Transpose4InLane(__m256 &r0, __m256 &r1, __m256 &r2, __m256 &r3) noexcept
+            {
+                const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+                const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+                const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+                const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+                r0 = _mm256_shuffle_ps(t0, t2, 0x44);
+                r1 = _mm256_shuffle_ps(t0, t2, 0xee);
+                r2 = _mm256_shuffle_ps(t1, t3, 0x44);
+                r3 = _mm256_shuffle_ps(t1, t3, 0xee);
+            }
+            // 第r行 = (记录r, 记录r + 4), 通道内转置后正好按记录顺序排列
+            inline void LoadTranspose4(const float32 *p, size_t stride, Pack *r) noexcept
+            {
+                __m256 t[4];
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    t[j] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + stride * j)), _mm_loadu_ps(p + stride * (j + 4)), 1);
+                }
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    r[j].v = t[j];
+                }
+            }
+            inline void StoreTranspose4(const Pack *r, size_t stride, float32 *p) noexcept
+            {
+                __m256 t[4] = { r[0].v, r[1].v, r[2].v, r[3].v };
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    _mm_storeu_ps(p + stride * j, _mm256_castps256_ps128(t[j]));
+                    _mm_storeu_ps(p + stride * (j + 4), _mm256_extractf128_ps(t[j], 1));
+                }
+            }
+            inline void GatherTranspose4(const float32 *p, const uint32_t *ofs, Pack *r) noexcept
+            {
+                __m256 t[4];
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    t[j] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + ofs[j])), _mm_loadu_ps(p + ofs[j + 4]), 1);
+                }
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    r[j].v = t[j];
+                }
+            }
+            struct PackI
+            {
+                __m256i v;
+
+                static inline PackI LoadU(const int32_t *p) noexcept
+                {
+                    return PackI{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) };
+                }
+                inline void StoreU(int32_t *p) const noexcept
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+                }
+                static inline PackI Set(int32_t a) noexcept
+                {
+                    return PackI{ _mm256_set1_epi32(a) };
+                }
+            };
+            inline PackI operator+(const PackI a, const PackI b) noexcept { return PackI{ _mm256_add_epi32(a.v, b.v) }; }
+            inline PackI operator-(const PackI a, const PackI b) noexcept { return PackI{ _mm256_sub_epi32(a.v, b.v) }; }
+            inline PackI operator&(const PackI a, const PackI b) noexcept { return PackI{ _mm256_and_si256(a.v, b.v) }; }
+            inline PackI operator|(const PackI a, const PackI b) noexcept { return PackI{ _mm256_or_si256(a.v, b.v) }; }
+            inline PackI Min(const PackI a, const PackI b) noexcept { return PackI{ _mm256_min_epi32(a.v, b.v) }; }
+            inline PackI Max(const PackI a, const PackI b) noexcept { return PackI{ _mm256_max_epi32(a.v, b.v) }; }
+            inline PackMask CmpLt(const PackI a, const PackI b) noexcept { return PackMask{ _mm256_castsi256_ps(_mm256_cmpgt_epi32(b.v, a.v)) }; }
+            inline PackI Select(const PackMask m, const PackI a, const PackI b) noexcept
+            {
+                return PackI{ _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b.v), _mm256_castsi256_ps(a.v), m.m)) };
+            }
+            template<int k> inline PackI ShiftL(const PackI a) noexcept { return PackI{ _mm256_slli_epi32(a.v, k) }; }
+            template<int k> inline PackI ShiftR(const PackI a) noexcept { return PackI{ _mm256_srli_epi32(a.v, k) }; }
+            template<int k> inline PackI ShiftRA(const PackI a) noexcept { return PackI{ _mm256_srai_epi32(a.v, k) }; }
+            inline PackI ToInt(const Pack a) noexcept { return PackI{ _mm256_cvtps_epi32(a.v) }; }
+            inline Pack ToFloat(const PackI a) noexcept { return Pack{ _mm256_cvtepi32_ps(a.v) }; }
+            inline Pack LoadHalf(const uint16_t *p) noexcept
+            {
+                return Pack{ _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) };
+            }
+            inline void StoreHalf(const Pack a, uint16_t *p) noexcept
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(a.v, _MM_FROUND_TO_NEAREST_INT));
+            }
+            inline Pack LoadDoubleSub(const float64 *p, const float64 *o) noexcept
+            {
+                const __m128 lo = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p), _mm256_loadu_pd(o)));
+                const __m128 hi = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(p + 4), _mm256_loadu_pd(o + 4)));
+                return Pack{ _mm256_set_m128(hi, lo) };
+            }
+
+            #include "kernel.inl"
+        #if defined(__clang__)
+            #pragma clang attribute pop
+        #elif defined(__GNUC__)
+            #pragma GCC pop_options
+        #endif // __clang__, __GNUC__
+        }
+    #endif // _MATHLIB_USE_DISPATCH, __AVX2__, __FMA__, __F16C__
+    #if defined(_MATHLIB_USE_DISPATCH) || defined(__AVX512F__)
+        // AVX-512F后端, 16路
+        namespace avx512
+        {
+        #if defined(__clang__)
+            #pragma clang attribute push(__attribute__((target("avx512f,avx2,fma,f16c"))), apply_to = function)
+        #elif defined(__GNUC__)
+            #pragma GCC push_options
+            #pragma GCC target("avx512f,avx2,fma,f16c")
+        #endif // __clang__, __GNUC__
+            struct Pack
+            {
+                static const size_t Width = 16;
+
+                __m512 v;
+
+                static inline Pack LoadU(const float32 *p) noexcept
+                {
+                    return Pack{ _mm512_loadu_ps(p) };
+                }
+                inline void StoreU(float32 *p) const noexcept
+                {
+                    _mm512_storeu_ps(p, v);
+                }
+                static inline Pack Set(float32 a) noexcept
+                {
+                    return Pack{ _mm512_set1_ps(a) };
+                }
+                static inline Pack Zero() noexcept
+                {
+                    return Pack{ _mm512_setzero_ps() };
+                }
+                static inline Pack Broadcast4(const float32 *p) noexcept
+                {
+                    return Pack{ _mm512_maskz_broadcast_f32x4(0xffff, _mm_loadu_ps(p)) };
+                }
+                template<int k>
+                static inline Pack Splat4(const Pack a) noexcept
+                {
+                    return Pack{ _mm512_shuffle_ps(a.v, a.v, k * 0x55) };
+                }
+            };
+            struct PackMask
+            {
+                __mmask16 m;
+            };
+            // 注: 带全1掩码的maskz版本与普通版本生成相同的指令, 但可以避免GCC对_mm512_undefined_ps误报未初始化
+            inline Pack operator+(const Pack a, const Pack b) noexcept { return Pack{ _mm512_add_ps(a.v, b.v) }; }
+            inline Pack operator-(const Pack a, const Pack b) noexcept { return Pack{ _mm512_sub_ps(a.v, b.v) }; }
+            inline Pack operator*(const Pack a, const Pack b) noexcept { return Pack{ _mm512_mul_ps(a.v, b.v) }; }
+            inline Pack operator/(const Pack a, const Pack b) noexcept { return Pack{ _mm512_div_ps(a.v, b.v) }; }
+            inline Pack MulAdd(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+            inline Pack MulSub(const Pack a, const Pack b, const Pack c) noexcept { return Pack{ _mm512_fmsub_ps(a.v, b.v, c.v) }; }
+            inline Pack Sqrt(const Pack a) noexcept { return Pack{ _mm512_maskz_sqrt_ps(0xffff, a.v) }; }
+            inline Pack RSqrt(const Pack a) noexcept { return Pack{ _mm512_maskz_rsqrt14_ps(0xffff, a.v) }; }
+            inline Pack Rcp(const Pack a) noexcept { return Pack{ _mm512_maskz_rcp14_ps(0xffff, a.v) }; }
+            inline Pack Min(const Pack a, const Pack b) noexcept { return Pack{ _mm512_maskz_min_ps(0xffff, a.v, b.v) }; }
+            inline Pack Max(const Pack a, const Pack b) noexcept { return Pack{ _mm512_maskz_max_ps(0xffff, a.v, b.v) }; }
+            inline PackMask CmpNeq(const Pack a, const Pack b) noexcept { return PackMask{ _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ) }; }
+            inline PackMask CmpLt(const Pack a, const Pack b) noexcept { return PackMask{ _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+            inline PackMask CmpLe(const Pack a, const Pack b) noexcept { return PackMask{ _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ) }; }
+            inline Pack Select(const PackMask m, const Pack a, const Pack b) noexcept { return Pack{ _mm512_mask_blend_ps(m.m, b.v, a.v) }; }
+            inline uint32_t Bits(const PackMask m) noexcept { return static_cast<uint32_t>(m.m); }
+            // 每个128位通道内做4x4转置(同_MM_TRANSPOSE4_PS)
+            inline void Transpose4InLane(__m512 &r0, __m512 &r1, __m512 &r2, __m512 &r3) noexcept
+            {
+                const __m512 t0 = _mm512_maskz_unpacklo_ps(0xffff, r0, r1);
+                const __m512 t1 = _mm512_maskz_unpackhi_ps(0xffff, r0, r1);
+                const __m512 t2 = _mm512_maskz_unpacklo_ps(0xffff, r2, r3);
+                const __m512 t3 = _mm512_maskz_unpackhi_ps(0xffff, r2, r3);
+                r0 = _mm512_maskz_shuffle_ps(0xffff, t0, t2, 0x44);
+                r1 = _mm512_maskz_shuffle_ps(0xffff, t0, t2, 0xee);
+                r2 = _mm512_maskz_shuffle_ps(0xffff, t1, t3, 0x44);
+                r3 = _mm512_maskz_shuffle_ps(0xffff, t1, t3, 0xee);
+            }
+            // 第r行 = (记录r, r + 4, r + 8, r + 12), 通道内转置后正好按记录顺序排列
+            inline void LoadTranspose4(const float32 *p, size_t stride, Pack *r) noexcept
+            {
+                __m512 t[4];
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    __m512 v = _mm512_maskz_broadcast_f32x4(0x000f, _mm_loadu_ps(p + stride * j));
+                    v = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride * (j + 4)), 1);
+                    v = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride * (j + 8)), 2);
+                    t[j] = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride * (j + 12)), 3);
+                }
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    r[j].v = t[j];
+                }
+            }
+            inline void StoreTranspose4(const Pack *r, size_t stride, float32 *p) noexcept
+            {
+                __m512 t[4] = { r[0].v, r[1].v, r[2].v, r[3].v };
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    _mm_storeu_ps(p + stride * j, _mm512_maskz_extractf32x4_ps(0x0f, t[j], 0));
+                    _mm_storeu_ps(p + stride * (j + 4), _mm512_maskz_extractf32x4_ps(0x0f, t[j], 1));
+                    _mm_storeu_ps(p + stride * (j + 8), _mm512_maskz_extractf32x4_ps(0x0f, t[j], 2));
+                    _mm_storeu_ps(p + stride * (j + 12), _mm512_maskz_extractf32x4_ps(0x0f, t[j], 3));
+                }
+            }
+            inline void GatherTranspose4(const float32 *p, const uint32_t *ofs, Pack *r) noexcept
+            {
+                __m512 t[4];
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    __m512 v = _mm512_maskz_broadcast_f32x4(0x000f, _mm_loadu_ps(p + ofs[j]));
+                    v = _mm512_insertf32x4(v, _mm_loadu_ps(p + ofs[j + 4]), 1);
+                    v = _mm512_insertf32x4(v, _mm_loadu_ps(p + ofs[j + 8]), 2);
+                    t[j] = _mm512_insertf32x4(v, _mm_loadu_ps(p + ofs[j + 12]), 3);
+                }
+                Transpose4InLane(t[0], t[1], t[2], t[3]);
+                for (size_t j = 0; j < 4; j += 1)
+                {
+                    r[j].v = t[j];
+                }
+            }
+            struct PackI
+            {
+                __m512i v;
+
+                static inline PackI LoadU(const int32_t *p) noexcept
+                {
+                    return PackI{ _mm512_loadu_si512(p) };
+                }
+                inline void StoreU(int32_t *p) const noexcept
+                {
+                    _mm512_storeu_si512(p, v);
+                }
+                static inline PackI Set(int32_t a) noexcept
+                {
+                    return PackI{ _mm512_set1_epi32(a) };
+                }
+            };
+            inline PackI operator+(const PackI a, const PackI b) noexcept { return PackI{ _mm512_add_epi32(a.v, b.v) }; }
+            inline PackI operator-(const PackI a, const PackI b) noexcept { return PackI{ _mm512_sub_epi32(a.v, b.v) }; }
+            inline PackI operator&(const PackI a, const PackI b) noexcept { return PackI{ _mm512_and_si512(a.v, b.v) }; }
+            inline PackI operator|(const PackI a, const PackI b) noexcept { return PackI{ _mm512_or_si512(a.v, b.v) }; }
+            inline PackI Min(const PackI a, const PackI b) noexcept { return PackI{ _mm512_maskz_min_epi32(0xffff, a.v, b.v) }; }
+            inline PackI Max(const PackI a, const PackI b) noexcept { return PackI{ _mm512_maskz_max_epi32(0xffff, a.v, b.v) }; }
+            inline PackMask CmpLt(const PackI a, const PackI b) noexcept { return PackMask{ _mm512_cmplt_epi32_mask(a.v, b.v) }; }
+            inline PackI Select(const PackMask m, const PackI a, const PackI b) noexcept { return PackI{ _mm512_mask_blend_epi32(m.m, b.v, a.v) }; }
+            template<int k> inline PackI ShiftL(const PackI a) noexcept { return PackI{ _mm512_maskz_slli_epi32(0xffff, a.v, k) }; }
+            template<int k> inline PackI ShiftR(const PackI a) noexcept { return PackI{ _mm512_maskz_srli_epi32(0xffff, a.v, k) }; }
+            template<int k> inline PackI ShiftRA(const PackI a) noexcept { return PackI{ _mm512_maskz_srai_epi32(0xffff, a.v, k) }; }
+            inline PackI ToInt(const Pack a) noexcept { return PackI{ _mm512_maskz_cvtps_epi32(0xffff, a.v) }; }
+            inline Pack ToFloat(const PackI a) noexcept { return Pack{ _mm512_maskz_cvtepi32_ps(0xffff, a.v) }; }
+            inline Pack LoadHalf(const uint16_t *p) noexcept
+            {
+                return Pack{ _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) };
+            }
+            inline void StoreHalf(const Pack a, uint16_t *p) noexcept
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_maskz_cvtps_ph(0xffff, a.v, _MM_FROUND_TO_NEAREST_INT));
+            }
+            inline Pack LoadDoubleSub(const float64 *p, const float64 *o) noexcept
+            {
+                const __m256 lo = _mm512_maskz_cvtpd_ps(0xff, _mm512_sub_pd(_mm512_loadu_pd(p), _mm512_loadu_pd(o)));
+                const __m256 hi = _mm512_maskz_cvtpd_ps(0xff, _mm512_sub_pd(_mm512_loadu_pd(p + 8), _mm512_loadu_pd(o + 8)));
+                // 拼接两个__m256(按64位插入, 不需要AVX512DQ)
+                const __m512d t = _mm512_maskz_insertf64x4(0xff, _mm512_setzero_pd(), _mm256_castps_pd(lo), 0);
+                return Pack{ _mm512_castpd_ps(_mm512_maskz_insertf64x4(0xff, t, _mm256_castps_pd(hi), 1)) };
+            }
+
+            #include "kernel.inl"
+        #if defined(__clang__)
+            #pragma clang attribute pop
+        #elif defined(__GNUC__)
+            #pragma GCC pop_options
+        #endif // __clang__, __GNUC__
+        }
+    #endif // _MATHLIB_USE_DISPATCH, __AVX512F__
+    #if !defined(_MATHLIB_USE_DISPATCH)
+        // 不使用运行时分派时, 直接使用编译选项允许的最高级别
+    #if defined(__AVX512F__)
+        namespace native = avx512;
+    #elif defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+        namespace native = avx2;
+    #elif defined(__SSE4_1__)
+        namespace native = sse41;
+    #else
+        namespace native = scalar;
+    #endif // __AVX512F__, __AVX2__, __SSE4_1__
+    #endif // _MATHLIB_USE_DISPATCH
+    }
+}
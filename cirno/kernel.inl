@@ -0,0 +1,1840 @@
+﻿/*
+ | Cirno
+ | 文件名称: kernel.inl
+ | 文件作用: 批量运算内核(与指令集无关的实现)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+// 注意: 该文件由kernel.hpp在每个后端的命名空间中各包含一次, 不能加#pragma once, 也不要直接包含
+// 所有内核只接受float32指针, 不要求对齐; 凑不满一个Pack的尾部逐个计算
+
+// ---------------------------------------------------------------------------------------------
+// AoS与SoA之间的转置
+// ---------------------------------------------------------------------------------------------
+
+// 把cnt(<= Width)个连续存放的元素(每个k个float32, k <= 16)转置到k个Pack中: r[j]的第l个分量 = 第l个元素的第j个float32
+// 凑不满Width个时用pad[0 .. k - 1]补齐, 这样调用者不需要单独处理尾部
+inline void LoadLanes(const float32 *p, size_t k, size_t cnt, const float32 *pad, Pack *r) noexcept
+{
+    if (cnt == Pack::Width && k % 4 == 0)                       // 整组并且k是4的倍数时每4列用shuffle转置, 不经过临时缓冲区
+    {
+        for (size_t j = 0; j < k; j += 4)
+        {
+            LoadTranspose4(p + j, k, r + j);
+        }
+        return;
+    }
+    alignas(64) float32 t[16][Pack::Width];
+    for (size_t l = 0; l < Pack::Width; l += 1)
+    {
+        const float32 *src = l < cnt ? p + k * l : pad;
+        for (size_t j = 0; j < k; j += 1)
+        {
+            t[j][l] = src[j];
+        }
+    }
+    for (size_t j = 0; j < k; j += 1)
+    {
+        r[j] = Pack::LoadU(t[j]);
+    }
+}
+// LoadLanes的逆操作, 只写回前cnt个元素
+inline void StoreLanes(const Pack *r, size_t k, size_t cnt, float32 *p) noexcept
+{
+    if (cnt == Pack::Width && k % 4 == 0)
+    {
+        for (size_t j = 0; j < k; j += 4)
+        {
+            StoreTranspose4(r + j, k, p + j);
+        }
+        return;
+    }
+    alignas(64) float32 t[16][Pack::Width];
+    for (size_t j = 0; j < k; j += 1)
+    {
+        r[j].StoreU(t[j]);
+    }
+    for (size_t l = 0; l < cnt; l += 1)
+    {
+        for (size_t j = 0; j < k; j += 1)
+        {
+            p[k * l + j] = t[j][l];
+        }
+    }
+}
+// 读取cnt(<= Width)个float32, 不足时用pad补齐
+inline Pack LoadPartial(const float32 *p, size_t cnt, float32 pad) noexcept
+{
+    if (cnt == Pack::Width)
+    {
+        return Pack::LoadU(p);
+    }
+    Pack r;
+    LoadLanes(p, 1, cnt, &pad, &r);
+    return r;
+}
+
+// ---------------------------------------------------------------------------------------------
+// 空间向量流(SoA)
+// ---------------------------------------------------------------------------------------------
+
+// r[k] = a[k] + b[k]
+inline void StreamAdd(const float32 *a, const float32 *b, float32 *r, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        (Pack::LoadU(a + i) + Pack::LoadU(b + i)).StoreU(r + i);
+    }
+    for (; i < n; i += 1)
+    {
+        r[i] = a[i] + b[i];
+    }
+}
+// r[k] = a[k] - b[k]
+inline void StreamSub(const float32 *a, const float32 *b, float32 *r, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        (Pack::LoadU(a + i) - Pack::LoadU(b + i)).StoreU(r + i);
+    }
+    for (; i < n; i += 1)
+    {
+        r[i] = a[i] - b[i];
+    }
+}
+// r[k] = a[k] * v
+inline void StreamScale(const float32 *a, const float32 v, float32 *r, size_t n) noexcept
+{
+    const Pack t = Pack::Set(v);
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        (Pack::LoadU(a + i) * t).StoreU(r + i);
+    }
+    for (; i < n; i += 1)
+    {
+        r[i] = a[i] * v;
+    }
+}
+// out[k] = ax[k] * bx[k] + ay[k] * by[k] + az[k] * bz[k]
+inline void StreamDot(const float32 *ax, const float32 *ay, const float32 *az,
+                      const float32 *bx, const float32 *by, const float32 *bz, float32 *out, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        Pack r = Pack::LoadU(ax + i) * Pack::LoadU(bx + i);
+        r = MulAdd(Pack::LoadU(ay + i), Pack::LoadU(by + i), r);
+        r = MulAdd(Pack::LoadU(az + i), Pack::LoadU(bz + i), r);
+        r.StoreU(out + i);
+    }
+    for (; i < n; i += 1)
+    {
+        out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+    }
+}
+// out[k] = sqrt(x[k]^2 + y[k]^2 + z[k]^2)
+inline void StreamLength(const float32 *px, const float32 *py, const float32 *pz, float32 *out, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const Pack x = Pack::LoadU(px + i);
+        const Pack y = Pack::LoadU(py + i);
+        const Pack z = Pack::LoadU(pz + i);
+        Sqrt(MulAdd(z, z, MulAdd(y, y, x * x))).StoreU(out + i);
+    }
+    for (; i < n; i += 1)
+    {
+        out[i] = sqrtf(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i]);
+    }
+}
+// 原地归一化, 长度精确为0的元素保持为0
+// level为precision::*::Level: 0 = rsqrt近似, 1 = rsqrt近似加一次牛顿迭代 y = y0 * (1.5 - 0.5 * s * y0^2), 2 = 除法与平方根
+inline void StreamNormalize(float32 *px, float32 *py, float32 *pz, size_t n, int level) noexcept
+{
+    const Pack one = Pack::Set(1.0f);
+    const Pack half = Pack::Set(0.5f);
+    const Pack three_half = Pack::Set(1.5f);
+    const Pack zero = Pack::Zero();
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const Pack x = Pack::LoadU(px + i);
+        const Pack y = Pack::LoadU(py + i);
+        const Pack z = Pack::LoadU(pz + i);
+        const Pack s = MulAdd(z, z, MulAdd(y, y, x * x));
+        Pack k;
+        if (level == 0)                                         // precision::Fast
+        {
+            k = RSqrt(s);
+        }
+        else if (level == 1)                                    // precision::Refined
+        {
+            const Pack y0 = RSqrt(s);
+            k = y0 * (three_half - half * s * y0 * y0);
+        }
+        else {                                                  // precision::Exact
+            k = one / Sqrt(s);
+        }
+        k = Select(CmpNeq(s, zero), k, zero);                   // s == 0时k = 0, 避免产生inf/nan
+        (x * k).StoreU(px + i);
+        (y * k).StoreU(py + i);
+        (z * k).StoreU(pz + i);
+    }
+    for (; i < n; i += 1)
+    {
+        float32 s = sqrtf(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i]);
+        if (s != 0.0f)                                          // 长度精确为0, 不进行计算
+        {
+            s = 1.0f / s;
+            px[i] *= s;
+            py[i] *= s;
+            pz[i] *= s;
+        }
+    }
+}
+// r = a CROSSMUL b, r不能与a, b重叠
+// SoA布局下叉乘不需要shuffle:
+// r.x = a.y * b.z - a.z * b.y
+// r.y = a.z * b.x - a.x * b.z
+// r.z = a.x * b.y - a.y * b.x
+inline void StreamCross(const float32 *ax, const float32 *ay, const float32 *az,
+                        const float32 *bx, const float32 *by, const float32 *bz,
+                        float32 *rx, float32 *ry, float32 *rz, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const Pack x1 = Pack::LoadU(ax + i), y1 = Pack::LoadU(ay + i), z1 = Pack::LoadU(az + i);
+        const Pack x2 = Pack::LoadU(bx + i), y2 = Pack::LoadU(by + i), z2 = Pack::LoadU(bz + i);
+        MulSub(y1, z2, z1 * y2).StoreU(rx + i);
+        MulSub(z1, x2, x1 * z2).StoreU(ry + i);
+        MulSub(x1, y2, y1 * x2).StoreU(rz + i);
+    }
+    for (; i < n; i += 1)
+    {
+        rx[i] = ay[i] * bz[i] - az[i] * by[i];
+        ry[i] = az[i] * bx[i] - ax[i] * bz[i];
+        rz[i] = ax[i] * by[i] - ay[i] * bx[i];
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 矩阵批量运算, m是Matrix4的数据区(按列存放的16个float32)
+// ---------------------------------------------------------------------------------------------
+
+// AoS批量变换, in/out每个元素占4个float32(Vector3和Vector4的大小相同)
+// HasW: 输入的第4个分量参与计算; HasT: 输入的w视为1(点), 否则视为0(方向); Divide: 结果除以w
+// 每个Pack装Width / 4个元素, 矩阵的列重复填满整个Pack, 组内广播输入的x, y, z, w
+template<bool HasW, bool HasT, bool Divide>
+inline void TransformArrayKernel(const float32 *m, const float32 *in, float32 *out, size_t n) noexcept
+{
+    const Pack c0 = Pack::Broadcast4(m + 0);
+    const Pack c1 = Pack::Broadcast4(m + 4);
+    const Pack c2 = Pack::Broadcast4(m + 8);
+    const Pack c3 = Pack::Broadcast4(m + 12);
+    const size_t group = Pack::Width / 4;
+    const size_t full = n - n % group;                          // 整组处理的元素个数, 剩下的不到一组
+    size_t i = 0;
+    for (; i < full; i += group)
+    {
+        const Pack v = Pack::LoadU(in + 4 * i);
+        Pack r = c0 * Pack::Splat4<0>(v);
+        r = MulAdd(c1, Pack::Splat4<1>(v), r);
+        r = MulAdd(c2, Pack::Splat4<2>(v), r);
+        if (HasW)
+        {
+            r = MulAdd(c3, Pack::Splat4<3>(v), r);
+        }
+        else if (HasT)
+        {
+            r = r + c3;
+        }
+        if (Divide)
+        {
+            r = r / Pack::Splat4<3>(r);                         // r[k] = r[k] / w
+        }
+        r.StoreU(out + 4 * i);
+    }
+    for (; i < n; i += 1)
+    {
+        const float32 x = in[4 * i + 0];
+        const float32 y = in[4 * i + 1];
+        const float32 z = in[4 * i + 2];
+        const float32 w = HasW ? in[4 * i + 3] : (HasT ? 1.0f : 0.0f);
+        float32 r[4];
+        for (int k = 0; k < 4; k += 1)
+        {
+            r[k] = m[k] * x + m[4 + k] * y + m[8 + k] * z + m[12 + k] * w;
+        }
+        const float32 s = Divide ? 1.0f / r[3] : 1.0f;
+        for (int k = 0; k < 4; k += 1)
+        {
+            out[4 * i + k] = r[k] * s;
+        }
+    }
+}
+// 批量变换点: out[k] = m * (in[k], 1)
+inline void TransformPoints(const float32 *m, const float32 *in, float32 *out, size_t n, bool divide) noexcept
+{
+    if (divide)
+    {
+        TransformArrayKernel<false, true, true>(m, in, out, n);
+    }
+    else {
+        TransformArrayKernel<false, true, false>(m, in, out, n);
+    }
+}
+// 批量变换方向向量: out[k] = m * (in[k], 0)
+inline void TransformDirections(const float32 *m, const float32 *in, float32 *out, size_t n) noexcept
+{
+    TransformArrayKernel<false, false, false>(m, in, out, n);
+}
+// 批量变换齐次坐标: out[k] = m * in[k]
+inline void TransformHomogeneous(const float32 *m, const float32 *in, float32 *out, size_t n, bool divide) noexcept
+{
+    if (divide)
+    {
+        TransformArrayKernel<true, true, true>(m, in, out, n);
+    }
+    else {
+        TransformArrayKernel<true, true, false>(m, in, out, n);
+    }
+}
+// SoA批量变换, r可以就是p
+// HasT: 点(加上平移), 否则是方向向量; Divide: 结果除以w
+template<bool HasT, bool Divide>
+inline void TransformStreamKernel(const float32 *m, const float32 *px, const float32 *py, const float32 *pz,
+                                  float32 *rx, float32 *ry, float32 *rz, size_t n) noexcept
+{
+    Pack c[4][4];                                               // c[列][行], 每个元素都广播到整个Pack
+    for (int i = 0; i < 4; i += 1)
+    {
+        for (int j = 0; j < 4; j += 1)
+        {
+            c[i][j] = Pack::Set(m[4 * i + j]);
+        }
+    }
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const Pack x = Pack::LoadU(px + i);
+        const Pack y = Pack::LoadU(py + i);
+        const Pack z = Pack::LoadU(pz + i);
+        Pack r[4];
+        for (int k = 0; k < (Divide ? 4 : 3); k += 1)           // r[k] = c[0][k] * x + c[1][k] * y + c[2][k] * z (+ c[3][k])
+        {
+            Pack t = HasT ? c[3][k] : Pack::Zero();
+            t = MulAdd(c[0][k], x, t);
+            t = MulAdd(c[1][k], y, t);
+            r[k] = MulAdd(c[2][k], z, t);
+        }
+        if (Divide)
+        {
+            const Pack s = Pack::Set(1.0f) / r[3];
+            r[0] = r[0] * s;
+            r[1] = r[1] * s;
+            r[2] = r[2] * s;
+        }
+        r[0].StoreU(rx + i);
+        r[1].StoreU(ry + i);
+        r[2].StoreU(rz + i);
+    }
+    for (; i < n; i += 1)
+    {
+        const float32 x = px[i], y = py[i], z = pz[i];
+        const float32 t = HasT ? 1.0f : 0.0f;
+        float32 r0 = m[0] * x + m[4] * y + m[8] * z + m[12] * t;
+        float32 r1 = m[1] * x + m[5] * y + m[9] * z + m[13] * t;
+        float32 r2 = m[2] * x + m[6] * y + m[10] * z + m[14] * t;
+        if (Divide)
+        {
+            const float32 s = 1.0f / (m[3] * x + m[7] * y + m[11] * z + m[15] * t);
+            r0 *= s;
+            r1 *= s;
+            r2 *= s;
+        }
+        rx[i] = r0;
+        ry[i] = r1;
+        rz[i] = r2;
+    }
+}
+// SoA批量变换点
+inline void TransformStreamPoints(const float32 *m, const float32 *px, const float32 *py, const float32 *pz,
+                                  float32 *rx, float32 *ry, float32 *rz, size_t n, bool divide) noexcept
+{
+    if (divide)
+    {
+        TransformStreamKernel<true, true>(m, px, py, pz, rx, ry, rz, n);
+    }
+    else {
+        TransformStreamKernel<true, false>(m, px, py, pz, rx, ry, rz, n);
+    }
+}
+// SoA批量变换方向向量
+inline void TransformStreamDirections(const float32 *m, const float32 *px, const float32 *py, const float32 *pz,
+                                      float32 *rx, float32 *ry, float32 *rz, size_t n) noexcept
+{
+    TransformStreamKernel<false, false>(m, px, py, pz, rx, ry, rz, n);
+}
+// 一个矩阵的乘法: po = a * pb, a0 .. a3是a的4列(每列广播到Pack中的每组4个元素); po可以就是pb
+// 第i列 = Σ(pb[i列][k行] * a的第k列), 每个Pack装Width / 4列(AVX-512一次就是整个矩阵)
+inline void MatrixMultiplyBody(const Pack a0, const Pack a1, const Pack a2, const Pack a3, const float32 *pb, float32 *po) noexcept
+{
+    const size_t cnt = 16 / Pack::Width;
+    Pack r[16 / Pack::Width];
+    for (size_t c = 0; c < cnt; c += 1)
+    {
+        const Pack v = Pack::LoadU(pb + c * Pack::Width);
+        const Pack t1 = MulAdd(a1, Pack::Splat4<1>(v), a0 * Pack::Splat4<0>(v));
+        const Pack t2 = MulAdd(a3, Pack::Splat4<3>(v), a2 * Pack::Splat4<2>(v));
+        r[c] = t1 + t2;
+    }
+    for (size_t c = 0; c < cnt; c += 1)                         // 全部算完再写回
+    {
+        r[c].StoreU(po + c * Pack::Width);
+    }
+}
+// 批量矩阵乘法: out[k] = a[k] * b[k], a_step = 16时a是数组, a_step = 0时所有b[k]共用同一个a; out可以就是a或b
+inline void MatrixMultiply(const float32 *a, size_t a_step, const float32 *b, float32 *out, size_t n) noexcept
+{
+    if (n == 0)
+    {
+        return;
+    }
+    Pack a0 = Pack::Broadcast4(a + 0);
+    Pack a1 = Pack::Broadcast4(a + 4);
+    Pack a2 = Pack::Broadcast4(a + 8);
+    Pack a3 = Pack::Broadcast4(a + 12);
+    for (size_t m = 0; m < n; m += 1)
+    {
+        if (a_step != 0)
+        {
+            const float32 *pa = a + m * a_step;
+            a0 = Pack::Broadcast4(pa + 0);
+            a1 = Pack::Broadcast4(pa + 4);
+            a2 = Pack::Broadcast4(pa + 8);
+            a3 = Pack::Broadcast4(pa + 12);
+        }
+        MatrixMultiplyBody(a0, a1, a2, a3, b + 16 * m, out + 16 * m);
+    }
+}
+
+// 带下标的批量矩阵乘法: out[k] = a[index[k]] * b[k], 只计算mask[k]不为0的元素(mask为nullptr时全部计算)
+// 相邻元素的index相同时不重新读取a(例如层次结构中按父节点排列的兄弟节点); out不能与a重叠
+inline void MatrixMultiplyGather(const float32 *a, const uint32_t *index, const float32 *b, float32 *out, const uint8_t *mask, size_t n) noexcept
+{
+    const size_t cnt = 16 / Pack::Width;
+    Pack a0 = Pack::Zero(), a1 = Pack::Zero(), a2 = Pack::Zero(), a3 = Pack::Zero();
+    uint32_t last = 0xffffffffu;
+    for (size_t m = 0; m < n; m += 1)
+    {
+        if (mask != nullptr && mask[m] == 0)
+        {
+            continue;
+        }
+        if (index[m] != last)
+        {
+            last = index[m];
+            const float32 *pa = a + 16 * static_cast<size_t>(last);
+            a0 = Pack::Broadcast4(pa + 0);
+            a1 = Pack::Broadcast4(pa + 4);
+            a2 = Pack::Broadcast4(pa + 8);
+            a3 = Pack::Broadcast4(pa + 12);
+        }
+        const float32 *pb = b + 16 * m;
+        float32 *po = out + 16 * m;
+        for (size_t c = 0; c < cnt; c += 1)
+        {
+            const Pack v = Pack::LoadU(pb + c * Pack::Width);
+            const Pack t1 = MulAdd(a1, Pack::Splat4<1>(v), a0 * Pack::Splat4<0>(v));
+            const Pack t2 = MulAdd(a3, Pack::Splat4<3>(v), a2 * Pack::Splat4<2>(v));
+            (t1 + t2).StoreU(po + c * Pack::Width);
+        }
+    }
+}
+// 以下内核每次处理Width个矩阵, 先用LoadLanes转置到SoA(e[j]的第l个分量 = 第l个矩阵的第j个float32), 再逐分量计算
+// 凑不满Width个时用单位矩阵补齐
+struct MatrixLanes
+{
+    Pack e[16];
+};
+inline void LoadMatrixLanes(const float32 *m, size_t cnt, MatrixLanes &r) noexcept
+{
+    static const float32 identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+    LoadLanes(m, 16, cnt, identity, r.e);
+}
+inline void StoreMatrixLanes(const MatrixLanes &r, size_t cnt, float32 *m) noexcept
+{
+    StoreLanes(r.e, 16, cnt, m);
+}
+// 4x4矩阵求逆(余子式展开), a按行优先理解: 转置的逆等于逆的转置, 所以对按列存放的数据同样成立
+// 行列式为0的矩阵保持不变
+inline void InverseLanes(MatrixLanes &m) noexcept
+{
+    const Pack *a = m.e;
+    const Pack s0 = MulSub(a[0], a[5], a[4] * a[1]);            // 前两行的2x2子式
+    const Pack s1 = MulSub(a[0], a[6], a[4] * a[2]);
+    const Pack s2 = MulSub(a[0], a[7], a[4] * a[3]);
+    const Pack s3 = MulSub(a[1], a[6], a[5] * a[2]);
+    const Pack s4 = MulSub(a[1], a[7], a[5] * a[3]);
+    const Pack s5 = MulSub(a[2], a[7], a[6] * a[3]);
+    const Pack c5 = MulSub(a[10], a[15], a[14] * a[11]);        // 后两行的2x2子式
+    const Pack c4 = MulSub(a[9], a[15], a[13] * a[11]);
+    const Pack c3 = MulSub(a[9], a[14], a[13] * a[10]);
+    const Pack c2 = MulSub(a[8], a[15], a[12] * a[11]);
+    const Pack c1 = MulSub(a[8], a[14], a[12] * a[10]);
+    const Pack c0 = MulSub(a[8], a[13], a[12] * a[9]);
+    const Pack det = MulAdd(s0, c5, MulAdd(s2, c3, MulAdd(s3, c2, s5 * c0))) - MulAdd(s1, c4, s4 * c1);
+    const PackMask ok = CmpNeq(det, Pack::Zero());
+    const Pack k = Select(ok, Pack::Set(1.0f) / det, Pack::Zero());
+
+    Pack b[16];
+    b[0]  = MulAdd(a[5], c5, MulSub(a[7], c3, a[6] * c4));
+    b[1]  = MulSub(a[2], c4, MulAdd(a[1], c5, a[3] * c3));
+    b[2]  = MulAdd(a[13], s5, MulSub(a[15], s3, a[14] * s4));
+    b[3]  = MulSub(a[10], s4, MulAdd(a[9], s5, a[11] * s3));
+    b[4]  = MulSub(a[6], c2, MulAdd(a[4], c5, a[7] * c1));
+    b[5]  = MulAdd(a[0], c5, MulSub(a[3], c1, a[2] * c2));
+    b[6]  = MulSub(a[14], s2, MulAdd(a[12], s5, a[15] * s1));
+    b[7]  = MulAdd(a[8], s5, MulSub(a[11], s1, a[10] * s2));
+    b[8]  = MulAdd(a[4], c4, MulSub(a[7], c0, a[5] * c2));
+    b[9]  = MulSub(a[1], c2, MulAdd(a[0], c4, a[3] * c0));
+    b[10] = MulAdd(a[12], s4, MulSub(a[15], s0, a[13] * s2));
+    b[11] = MulSub(a[9], s2, MulAdd(a[8], s4, a[11] * s0));
+    b[12] = MulSub(a[5], c1, MulAdd(a[4], c3, a[6] * c0));
+    b[13] = MulAdd(a[0], c3, MulSub(a[2], c0, a[1] * c1));
+    b[14] = MulSub(a[13], s1, MulAdd(a[12], s3, a[14] * s0));
+    b[15] = MulAdd(a[8], s3, MulSub(a[10], s0, a[9] * s1));
+    for (int j = 0; j < 16; j += 1)
+    {
+        m.e[j] = Select(ok, b[j] * k, m.e[j]);
+    }
+}
+// 左上角3x3的逆按行计算: 设前三列为c0, c1, c2, 则逆矩阵的三行为(c1 × c2, c2 × c0, c0 × c1) / det
+// 结果写入r[i][j] = 逆矩阵第i行第j列, 返回是否可逆
+inline PackMask Inverse3Lanes(const MatrixLanes &m, Pack r[3][3]) noexcept
+{
+    const Pack *a = m.e;
+    r[0][0] = MulSub(a[5], a[10], a[6] * a[9]);                 // c1 × c2
+    r[0][1] = MulSub(a[6], a[8], a[4] * a[10]);
+    r[0][2] = MulSub(a[4], a[9], a[5] * a[8]);
+    r[1][0] = MulSub(a[9], a[2], a[10] * a[1]);                 // c2 × c0
+    r[1][1] = MulSub(a[10], a[0], a[8] * a[2]);
+    r[1][2] = MulSub(a[8], a[1], a[9] * a[0]);
+    r[2][0] = MulSub(a[1], a[6], a[2] * a[5]);                  // c0 × c1
+    r[2][1] = MulSub(a[2], a[4], a[0] * a[6]);
+    r[2][2] = MulSub(a[0], a[5], a[1] * a[4]);
+    const Pack det = MulAdd(a[0], r[0][0], MulAdd(a[1], r[0][1], a[2] * r[0][2]));
+    const PackMask ok = CmpNeq(det, Pack::Zero());
+    const Pack k = Select(ok, Pack::Set(1.0f) / det, Pack::Zero());
+    for (int i = 0; i < 3; i += 1)
+    {
+        for (int j = 0; j < 3; j += 1)
+        {
+            r[i][j] = r[i][j] * k;
+        }
+    }
+    return ok;
+}
+// 仿射变换求逆: [R t; 0 1]的逆为[R^-1, -R^-1 * t; 0 1], 忽略最后一行; 不可逆时保持不变
+inline void AffineInverseLanes(MatrixLanes &m) noexcept
+{
+    Pack r[3][3];
+    const PackMask ok = Inverse3Lanes(m, r);
+    const Pack t[3] = { m.e[12], m.e[13], m.e[14] };
+    const Pack zero = Pack::Zero();
+    for (int i = 0; i < 3; i += 1)
+    {
+        for (int j = 0; j < 3; j += 1)
+        {
+            m.e[4 * j + i] = Select(ok, r[i][j], m.e[4 * j + i]);
+        }
+        const Pack d = MulAdd(r[i][0], t[0], MulAdd(r[i][1], t[1], r[i][2] * t[2]));
+        m.e[12 + i] = Select(ok, zero - d, m.e[12 + i]);
+        m.e[4 * i + 3] = Select(ok, zero, m.e[4 * i + 3]);
+    }
+    m.e[15] = Select(ok, Pack::Set(1.0f), m.e[15]);
+}
+// 法线矩阵: 左上角3x3的逆的转置, 第j列就是逆矩阵的第j行; 其余部分为单位矩阵, 不可逆时保持不变
+inline void NormalMatrixLanes(MatrixLanes &m) noexcept
+{
+    Pack r[3][3];
+    const PackMask ok = Inverse3Lanes(m, r);
+    const Pack zero = Pack::Zero();
+    for (int j = 0; j < 3; j += 1)
+    {
+        for (int i = 0; i < 3; i += 1)
+        {
+            m.e[4 * j + i] = Select(ok, r[j][i], m.e[4 * j + i]);
+        }
+        m.e[4 * j + 3] = Select(ok, zero, m.e[4 * j + 3]);
+        m.e[12 + j] = Select(ok, zero, m.e[12 + j]);
+    }
+    m.e[15] = Select(ok, Pack::Set(1.0f), m.e[15]);
+}
+// 批量求逆, op: 0 = 一般矩阵, 1 = 仿射矩阵, 2 = 法线矩阵; out可以就是in
+inline void MatrixInverse(const float32 *in, float32 *out, size_t n, int op) noexcept
+{
+    MatrixLanes m;
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        LoadMatrixLanes(in + 16 * i, cnt, m);
+        switch (op)
+        {
+        case 1:
+            AffineInverseLanes(m);
+            break;
+        case 2:
+            NormalMatrixLanes(m);
+            break;
+        default:
+            InverseLanes(m);
+            break;
+        }
+        StoreMatrixLanes(m, cnt, out + 16 * i);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 四元数批量运算(插值, 旋转向量), 四元数按(a, b, c, d)连续存放
+// ---------------------------------------------------------------------------------------------
+
+// acos(x), x ∈ [-1, 1]: acos(|x|) ≈ sqrt(1 - |x|) * P(|x|), x < 0时为π - acos(|x|)
+// P是7次多项式(Abramowitz & Stegun 4.4.46), 绝对误差约2e-8
+inline Pack AcosPoly(const Pack x) noexcept
+{
+    const Pack zero = Pack::Zero();
+    const Pack ax = Max(x, zero - x);
+    Pack p = Pack::Set(-0.0012624911f);
+    p = MulAdd(p, ax, Pack::Set(0.0066700901f));
+    p = MulAdd(p, ax, Pack::Set(-0.0170881256f));
+    p = MulAdd(p, ax, Pack::Set(0.0308918810f));
+    p = MulAdd(p, ax, Pack::Set(-0.0501743046f));
+    p = MulAdd(p, ax, Pack::Set(0.0889789874f));
+    p = MulAdd(p, ax, Pack::Set(-0.2145988016f));
+    p = MulAdd(p, ax, Pack::Set(1.5707963050f));
+    const Pack r = Sqrt(Max(Pack::Set(1.0f) - ax, zero)) * p;
+    return Select(CmpLt(x, zero), Pack::Set(3.14159265f) - r, r);
+}
+// sin(x), x ∈ [-π / 2, π]: 利用sin(x) = sin(π - x)折到[-π / 2, π / 2], 再用到x^11的奇次泰勒多项式, 绝对误差约6e-8
+inline Pack SinPoly(const Pack x) noexcept
+{
+    const Pack y = Min(x, Pack::Set(3.14159265f) - x);
+    const Pack y2 = y * y;
+    Pack p = Pack::Set(-2.5052108e-8f);                         // -1 / 11!
+    p = MulAdd(p, y2, Pack::Set(2.7557319e-6f));                // 1 / 9!
+    p = MulAdd(p, y2, Pack::Set(-1.9841270e-4f));               // -1 / 7!
+    p = MulAdd(p, y2, Pack::Set(8.3333333e-3f));                // 1 / 5!
+    p = MulAdd(p, y2, Pack::Set(-1.6666667e-1f));               // -1 / 3!
+    p = MulAdd(p, y2, Pack::Set(1.0f));
+    return y * p;
+}
+// out[k] = q1[k]到q2[k]按t[k]插值后归一化; Spherical为true时是球面插值, 否则是线性插值(nlerp)
+// shortest: 点乘为负时翻转q2, 沿最短路径插值; 两者几乎重合(|cos| >= 0.9995)时球面插值退化为线性插值
+// 每次处理Width个四元数(各占一个分量), out可以就是q1或q2
+template<bool Spherical>
+inline void QuaternionLerpKernel(const float32 *q1, const float32 *q2, const float32 *t, float32 *out, size_t n, bool shortest) noexcept
+{
+    static const float32 pad_q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    static const float32 pad_t[1] = { 0.0f };
+    const Pack zero = Pack::Zero();
+    const Pack one = Pack::Set(1.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack a[4], b[4], w;
+        LoadLanes(q1 + 4 * i, 4, cnt, pad_q, a);
+        LoadLanes(q2 + 4 * i, 4, cnt, pad_q, b);
+        LoadLanes(t + i, 1, cnt, pad_t, &w);
+
+        Pack d = MulAdd(a[3], b[3], MulAdd(a[2], b[2], MulAdd(a[1], b[1], a[0] * b[0])));
+        if (shortest)
+        {
+            const PackMask neg = CmpLt(d, zero);
+            for (int k = 0; k < 4; k += 1)
+            {
+                b[k] = Select(neg, zero - b[k], b[k]);
+            }
+            d = Select(neg, zero - d, d);
+        }
+        Pack k1 = one - w;
+        Pack k2 = w;
+        if (Spherical)
+        {
+            // k1 = sin((1 - t)θ) / sinθ, k2 = sin(tθ) / sinθ, 其中θ = acos(d), sinθ = sqrt(1 - d^2)
+            const PackMask far = CmpLt(Max(d, zero - d), Pack::Set(0.9995f));
+            const Pack theta = AcosPoly(d);
+            const Pack s = Select(far, one / Sqrt(Max(one - d * d, zero)), zero);
+            k1 = Select(far, SinPoly(k1 * theta) * s, k1);
+            k2 = Select(far, SinPoly(k2 * theta) * s, k2);
+        }
+        Pack r[4];
+        for (int k = 0; k < 4; k += 1)
+        {
+            r[k] = MulAdd(a[k], k1, b[k] * k2);
+        }
+        // 归一化: 近似倒数平方根 + 一次牛顿迭代, 长度为0时保持为0
+        const Pack s = MulAdd(r[3], r[3], MulAdd(r[2], r[2], MulAdd(r[1], r[1], r[0] * r[0])));
+        const Pack y0 = RSqrt(s);
+        Pack k = y0 * (Pack::Set(1.5f) - Pack::Set(0.5f) * s * y0 * y0);
+        k = Select(CmpNeq(s, zero), k, zero);
+        for (int j = 0; j < 4; j += 1)
+        {
+            r[j] = r[j] * k;
+        }
+        StoreLanes(r, 4, cnt, out + 4 * i);
+    }
+}
+// 批量球面插值
+inline void QuaternionSlerp(const float32 *q1, const float32 *q2, const float32 *t, float32 *out, size_t n, bool shortest) noexcept
+{
+    QuaternionLerpKernel<true>(q1, q2, t, out, n, shortest);
+}
+// 批量线性插值后归一化
+inline void QuaternionNlerp(const float32 *q1, const float32 *q2, const float32 *t, float32 *out, size_t n, bool shortest) noexcept
+{
+    QuaternionLerpKernel<false>(q1, q2, t, out, n, shortest);
+}
+// 批量旋转向量: r[k] = q[k] * p[k] * q[k]^-1, q为AoS, 向量为SoA, q[k]必须是归一化的
+// u = (b, c, d), t = 2(u CROSSMUL p), r = p + a * t + u CROSSMUL t, 共18次乘法, 转换为矩阵再相乘需要更多
+// r可以就是p
+inline void QuaternionRotate(const float32 *q, const float32 *px, const float32 *py, const float32 *pz,
+                             float32 *rx, float32 *ry, float32 *rz, size_t n) noexcept
+{
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        Pack c[4];
+        LoadLanes(q + 4 * i, 4, Pack::Width, nullptr, c);
+        const Pack x = Pack::LoadU(px + i);
+        const Pack y = Pack::LoadU(py + i);
+        const Pack z = Pack::LoadU(pz + i);
+        // t = 2(u CROSSMUL p)
+        Pack tx = MulSub(c[2], z, c[3] * y);
+        Pack ty = MulSub(c[3], x, c[1] * z);
+        Pack tz = MulSub(c[1], y, c[2] * x);
+        tx = tx + tx;
+        ty = ty + ty;
+        tz = tz + tz;
+        // r = p + a * t + u CROSSMUL t
+        MulAdd(c[0], tx, x + MulSub(c[2], tz, c[3] * ty)).StoreU(rx + i);
+        MulAdd(c[0], ty, y + MulSub(c[3], tx, c[1] * tz)).StoreU(ry + i);
+        MulAdd(c[0], tz, z + MulSub(c[1], ty, c[2] * tx)).StoreU(rz + i);
+    }
+    for (; i < n; i += 1)
+    {
+        const float32 *e = q + 4 * i;
+        const float32 x = px[i], y = py[i], z = pz[i];
+        const float32 tx = 2.0f * (e[2] * z - e[3] * y);
+        const float32 ty = 2.0f * (e[3] * x - e[1] * z);
+        const float32 tz = 2.0f * (e[1] * y - e[2] * x);
+        rx[i] = x + e[0] * tx + (e[2] * tz - e[3] * ty);
+        ry[i] = y + e[0] * ty + (e[3] * tx - e[1] * tz);
+        rz[i] = z + e[0] * tz + (e[1] * ty - e[2] * tx);
+    }
+}
+// 四元数转换为旋转矩阵(列主序), 与Matrix4::SetRotateTransform(Quaternion)相同, c[0 .. 3] = (a, b, c, d) = (w, x, y, z)
+inline void RotationLanes(const Pack *c, MatrixLanes &m) noexcept
+{
+    const Pack zero = Pack::Zero();
+    const Pack one = Pack::Set(1.0f);
+    const Pack x2 = c[1] + c[1];
+    const Pack y2 = c[2] + c[2];
+    const Pack z2 = c[3] + c[3];
+    const Pack xx = c[1] * x2, yy = c[2] * y2, zz = c[3] * z2;
+    const Pack xy = c[1] * y2, xz = c[1] * z2, yz = c[2] * z2;
+    const Pack wx = c[0] * x2, wy = c[0] * y2, wz = c[0] * z2;
+    m.e[0] = one - yy - zz;                                     // 第1列
+    m.e[1] = xy + wz;
+    m.e[2] = xz - wy;
+    m.e[3] = zero;
+    m.e[4] = xy - wz;                                           // 第2列
+    m.e[5] = one - xx - zz;
+    m.e[6] = yz + wx;
+    m.e[7] = zero;
+    m.e[8] = xz + wy;                                           // 第3列
+    m.e[9] = yz - wx;
+    m.e[10] = one - xx - yy;
+    m.e[11] = zero;
+    m.e[12] = zero;                                             // 第4列
+    m.e[13] = zero;
+    m.e[14] = zero;
+    m.e[15] = one;
+}
+// 批量把四元数转换为旋转矩阵, out不能与q重叠
+inline void QuaternionToMatrix(const float32 *q, float32 *out, size_t n) noexcept
+{
+    static const float32 pad_q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack c[4];
+        LoadLanes(q + 4 * i, 4, cnt, pad_q, c);
+        MatrixLanes m;
+        RotationLanes(c, m);
+        StoreMatrixLanes(m, cnt, out + 16 * i);
+    }
+}
+// 批量由平移(SoA), 旋转(四元数), 缩放(SoA)构造矩阵: out[k] = T[k] * R[k] * S[k], out不能与输入重叠
+inline void MatrixFromTRS(const float32 *tx, const float32 *ty, const float32 *tz, const float32 *q,
+                          const float32 *sx, const float32 *sy, const float32 *sz, float32 *out, size_t n) noexcept
+{
+    static const float32 pad_q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack c[4];
+        LoadLanes(q + 4 * i, 4, cnt, pad_q, c);
+        MatrixLanes m;
+        RotationLanes(c, m);
+        const Pack s[3] = { LoadPartial(sx + i, cnt, 1.0f), LoadPartial(sy + i, cnt, 1.0f), LoadPartial(sz + i, cnt, 1.0f) };
+        for (int k = 0; k < 3; k += 1)                          // R * S: 按列缩放
+        {
+            m.e[4 * k + 0] = m.e[4 * k + 0] * s[k];
+            m.e[4 * k + 1] = m.e[4 * k + 1] * s[k];
+            m.e[4 * k + 2] = m.e[4 * k + 2] * s[k];
+        }
+        m.e[12] = LoadPartial(tx + i, cnt, 0.0f);               // 第4列是平移
+        m.e[13] = LoadPartial(ty + i, cnt, 0.0f);
+        m.e[14] = LoadPartial(tz + i, cnt, 0.0f);
+        StoreMatrixLanes(m, cnt, out + 16 * i);
+    }
+}
+// 批量分解矩阵: in[k] = T * R * S, 平移与缩放写成SoA, 旋转写成四元数; 不处理投影和切变(切变时旋转是近似的)
+// 行列式为负时把x方向的缩放取反; 某个缩放为0时该列不参与计算, 退化时旋转为单位四元数
+// 旋转矩阵到四元数使用Shepperd方法: 由trace和对角线求出4w^2, 4x^2, 4y^2, 4z^2, 只对最大的一个开方, 其他分量用非对角线元素求得, 避免除以很小的数
+inline void MatrixDecompose(const float32 *in, float32 *tx, float32 *ty, float32 *tz, float32 *q,
+                            float32 *sx, float32 *sy, float32 *sz, size_t n) noexcept
+{
+    const Pack zero = Pack::Zero();
+    const Pack one = Pack::Set(1.0f);
+    const Pack half = Pack::Set(0.5f);
+    MatrixLanes m;
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        LoadMatrixLanes(in + 16 * i, cnt, m);
+        Pack *e = m.e;                                          // e[4 * 列 + 行]
+        Pack s[3];
+        for (int k = 0; k < 3; k += 1)                          // 缩放是前三列的长度
+        {
+            s[k] = Sqrt(MulAdd(e[4 * k + 2], e[4 * k + 2], MulAdd(e[4 * k + 1], e[4 * k + 1], e[4 * k] * e[4 * k])));
+        }
+        // det = c0 DOTMUL (c1 CROSSMUL c2) < 0时是镜像, 把x方向的缩放取反
+        const Pack det = MulAdd(e[0], MulSub(e[5], e[10], e[6] * e[9]),
+                         MulAdd(e[1], MulSub(e[6], e[8], e[4] * e[10]), e[2] * MulSub(e[4], e[9], e[5] * e[8])));
+        s[0] = Select(CmpLt(det, zero), zero - s[0], s[0]);
+        for (int k = 0; k < 3; k += 1)
+        {
+            const Pack inv = Select(CmpNeq(s[k], zero), one / s[k], zero);
+            e[4 * k + 0] = e[4 * k + 0] * inv;
+            e[4 * k + 1] = e[4 * k + 1] * inv;
+            e[4 * k + 2] = e[4 * k + 2] * inv;
+        }
+        // Rrc = e[4 * c + r]
+        const Pack r00 = e[0], r11 = e[5], r22 = e[10];
+        const Pack a = e[6] - e[9];                             // R21 - R12 = 4wx
+        const Pack b = e[8] - e[2];                             // R02 - R20 = 4wy
+        const Pack c = e[1] - e[4];                             // R10 - R01 = 4wz
+        const Pack d = e[4] + e[1];                             // R01 + R10 = 4xy
+        const Pack f = e[8] + e[2];                             // R02 + R20 = 4xz
+        const Pack g = e[9] + e[6];                             // R12 + R21 = 4yz
+        const Pack t0 = one + r00 + r11 + r22;                  // 4w^2
+        const Pack t1 = one + r00 - r11 - r22;                  // 4x^2
+        const Pack t2 = one - r00 + r11 - r22;                  // 4y^2
+        const Pack t3 = one - r00 - r11 + r22;                  // 4z^2
+        // 选出最大的分量, 它 = sqrt(t) / 2 = t * h, 其他分量 = 非对角线元素 * h, h = 1 / (2 * sqrt(t))
+        Pack t = t0;
+        Pack r[4] = { t0, a, b, c };
+        PackMask sel = CmpLt(t, t1);
+        t = Select(sel, t1, t);
+        r[0] = Select(sel, a, r[0]);
+        r[1] = Select(sel, t1, r[1]);
+        r[2] = Select(sel, d, r[2]);
+        r[3] = Select(sel, f, r[3]);
+        sel = CmpLt(t, t2);
+        t = Select(sel, t2, t);
+        r[0] = Select(sel, b, r[0]);
+        r[1] = Select(sel, d, r[1]);
+        r[2] = Select(sel, t2, r[2]);
+        r[3] = Select(sel, g, r[3]);
+        sel = CmpLt(t, t3);
+        t = Select(sel, t3, t);
+        r[0] = Select(sel, c, r[0]);
+        r[1] = Select(sel, f, r[1]);
+        r[2] = Select(sel, g, r[2]);
+        r[3] = Select(sel, t3, r[3]);
+        const Pack h = half / Sqrt(Max(t, Pack::Set(1e-12f)));
+        for (int j = 0; j < 4; j += 1)
+        {
+            r[j] = r[j] * h;
+        }
+        // 有切变或缩放为0时R不是正交矩阵, 归一化后结果仍是单位四元数
+        const Pack len = MulAdd(r[3], r[3], MulAdd(r[2], r[2], MulAdd(r[1], r[1], r[0] * r[0])));
+        const Pack k = one / Sqrt(len);
+        for (int j = 0; j < 4; j += 1)
+        {
+            r[j] = r[j] * k;
+        }
+        StoreLanes(r, 4, cnt, q + 4 * i);
+        alignas(64) float32 tmp[6][Pack::Width];
+        e[12].StoreU(tmp[0]);
+        e[13].StoreU(tmp[1]);
+        e[14].StoreU(tmp[2]);
+        s[0].StoreU(tmp[3]);
+        s[1].StoreU(tmp[4]);
+        s[2].StoreU(tmp[5]);
+        float32 *dst[6] = { tx + i, ty + i, tz + i, sx + i, sy + i, sz + i };
+        for (int j = 0; j < 6; j += 1)
+        {
+            memcpy(dst[j], tmp[j], cnt * sizeof(float32));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 蒙皮, 每个顶点最多4个骨骼: joints[4 * k + j]是第k个顶点的第j个骨骼下标, weights[4 * k + j]是对应的权重
+// 不使用的骨骼权重为0(下标仍需有效, 通常为0)
+// ---------------------------------------------------------------------------------------------
+
+// 读取Width个顶点的第j个骨骼的对偶四元数, r[k]的第l个分量 = 第l个顶点的骨骼的第k个float32
+inline void GatherDualQuaternionLanes(const float32 *dq, const uint16_t *joints, size_t j, Pack *r) noexcept
+{
+    alignas(64) uint32_t ofs[Pack::Width];
+    for (size_t l = 0; l < Pack::Width; l += 1)
+    {
+        ofs[l] = 8u * joints[4 * l + j];
+    }
+    GatherTranspose4(dq, ofs, r);
+    GatherTranspose4(dq + 4, ofs, r + 4);
+}
+
+// 对Width个顶点做对偶四元数蒙皮, dq是骨骼的对偶四元数(实部a, b, c, d, 对偶部a, b, c, d, 共8个float32)
+// p, nrm, rp, rn各是3个分量的指针, nrm为nullptr时不处理法线
+// 混合: Σ(±w_j * dq_j), 与第一个骨骼的实部点乘为负时取反(q与-q表示同一个变换), 然后除以实部的长度
+// 权重全为0时实部长度为0, 结果为单位变换
+inline void DualQuaternionSkinLanes(const float32 *dq, const uint16_t *joints, const float32 *weights,
+                                    const float32 *const *p, const float32 *const *nrm,
+                                    float32 *const *rp, float32 *const *rn) noexcept
+{
+    const Pack zero = Pack::Zero();
+    Pack w[4];
+    LoadTranspose4(weights, 4, w);                              // w[j]的第l个分量 = 第l个顶点第j个骨骼的权重
+    Pack b[8], r[8];
+    GatherDualQuaternionLanes(dq, joints, 0, r);
+    const Pack r0[4] = { r[0], r[1], r[2], r[3] };              // 第一个骨骼的实部, 用于判断半球
+    for (int k = 0; k < 8; k += 1)
+    {
+        r[k] = r[k] * w[0];
+    }
+    for (size_t j = 1; j < 4; j += 1)
+    {
+        GatherDualQuaternionLanes(dq, joints, j, b);
+        const Pack d = MulAdd(b[3], r0[3], MulAdd(b[2], r0[2], MulAdd(b[1], r0[1], b[0] * r0[0])));
+        const Pack wj = Select(CmpLt(d, zero), zero - w[j], w[j]);
+        for (int k = 0; k < 8; k += 1)
+        {
+            r[k] = MulAdd(b[k], wj, r[k]);
+        }
+    }
+    const Pack len = MulAdd(r[3], r[3], MulAdd(r[2], r[2], MulAdd(r[1], r[1], r[0] * r[0])));
+    const PackMask valid = CmpNeq(len, zero);
+    const Pack inv = Select(valid, Pack::Set(1.0f) / Sqrt(len), zero);
+    for (int k = 0; k < 8; k += 1)
+    {
+        r[k] = r[k] * inv;
+    }
+    r[0] = Select(valid, r[0], Pack::Set(1.0f));
+    // 平移 = 2 * t, t = a * v' - a' * v + v CROSSMUL v', 实部为(a, v), 对偶部为(a', v')
+    Pack t[3];
+    t[0] = MulSub(r[0], r[5], r[4] * r[1]) + MulSub(r[2], r[7], r[3] * r[6]);
+    t[1] = MulSub(r[0], r[6], r[4] * r[2]) + MulSub(r[3], r[5], r[1] * r[7]);
+    t[2] = MulSub(r[0], r[7], r[4] * r[3]) + MulSub(r[1], r[6], r[2] * r[5]);
+    // 旋转: u = (b, c, d), s = 2(u CROSSMUL v), v' = v + a * s + u CROSSMUL s
+    for (int pass = 0; pass < 2; pass += 1)
+    {
+        const float32 *const *in = pass == 0 ? p : nrm;
+        float32 *const *out = pass == 0 ? rp : rn;
+        if (in == nullptr)
+        {
+            break;
+        }
+        const Pack x = Pack::LoadU(in[0]);
+        const Pack y = Pack::LoadU(in[1]);
+        const Pack z = Pack::LoadU(in[2]);
+        Pack sx = MulSub(r[2], z, r[3] * y);
+        Pack sy = MulSub(r[3], x, r[1] * z);
+        Pack sz = MulSub(r[1], y, r[2] * x);
+        sx = sx + sx;
+        sy = sy + sy;
+        sz = sz + sz;
+        Pack ox = MulAdd(r[0], sx, x + MulSub(r[2], sz, r[3] * sy));
+        Pack oy = MulAdd(r[0], sy, y + MulSub(r[3], sx, r[1] * sz));
+        Pack oz = MulAdd(r[0], sz, z + MulSub(r[1], sy, r[2] * sx));
+        if (pass == 0)
+        {
+            ox = MulAdd(t[0], Pack::Set(2.0f), ox);
+            oy = MulAdd(t[1], Pack::Set(2.0f), oy);
+            oz = MulAdd(t[2], Pack::Set(2.0f), oz);
+        }
+        ox.StoreU(out[0]);
+        oy.StoreU(out[1]);
+        oz.StoreU(out[2]);
+    }
+}
+
+// 对偶四元数蒙皮(SoA): 位置p和法线nrm(nx为nullptr时不处理)分别变换后写入rp, rn; 输出可以就是输入
+// 凑不满Width个的尾部复制到局部缓冲区, 用权重为0的顶点补齐
+inline void DualQuaternionSkin(const float32 *dq, const uint16_t *joints, const float32 *weights,
+                               const float32 *px, const float32 *py, const float32 *pz,
+                               const float32 *nx, const float32 *ny, const float32 *nz,
+                               float32 *rpx, float32 *rpy, float32 *rpz,
+                               float32 *rnx, float32 *rny, float32 *rnz, size_t n) noexcept
+{
+    const bool has_n = nx != nullptr;
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const float32 *p[3] = { px + i, py + i, pz + i };
+        float32 *rp[3] = { rpx + i, rpy + i, rpz + i };
+        if (has_n)
+        {
+            const float32 *nrm[3] = { nx + i, ny + i, nz + i };
+            float32 *rn[3] = { rnx + i, rny + i, rnz + i };
+            DualQuaternionSkinLanes(dq, joints + 4 * i, weights + 4 * i, p, nrm, rp, rn);
+        }
+        else
+        {
+            DualQuaternionSkinLanes(dq, joints + 4 * i, weights + 4 * i, p, nullptr, rp, nullptr);
+        }
+    }
+    if (i < n)
+    {
+        const size_t cnt = n - i;
+        alignas(64) float32 vtx[12][Pack::Width] = {};          // 位置, 法线, 输出位置, 输出法线
+        alignas(64) float32 w[4 * Pack::Width] = {};
+        uint16_t idx[4 * Pack::Width] = {};
+        const float32 *src[6] = { px, py, pz, nx, ny, nz };
+        for (int k = 0; k < (has_n ? 6 : 3); k += 1)
+        {
+            memcpy(vtx[k], src[k] + i, cnt * sizeof(float32));
+        }
+        memcpy(w, weights + 4 * i, 4 * cnt * sizeof(float32));
+        memcpy(idx, joints + 4 * i, 4 * cnt * sizeof(uint16_t));
+        const float32 *p[3] = { vtx[0], vtx[1], vtx[2] };
+        const float32 *nrm[3] = { vtx[3], vtx[4], vtx[5] };
+        float32 *rp[3] = { vtx[6], vtx[7], vtx[8] };
+        float32 *rn[3] = { vtx[9], vtx[10], vtx[11] };
+        DualQuaternionSkinLanes(dq, idx, w, p, has_n ? nrm : nullptr, rp, has_n ? rn : nullptr);
+        float32 *dst[6] = { rpx, rpy, rpz, rnx, rny, rnz };
+        for (int k = 0; k < (has_n ? 6 : 3); k += 1)
+        {
+            memcpy(dst[k] + i, vtx[6 + k], cnt * sizeof(float32));
+        }
+    }
+}
+
+// 对Width个顶点做线性混合蒙皮(LBS), palette是骨骼矩阵(按列存放的16个float32), 只使用前3行
+// 混合后的矩阵Σ(w_j * M_j)留在寄存器中(12个Pack), 再变换位置和法线(nrm为nullptr时不处理);
+// 法线用混合矩阵的左上角3x3变换后归一化(假设没有非均匀缩放), 长度为0时保持为0
+// 结果写入交错存放的顶点缓冲区: 第l个顶点的位置写入rp + stride * l, 法线写入rn + stride * l, 只写前cnt个
+inline void MatrixSkinLanes(const float32 *palette, const uint16_t *joints, const float32 *weights,
+                            const float32 *const *p, const float32 *const *nrm,
+                            float32 *rp, float32 *rn, size_t stride, size_t cnt) noexcept
+{
+    Pack w[4];
+    LoadTranspose4(weights, 4, w);                              // w[j]的第l个分量 = 第l个顶点第j个骨骼的权重
+    Pack m[4][3], b[4];                                         // m[列][行], 不需要第4行
+    for (size_t c = 0; c < 4; c += 1)
+    {
+        m[c][0] = m[c][1] = m[c][2] = Pack::Zero();
+    }
+    alignas(64) uint32_t ofs[Pack::Width];
+    for (size_t j = 0; j < 4; j += 1)
+    {
+        for (size_t l = 0; l < Pack::Width; l += 1)
+        {
+            ofs[l] = 16u * joints[4 * l + j];
+        }
+        for (size_t c = 0; c < 4; c += 1)
+        {
+            GatherTranspose4(palette + 4 * c, ofs, b);
+            for (size_t r = 0; r < 3; r += 1)
+            {
+                m[c][r] = MulAdd(b[r], w[j], m[c][r]);
+            }
+        }
+    }
+    alignas(64) float32 tmp[4 * Pack::Width];
+    for (int pass = 0; pass < 2; pass += 1)
+    {
+        const float32 *const *in = pass == 0 ? p : nrm;
+        float32 *out = pass == 0 ? rp : rn;
+        if (in == nullptr)
+        {
+            break;
+        }
+        const Pack x = Pack::LoadU(in[0]);
+        const Pack y = Pack::LoadU(in[1]);
+        const Pack z = Pack::LoadU(in[2]);
+        Pack r[4];
+        for (size_t k = 0; k < 3; k += 1)
+        {
+            r[k] = MulAdd(m[2][k], z, MulAdd(m[1][k], y, m[0][k] * x));
+        }
+        if (pass == 0)
+        {
+            for (size_t k = 0; k < 3; k += 1)
+            {
+                r[k] = r[k] + m[3][k];
+            }
+        }
+        else {
+            const Pack zero = Pack::Zero();
+            const Pack len = MulAdd(r[2], r[2], MulAdd(r[1], r[1], r[0] * r[0]));
+            const Pack inv = Select(CmpNeq(len, zero), Pack::Set(1.0f) / Sqrt(len), zero);
+            for (size_t k = 0; k < 3; k += 1)
+            {
+                r[k] = r[k] * inv;
+            }
+        }
+        r[3] = Pack::Zero();
+        StoreTranspose4(r, 4, tmp);                             // 先转为AoS, 再每个顶点只写3个float32, 不覆盖其他属性
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            memcpy(out + stride * l, tmp + 4 * l, 3 * sizeof(float32));
+        }
+    }
+}
+
+// 线性混合蒙皮: 位置p和法线nrm(nx为nullptr时不处理)写入交错存放的顶点缓冲区rp, rn(rn为nullptr时不写法线),
+// 相邻顶点相隔stride个float32; 凑不满Width个的尾部复制到局部缓冲区, 用权重为0的顶点补齐
+inline void MatrixSkin(const float32 *palette, const uint16_t *joints, const float32 *weights,
+                       const float32 *px, const float32 *py, const float32 *pz,
+                       const float32 *nx, const float32 *ny, const float32 *nz,
+                       float32 *rp, float32 *rn, size_t stride, size_t n) noexcept
+{
+    const bool has_n = nx != nullptr && rn != nullptr;
+    size_t i = 0;
+    for (; i + Pack::Width <= n; i += Pack::Width)
+    {
+        const float32 *p[3] = { px + i, py + i, pz + i };
+        const float32 *nrm[3] = { nx + i, ny + i, nz + i };
+        MatrixSkinLanes(palette, joints + 4 * i, weights + 4 * i, p, has_n ? nrm : nullptr,
+                        rp + stride * i, has_n ? rn + stride * i : nullptr, stride, Pack::Width);
+    }
+    if (i < n)
+    {
+        const size_t cnt = n - i;
+        alignas(64) float32 vtx[6][Pack::Width] = {};
+        alignas(64) float32 w[4 * Pack::Width] = {};
+        uint16_t idx[4 * Pack::Width] = {};
+        const float32 *src[6] = { px, py, pz, nx, ny, nz };
+        for (int k = 0; k < (has_n ? 6 : 3); k += 1)
+        {
+            memcpy(vtx[k], src[k] + i, cnt * sizeof(float32));
+        }
+        memcpy(w, weights + 4 * i, 4 * cnt * sizeof(float32));
+        memcpy(idx, joints + 4 * i, 4 * cnt * sizeof(uint16_t));
+        const float32 *p[3] = { vtx[0], vtx[1], vtx[2] };
+        const float32 *nrm[3] = { vtx[3], vtx[4], vtx[5] };
+        MatrixSkinLanes(palette, idx, w, p, has_n ? nrm : nullptr,
+                        rp + stride * i, has_n ? rn + stride * i : nullptr, stride, cnt);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 视锥体裁剪, planes是6个归一化的平面(a, b, c, d), 点在平面内侧当且仅当a * x + b * y + c * z + d >= 0
+// ---------------------------------------------------------------------------------------------
+
+// 一组平面系数, 每个都广播到整个Pack
+struct FrustumLanes
+{
+    Pack a[6], b[6], c[6], d[6];
+    Pack abs_a[6], abs_b[6], abs_c[6];
+};
+// 包围体到第p个平面的距离: 中心的有符号距离 + 包围体在法线方向上的投影半径, 小于0则完全在外侧
+// Box为false时是球体(e0为半径), 否则是AABB(e0, e1, e2为三个方向的半边长)
+template<bool Box>
+inline Pack FrustumDistance(const FrustumLanes &f, int p, const Pack x, const Pack y, const Pack z, const Pack e0, const Pack e1, const Pack e2) noexcept
+{
+    const Pack d = MulAdd(f.c[p], z, MulAdd(f.b[p], y, MulAdd(f.a[p], x, f.d[p])));
+    if (Box)
+    {
+        return d + MulAdd(f.abs_c[p], e2, MulAdd(f.abs_b[p], e1, f.abs_a[p] * e0));
+    }
+    return d + e0;
+}
+// 批量裁剪: 可见物体的下标按顺序写入visible(最多n个), 个数写入count
+// last_plane不为nullptr时记录拒绝每个物体的平面编号(可见的物体为0xff), 下一次先用它测试(时间相关性):
+// 一组Width个物体的记录相同并且都被该平面拒绝时, 跳过其余平面
+template<bool Box>
+inline void FrustumCullKernel(const float32 *planes, const float32 *cx, const float32 *cy, const float32 *cz,
+                              const float32 *e0, const float32 *e1, const float32 *e2, size_t n,
+                              uint32_t *visible, uint8_t *last_plane, size_t &count) noexcept
+{
+    FrustumLanes f;
+    for (int p = 0; p < 6; p += 1)
+    {
+        f.a[p] = Pack::Set(planes[4 * p + 0]);
+        f.b[p] = Pack::Set(planes[4 * p + 1]);
+        f.c[p] = Pack::Set(planes[4 * p + 2]);
+        f.d[p] = Pack::Set(planes[4 * p + 3]);
+        f.abs_a[p] = Pack::Set(fabsf(planes[4 * p + 0]));
+        f.abs_b[p] = Pack::Set(fabsf(planes[4 * p + 1]));
+        f.abs_c[p] = Pack::Set(fabsf(planes[4 * p + 2]));
+    }
+    const Pack zero = Pack::Zero();
+    size_t k = 0;
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        const uint32_t valid = (1u << cnt) - 1u;                // Width <= 16, 不会溢出
+        const Pack x = LoadPartial(cx + i, cnt, 0.0f);
+        const Pack y = LoadPartial(cy + i, cnt, 0.0f);
+        const Pack z = LoadPartial(cz + i, cnt, 0.0f);
+        const Pack r0 = LoadPartial(e0 + i, cnt, 0.0f);
+        const Pack r1 = Box ? LoadPartial(e1 + i, cnt, 0.0f) : zero;
+        const Pack r2 = Box ? LoadPartial(e2 + i, cnt, 0.0f) : zero;
+        if (last_plane != nullptr)
+        {
+            const uint8_t p0 = last_plane[i];
+            bool same = p0 < 6;
+            for (size_t l = 1; l < cnt && same; l += 1)
+            {
+                same = last_plane[i + l] == p0;
+            }
+            if (same && (Bits(CmpLt(FrustumDistance<Box>(f, p0, x, y, z, r0, r1, r2), zero)) & valid) == valid)
+            {
+                continue;                                       // 全部被上次的平面拒绝, 记录不变
+            }
+        }
+        Pack plane = Pack::Set(-1.0f);                          // 拒绝该物体的编号最小的平面, -1表示可见
+        for (int p = 5; p >= 0; p -= 1)
+        {
+            const PackMask out = CmpLt(FrustumDistance<Box>(f, p, x, y, z, r0, r1, r2), zero);
+            plane = Select(out, Pack::Set(static_cast<float32>(p)), plane);
+        }
+        const uint32_t bits = Bits(CmpLt(plane, zero)) & valid;
+        for (size_t l = 0; l < cnt; l += 1)                     // 无分支压缩: 总是写入, 可见时才移动位置
+        {
+            visible[k] = static_cast<uint32_t>(i + l);
+            k += (bits >> l) & 1u;
+        }
+        if (last_plane != nullptr)
+        {
+            alignas(64) float32 t[Pack::Width];
+            plane.StoreU(t);
+            for (size_t l = 0; l < cnt; l += 1)
+            {
+                last_plane[i + l] = static_cast<uint8_t>(static_cast<int32_t>(t[l]));   // -1截断后就是0xff
+            }
+        }
+    }
+    count = k;
+}
+// 批量裁剪球体, 中心(cx, cy, cz), 半径r
+inline void FrustumCullSpheres(const float32 *planes, const float32 *cx, const float32 *cy, const float32 *cz, const float32 *r,
+                               size_t n, uint32_t *visible, uint8_t *last_plane, size_t &count) noexcept
+{
+    FrustumCullKernel<false>(planes, cx, cy, cz, r, nullptr, nullptr, n, visible, last_plane, count);
+}
+// 批量裁剪AABB, 中心(cx, cy, cz), 半边长(ex, ey, ez)
+inline void FrustumCullBoxes(const float32 *planes, const float32 *cx, const float32 *cy, const float32 *cz,
+                             const float32 *ex, const float32 *ey, const float32 *ez,
+                             size_t n, uint32_t *visible, uint8_t *last_plane, size_t &count) noexcept
+{
+    FrustumCullKernel<true>(planes, cx, cy, cz, ex, ey, ez, n, visible, last_plane, count);
+}
+
+// ---------------------------------------------------------------------------------------------
+// 量化格式的打包与解包, 输入输出的Vector3, Vector4, Quaternion都按每个元素4个float32连续存放
+// ---------------------------------------------------------------------------------------------
+
+// 读取cnt(<= Width)个int32, 不足时用0补齐
+inline PackI LoadPartialI(const int32_t *p, size_t cnt) noexcept
+{
+    if (cnt == Pack::Width)
+    {
+        return PackI::LoadU(p);
+    }
+    alignas(64) int32_t t[Pack::Width] = {};
+    memcpy(t, p, cnt * sizeof(int32_t));
+    return PackI::LoadU(t);
+}
+// 只写回前cnt个int32
+inline void StorePartialI(const PackI a, size_t cnt, int32_t *p) noexcept
+{
+    if (cnt == Pack::Width)
+    {
+        a.StoreU(p);
+        return;
+    }
+    alignas(64) int32_t t[Pack::Width];
+    a.StoreU(t);
+    memcpy(p, t, cnt * sizeof(int32_t));
+}
+// |a|
+inline Pack AbsLanes(const Pack a) noexcept
+{
+    return Max(a, Pack::Zero() - a);
+}
+// 把a限制在[-1, 1]后乘以scale并舍入为整数
+inline PackI QuantizeSnorm(const Pack a, const Pack scale) noexcept
+{
+    const Pack one = Pack::Set(1.0f);
+    return ToInt(Min(Max(a, Pack::Zero() - one), one) * scale);
+}
+
+// Vector3 -> 半精度, out每个元素3个uint16_t
+inline void EncodeHalf3(const float32 *in, uint16_t *out, size_t n) noexcept
+{
+    static const float32 pad[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack r[4];
+        LoadLanes(in + 4 * i, 4, cnt, pad, r);
+        uint16_t h[3][Pack::Width];
+        for (size_t k = 0; k < 3; k += 1)
+        {
+            StoreHalf(r[k], h[k]);
+        }
+        uint16_t *o = out + 3 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            o[3 * l + 0] = h[0][l];
+            o[3 * l + 1] = h[1][l];
+            o[3 * l + 2] = h[2][l];
+        }
+    }
+}
+// 半精度 -> Vector3
+inline void DecodeHalf3(const uint16_t *in, float32 *out, size_t n) noexcept
+{
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        uint16_t h[3][Pack::Width] = {};
+        const uint16_t *s = in + 3 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            h[0][l] = s[3 * l + 0];
+            h[1][l] = s[3 * l + 1];
+            h[2][l] = s[3 * l + 2];
+        }
+        Pack r[4] = { LoadHalf(h[0]), LoadHalf(h[1]), LoadHalf(h[2]), Pack::Zero() };
+        StoreLanes(r, 4, cnt, out + 4 * i);
+    }
+}
+
+// 单位向量 -> 八面体映射, 每个元素一个uint32: 低16位是u, 高16位是v(都是snorm16)
+// 投影到八面体|x| + |y| + |z| = 1上, z < 0的一半沿对角线折叠到外侧
+inline void EncodeOctahedral(const float32 *in, uint32_t *out, size_t n) noexcept
+{
+    static const float32 pad[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+    const Pack zero = Pack::Zero();
+    const Pack one = Pack::Set(1.0f);
+    const Pack scale = Pack::Set(32767.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack r[4];
+        LoadLanes(in + 4 * i, 4, cnt, pad, r);
+        const Pack s = AbsLanes(r[0]) + AbsLanes(r[1]) + AbsLanes(r[2]);
+        const Pack inv = Select(CmpNeq(s, zero), one / s, zero);
+        const Pack x = r[0] * inv;
+        const Pack y = r[1] * inv;
+        const Pack sx = Select(CmpLt(x, zero), zero - one, one);
+        const Pack sy = Select(CmpLt(y, zero), zero - one, one);
+        const PackMask fold = CmpLt(r[2], zero);
+        const Pack u = Select(fold, (one - AbsLanes(y)) * sx, x);
+        const Pack v = Select(fold, (one - AbsLanes(x)) * sy, y);
+        const PackI e = (QuantizeSnorm(u, scale) & PackI::Set(0xffff)) | ShiftL<16>(QuantizeSnorm(v, scale));
+        StorePartialI(e, cnt, reinterpret_cast<int32_t*>(out + i));
+    }
+}
+// 八面体映射 -> 单位向量
+inline void DecodeOctahedral(const uint32_t *in, float32 *out, size_t n) noexcept
+{
+    const Pack zero = Pack::Zero();
+    const Pack one = Pack::Set(1.0f);
+    const Pack k = Pack::Set(1.0f / 32767.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        const PackI e = LoadPartialI(reinterpret_cast<const int32_t*>(in + i), cnt);
+        Pack x = Max(ToFloat(ShiftRA<16>(ShiftL<16>(e))) * k, zero - one);
+        Pack y = Max(ToFloat(ShiftRA<16>(e)) * k, zero - one);
+        const Pack z = one - AbsLanes(x) - AbsLanes(y);
+        const Pack t = Max(zero - z, zero);                     // z < 0时展开折叠的部分
+        x = Select(CmpLt(x, zero), x + t, x - t);
+        y = Select(CmpLt(y, zero), y + t, y - t);
+        const Pack len = MulAdd(z, z, MulAdd(y, y, x * x));
+        const Pack inv = one / Sqrt(len);
+        Pack r[4] = { x * inv, y * inv, z * inv, zero };
+        StoreLanes(r, 4, cnt, out + 4 * i);
+    }
+}
+
+// 10:10:10:2, 每个元素一个uint32: x, y, z各10位snorm(±511), 最高2位是w(-1, 0, 1); has_w为false时w为0
+inline void Encode1010102(const float32 *in, uint32_t *out, size_t n, bool has_w) noexcept
+{
+    static const float32 pad[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const Pack scale = Pack::Set(511.0f);
+    const PackI mask = PackI::Set(0x3ff);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack r[4];
+        LoadLanes(in + 4 * i, 4, cnt, pad, r);
+        PackI e = (QuantizeSnorm(r[0], scale) & mask) | ShiftL<10>(QuantizeSnorm(r[1], scale) & mask) | ShiftL<20>(QuantizeSnorm(r[2], scale) & mask);
+        if (has_w)
+        {
+            e = e | ShiftL<30>(QuantizeSnorm(r[3], Pack::Set(1.0f)));
+        }
+        StorePartialI(e, cnt, reinterpret_cast<int32_t*>(out + i));
+    }
+}
+// 10:10:10:2 -> Vector3(has_w为false)或Vector4
+inline void Decode1010102(const uint32_t *in, float32 *out, size_t n, bool has_w) noexcept
+{
+    const Pack k = Pack::Set(1.0f / 511.0f);
+    const Pack neg = Pack::Set(-1.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        const PackI e = LoadPartialI(reinterpret_cast<const int32_t*>(in + i), cnt);
+        Pack r[4];
+        r[0] = Max(ToFloat(ShiftRA<22>(ShiftL<22>(e))) * k, neg);     // -512也解码为-1
+        r[1] = Max(ToFloat(ShiftRA<22>(ShiftL<12>(e))) * k, neg);
+        r[2] = Max(ToFloat(ShiftRA<22>(ShiftL<2>(e))) * k, neg);
+        r[3] = has_w ? Max(ToFloat(ShiftRA<30>(e)), neg) : Pack::Zero();
+        StoreLanes(r, 4, cnt, out + 4 * i);
+    }
+}
+
+// 最小三分量(smallest three)编码的公共部分: 找出绝对值最大的分量的下标idx, 使它为正(q与-q表示同一个旋转),
+// 其余三个分量按原顺序放入c[0 .. 2], 乘以√2后在[-1, 1]内, 再按scale量化
+inline PackI SmallestThreeLanes(const Pack *q, const Pack scale, PackI *c) noexcept
+{
+    const Pack zero = Pack::Zero();
+    Pack best = AbsLanes(q[0]), big = q[0], idx = zero;
+    for (int k = 1; k < 4; k += 1)
+    {
+        const PackMask m = CmpLt(best, AbsLanes(q[k]));
+        best = Select(m, AbsLanes(q[k]), best);
+        big = Select(m, q[k], big);
+        idx = Select(m, Pack::Set(static_cast<float32>(k)), idx);
+    }
+    const Pack s = Select(CmpLt(big, zero), Pack::Set(-1.41421356f), Pack::Set(1.41421356f));
+    for (int j = 0; j < 3; j += 1)
+    {
+        const Pack v = Select(CmpLt(Pack::Set(static_cast<float32>(j)), idx), q[j], q[j + 1]);
+        c[j] = QuantizeSnorm(v * s, scale);
+    }
+    return ToInt(idx);
+}
+// 最小三分量解码的公共部分: c[0 .. 2]是乘以1 / (scale * √2)之前的整数, 最大的分量由单位长度求得
+inline void SmallestThreeDecodeLanes(const PackI *c, const PackI idx, const Pack scale, Pack *q) noexcept
+{
+    const Pack zero = Pack::Zero();
+    const Pack k = Pack::Set(0.70710678f) / scale;
+    Pack f[3];
+    for (int j = 0; j < 3; j += 1)
+    {
+        f[j] = ToFloat(c[j]) * k;
+    }
+    const Pack d = Sqrt(Max(Pack::Set(1.0f) - MulAdd(f[2], f[2], MulAdd(f[1], f[1], f[0] * f[0])), zero));
+    const Pack fi = ToFloat(idx);
+    for (int j = 0; j < 4; j += 1)
+    {
+        const Pack pj = Pack::Set(static_cast<float32>(j));
+        const Pack after = j < 3 ? f[j] : d;                    // idx > j: 第j个分量还没有被跳过
+        const Pack before = j > 0 ? f[j - 1] : d;               // idx < j: 第j个分量存放在前一个位置
+        q[j] = Select(CmpLt(pj, fi), after, Select(CmpLt(fi, pj), before, d));
+    }
+}
+// Quaternion -> 48位(3个uint16_t): 每个分量15位, 下标的两位放在前两个uint16_t的最高位
+inline void EncodeQuaternion48(const float32 *in, uint16_t *out, size_t n) noexcept
+{
+    static const float32 pad[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    const Pack scale = Pack::Set(16383.0f);
+    const PackI mask = PackI::Set(0x7fff);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack q[4];
+        LoadLanes(in + 4 * i, 4, cnt, pad, q);
+        PackI c[3];
+        const PackI idx = SmallestThreeLanes(q, scale, c);
+        alignas(64) int32_t t[3][Pack::Width];
+        ((c[0] & mask) | ShiftL<15>(idx & PackI::Set(1))).StoreU(t[0]);
+        ((c[1] & mask) | ShiftL<14>(idx & PackI::Set(2))).StoreU(t[1]);
+        (c[2] & mask).StoreU(t[2]);
+        uint16_t *o = out + 3 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            o[3 * l + 0] = static_cast<uint16_t>(t[0][l]);
+            o[3 * l + 1] = static_cast<uint16_t>(t[1][l]);
+            o[3 * l + 2] = static_cast<uint16_t>(t[2][l]);
+        }
+    }
+}
+// 48位 -> Quaternion
+inline void DecodeQuaternion48(const uint16_t *in, float32 *out, size_t n) noexcept
+{
+    const Pack scale = Pack::Set(16383.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        alignas(64) int32_t t[3][Pack::Width] = {};
+        const uint16_t *s = in + 3 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            t[0][l] = s[3 * l + 0];
+            t[1][l] = s[3 * l + 1];
+            t[2][l] = s[3 * l + 2];
+        }
+        const PackI e[3] = { PackI::LoadU(t[0]), PackI::LoadU(t[1]), PackI::LoadU(t[2]) };
+        const PackI c[3] = { ShiftRA<17>(ShiftL<17>(e[0])), ShiftRA<17>(ShiftL<17>(e[1])), ShiftRA<17>(ShiftL<17>(e[2])) };
+        const PackI idx = ShiftR<15>(e[0]) | ShiftR<14>(e[1] & PackI::Set(0x8000));
+        Pack q[4];
+        SmallestThreeDecodeLanes(c, idx, scale, q);
+        StoreLanes(q, 4, cnt, out + 4 * i);
+    }
+}
+// Quaternion -> 64位(2个uint32_t): 每个分量20位, 第1个uint32_t = c0 | c1的低12位 << 20,
+// 第2个uint32_t = c1的高8位 | c2 << 8 | idx << 28
+inline void EncodeQuaternion64(const float32 *in, uint32_t *out, size_t n) noexcept
+{
+    static const float32 pad[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    const Pack scale = Pack::Set(524287.0f);
+    const PackI mask = PackI::Set(0xfffff);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        Pack q[4];
+        LoadLanes(in + 4 * i, 4, cnt, pad, q);
+        PackI c[3];
+        const PackI idx = SmallestThreeLanes(q, scale, c);
+        alignas(64) int32_t t[2][Pack::Width];
+        ((c[0] & mask) | ShiftL<20>(c[1])).StoreU(t[0]);
+        ((ShiftR<12>(c[1]) & PackI::Set(0xff)) | ShiftL<8>(c[2] & mask) | ShiftL<28>(idx)).StoreU(t[1]);
+        uint32_t *o = out + 2 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            o[2 * l + 0] = static_cast<uint32_t>(t[0][l]);
+            o[2 * l + 1] = static_cast<uint32_t>(t[1][l]);
+        }
+    }
+}
+// 64位 -> Quaternion
+inline void DecodeQuaternion64(const uint32_t *in, float32 *out, size_t n) noexcept
+{
+    const Pack scale = Pack::Set(524287.0f);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        alignas(64) int32_t t[2][Pack::Width] = {};
+        const uint32_t *s = in + 2 * i;
+        for (size_t l = 0; l < cnt; l += 1)
+        {
+            t[0][l] = static_cast<int32_t>(s[2 * l + 0]);
+            t[1][l] = static_cast<int32_t>(s[2 * l + 1]);
+        }
+        const PackI e0 = PackI::LoadU(t[0]);
+        const PackI e1 = PackI::LoadU(t[1]);
+        const PackI c1 = ShiftR<20>(e0) | ShiftL<12>(e1 & PackI::Set(0xff));
+        const PackI c[3] = { ShiftRA<12>(ShiftL<12>(e0)), ShiftRA<12>(ShiftL<12>(c1)), ShiftRA<12>(ShiftL<4>(e1)) };
+        Pack q[4];
+        SmallestThreeDecodeLanes(c, ShiftR<28>(e1) & PackI::Set(3), scale, q);
+        StoreLanes(q, 4, cnt, out + 4 * i);
+    }
+}
+
+// float64 -> float32, 用于把大世界坐标转换为相对于摄像机的坐标再上传渲染
+// 每条记录stride个float64(4: Vector3d, 16: Matrix4d), 先在float64下减去origin[0 .. stride - 1]再转换, 不损失精度
+inline void ConvertRelative(const float64 *in, const float64 *origin, size_t stride, float32 *out, size_t n) noexcept
+{
+    assert(stride == 4 || stride == 8 || stride == 16);
+    alignas(64) float64 o[32];                                  // origin重复填满, stride和Pack::Width都整除16, 从o + k % 16读Width个不越界
+    for (size_t k = 0; k < 32; k += 1)
+    {
+        o[k] = origin[k % stride];
+    }
+    const size_t total = n * stride;
+    size_t k = 0;
+    for (; k + Pack::Width <= total; k += Pack::Width)
+    {
+        LoadDoubleSub(in + k, o + k % 16).StoreU(out + k);
+    }
+    if (k < total)                                              // 剩余不足Width个(4的倍数), 补齐后转换再写回
+    {
+        alignas(64) float64 t[Pack::Width] = {};
+        memcpy(t, in + k, (total - k) * sizeof(float64));
+        alignas(64) float32 r[Pack::Width];
+        LoadDoubleSub(t, o + k % 16).StoreU(r);
+        memcpy(out + k, r, (total - k) * sizeof(float32));
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 表达式模板(expr.hpp)的求值
+// ---------------------------------------------------------------------------------------------
+
+// 表达式在第c个分量, 第i .. i + Width - 1个元素处的值; 节点都是逐分量的, 第c个分量只读取各个操作数的第c个分量
+struct ExprEval
+{
+    template<class T>
+    static inline Pack At(const expr::Leaf<T> &e, size_t c, size_t) noexcept
+    {
+        return Pack::Set(e.v[c]);                               // 单个向量广播到每个元素
+    }
+    template<class S>
+    static inline Pack At(const expr::StreamLeaf<S> &e, size_t c, size_t i) noexcept
+    {
+        return Pack::LoadU(e.p[c] + i);
+    }
+    template<class L, class R>
+    static inline Pack At(const expr::Sum<L, R> &e, size_t c, size_t i) noexcept
+    {
+        return At(e.l, c, i) + At(e.r, c, i);
+    }
+    template<class L, class R>
+    static inline Pack At(const expr::Difference<L, R> &e, size_t c, size_t i) noexcept
+    {
+        return At(e.l, c, i) - At(e.r, c, i);
+    }
+    template<class E>
+    static inline Pack At(const expr::Scaled<E> &e, size_t c, size_t i) noexcept
+    {
+        return At(e.e, c, i) * Pack::Set(e.s);
+    }
+    template<class E>
+    static inline Pack At(const expr::Negated<E> &e, size_t c, size_t i) noexcept
+    {
+        return At(e.e, c, i) * Pack::Set(-1.0f);                // 乘以-1, 与单个值的求值一样保留0的符号
+    }
+    template<class A, class C>
+    static inline Pack At(const expr::MulAdd<A, C> &e, size_t c, size_t i) noexcept
+    {
+        return MulAdd(At(e.a, c, i), Pack::Set(e.s), At(e.c, c, i));
+    }
+    template<class A, class C>
+    static inline Pack At(const expr::MulSub<A, C> &e, size_t c, size_t i) noexcept
+    {
+        return MulSub(At(e.a, c, i), Pack::Set(e.s), At(e.c, c, i));
+    }
+};
+// 流表达式求值: 在同一个循环中计算第[begin, end)个元素的x, y, z三个分量, begin和end是Width的倍数(流按16个元素填充)
+// 逐元素计算, 每个元素先读后写, 因此输出可以同时出现在表达式中
+template<class E>
+inline void EvalExpr(const E &e, float32 *x, float32 *y, float32 *z, size_t begin, size_t end) noexcept
+{
+    for (size_t i = begin; i < end; i += Pack::Width)
+    {
+        const Pack rx = ExprEval::At(e, 0, i);
+        const Pack ry = ExprEval::At(e, 1, i);
+        const Pack rz = ExprEval::At(e, 2, i);
+        rx.StoreU(x + i);
+        ry.StoreU(y + i);
+        rz.StoreU(z + i);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// 矩形(rect.hpp)的批量运算: left, right, top, bottom分别存放(SoA), float32和int32_t使用同一份代码
+// 空矩形(left >= right或top >= bottom)不与任何矩形相交, 也不包含任何点
+// ---------------------------------------------------------------------------------------------
+
+// 读取cnt(<= Width)个分量, 不足时用0补齐(补齐的元素是空矩形)
+inline Pack LoadRectLanes(const float32 *p, size_t cnt) noexcept
+{
+    return LoadPartial(p, cnt, 0.0f);
+}
+inline PackI LoadRectLanes(const int32_t *p, size_t cnt) noexcept
+{
+    return LoadPartialI(p, cnt);
+}
+// 只写回前cnt个分量
+inline void StoreRectLanes(const Pack a, size_t cnt, float32 *p) noexcept
+{
+    if (cnt == Pack::Width)
+    {
+        a.StoreU(p);
+        return;
+    }
+    alignas(64) float32 t[Pack::Width];
+    a.StoreU(t);
+    memcpy(p, t, cnt * sizeof(float32));
+}
+inline void StoreRectLanes(const PackI a, size_t cnt, int32_t *p) noexcept
+{
+    StorePartialI(a, cnt, p);
+}
+// 批量测试: 满足条件的矩形的下标按顺序写入hits(最多n个), 个数写入count
+// Mode 0: 与q相交; 1: 完全在q内; 2: 包含点(q[0], q[2]), 左闭右开. q按left, right, top, bottom排列, 相交测试要求q不是空矩形
+template<int Mode, class T>
+inline void RectTestKernel(const T *l, const T *r, const T *t, const T *b, size_t n, const T *q,
+                           uint32_t *hits, size_t &count) noexcept
+{
+    using P = decltype(LoadRectLanes(l, 0));
+    const P ql = P::Set(q[0]);
+    const P qr = P::Set(q[1]);
+    const P qt = P::Set(q[2]);
+    const P qb = P::Set(q[3]);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        const P pl = LoadRectLanes(l + i, cnt);
+        const P pr = LoadRectLanes(r + i, cnt);
+        const P pt = LoadRectLanes(t + i, cnt);
+        const P pb = LoadRectLanes(b + i, cnt);
+        uint32_t bits = Bits(CmpLt(pl, pr)) & Bits(CmpLt(pt, pb));     // 非空, 补齐的元素也在这里排除
+        if (Mode == 0)
+        {
+            bits &= Bits(CmpLt(ql, pr)) & Bits(CmpLt(pl, qr)) & Bits(CmpLt(qt, pb)) & Bits(CmpLt(pt, qb));
+        }
+        else if (Mode == 1)
+        {
+            bits &= ~(Bits(CmpLt(pl, ql)) | Bits(CmpLt(qr, pr)) | Bits(CmpLt(pt, qt)) | Bits(CmpLt(qb, pb)));
+        }
+        else {
+            bits &= ~(Bits(CmpLt(ql, pl)) | Bits(CmpLt(qt, pt))) & Bits(CmpLt(ql, pr)) & Bits(CmpLt(qt, pb));
+        }
+        if (bits == 0)
+        {
+            continue;                                           // 通常大部分矩形都不满足, 整组跳过
+        }
+        for (size_t j = 0; j < cnt; j += 1)                     // 无分支压缩: 总是写入, 满足条件时才移动位置
+        {
+            hits[k] = static_cast<uint32_t>(i + j);
+            k += (bits >> j) & 1u;
+        }
+    }
+    count = k;
+}
+// 与q相交的矩形
+template<class T>
+inline void RectOverlaps(const T *l, const T *r, const T *t, const T *b, size_t n, const T *q, uint32_t *hits, size_t &count) noexcept
+{
+    RectTestKernel<0>(l, r, t, b, n, q, hits, count);
+}
+// 完全在q内的矩形
+template<class T>
+inline void RectInside(const T *l, const T *r, const T *t, const T *b, size_t n, const T *q, uint32_t *hits, size_t &count) noexcept
+{
+    RectTestKernel<1>(l, r, t, b, n, q, hits, count);
+}
+// 包含点(x, y)的矩形
+template<class T>
+inline void RectContainPoint(const T *l, const T *r, const T *t, const T *b, size_t n, T x, T y, uint32_t *hits, size_t &count) noexcept
+{
+    const T q[4] = { x, x, y, y };
+    RectTestKernel<2>(l, r, t, b, n, q, hits, count);
+}
+// 裁剪到q的范围内(求交集), 结果可能是空矩形
+template<class T>
+inline void RectClip(T *l, T *r, T *t, T *b, size_t n, const T *q) noexcept
+{
+    using P = decltype(LoadRectLanes(l, 0));
+    const P ql = P::Set(q[0]);
+    const P qr = P::Set(q[1]);
+    const P qt = P::Set(q[2]);
+    const P qb = P::Set(q[3]);
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        StoreRectLanes(Max(LoadRectLanes(l + i, cnt), ql), cnt, l + i);
+        StoreRectLanes(Min(LoadRectLanes(r + i, cnt), qr), cnt, r + i);
+        StoreRectLanes(Max(LoadRectLanes(t + i, cnt), qt), cnt, t + i);
+        StoreRectLanes(Min(LoadRectLanes(b + i, cnt), qb), cnt, b + i);
+    }
+}
+// 包围所有非空矩形的最小矩形(并集), 写入out[0 .. 3]; 没有非空矩形时为(0, 0, 0, 0)
+template<class T>
+inline void RectBounds(const T *l, const T *r, const T *t, const T *b, size_t n, T *out) noexcept
+{
+    using P = decltype(LoadRectLanes(l, 0));
+    const P hi = P::Set(std::numeric_limits<T>::max());
+    const P lo = P::Set(std::numeric_limits<T>::lowest());
+    const uint32_t full = (1u << Pack::Width) - 1;
+    P ml = hi, mr = lo, mt = hi, mb = lo;
+    for (size_t i = 0; i < n; i += Pack::Width)
+    {
+        const size_t cnt = n - i < Pack::Width ? n - i : Pack::Width;
+        P pl = LoadRectLanes(l + i, cnt);
+        P pr = LoadRectLanes(r + i, cnt);
+        P pt = LoadRectLanes(t + i, cnt);
+        P pb = LoadRectLanes(b + i, cnt);
+        const PackMask x = CmpLt(pl, pr);
+        const PackMask y = CmpLt(pt, pb);
+        if ((Bits(x) & Bits(y)) != full)
+        {
+            // 空矩形(包括末尾补的0)换成不影响结果的值
+            pl = Select(x, Select(y, pl, hi), hi);
+            pr = Select(x, Select(y, pr, lo), lo);
+            pt = Select(x, Select(y, pt, hi), hi);
+            pb = Select(x, Select(y, pb, lo), lo);
+        }
+        ml = Min(ml, pl);
+        mr = Max(mr, pr);
+        mt = Min(mt, pt);
+        mb = Max(mb, pb);
+    }
+    alignas(64) T vl[Pack::Width], vr[Pack::Width], vt[Pack::Width], vb[Pack::Width];
+    ml.StoreU(vl);
+    mr.StoreU(vr);
+    mt.StoreU(vt);
+    mb.StoreU(vb);
+    T rl = vl[0], rr = vr[0], rt = vt[0], rb = vb[0];
+    for (size_t j = 1; j < Pack::Width; j += 1)
+    {
+        rl = vl[j] < rl ? vl[j] : rl;
+        rr = vr[j] > rr ? vr[j] : rr;
+        rt = vt[j] < rt ? vt[j] : rt;
+        rb = vb[j] > rb ? vb[j] : rb;
+    }
+    if (rl < rr && rt < rb)
+    {
+        out[0] = rl;
+        out[1] = rr;
+        out[2] = rt;
+        out[3] = rb;
+    }
+    else {
+        out[0] = out[1] = out[2] = out[3] = T(0);
+    }
+}
@@ -3,7 +3,7 @@
  | 文件名称: matrix4.hpp
  | 文件作用: 矩阵
  | 创建日期: 2021-03-26
- | 更新日期: 2021-04-02
+ | 更新日期: 2026-10-17
  | 开发人员: JuYan
  +----------------------------
  Copyright (C) JuYan, all rights reserved.
@@ -34,38 +34,33 @@
 #include "rect.hpp"
 #include "quater.hpp"
 #include "vector4.hpp"
+#include "vector3stream.hpp"
 namespace cirno
 {
-    class Matrix4 final
+    class alignas(16) Matrix4 final
     {
     public:
-        Matrix4() noexcept : buff{ 0.0f }
+        constexpr Matrix4() noexcept : buff{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } }
         {
             static_assert(sizeof(Matrix4) == 4 * sizeof(Vector4), "sizeof(Vector4) * 4 must equ sizeof(*this)");
-
-            buff[0][0] = 1.0f;
-            buff[1][1] = 1.0f;
-            buff[2][2] = 1.0f;
-            buff[3][3] = 1.0f;
-        }
-        Matrix4(const Matrix4 &b) noexcept
-        {
-            memcpy(buff, b.buff, sizeof(buff));
-        }
-        Matrix4& operator=(const Matrix4 &b) noexcept
-        {
-            memcpy(buff, b.buff, sizeof(buff));
-            return *this;
         }
+        Matrix4(const Matrix4 &) = default;
+        Matrix4& operator=(const Matrix4 &) = default;
         ~Matrix4() = default;
         // 设置为零矩阵
-        Matrix4& SetZero() noexcept
+        MATHLIB_CONSTEXPR14 Matrix4& SetZero() noexcept
         {
-            memset(buff, 0, sizeof(buff));
+            for (int i = 0; i < 4; i += 1)                          // 运行时编译器会合并成整块清零
+            {
+                for (int j = 0; j < 4; j += 1)
+                {
+                    buff[i][j] = 0.0f;
+                }
+            }
             return *this;
         }
         // 设置为单位矩阵
-        Matrix4& SetIdentity() noexcept
+        MATHLIB_CONSTEXPR14 Matrix4& SetIdentity() noexcept
         {
             SetZero();
 
@@ -78,7 +73,7 @@ namespace cirno
             return *this;
         }
         // 设置缩放矩阵
-        MATHLIB_CALL(Matrix4&) SetScaleTransform(const float32 r) noexcept
+        MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4&) SetScaleTransform(const float32 r) noexcept
         {
             SetZero();
 
@@ -92,13 +87,37 @@ namespace cirno
             return *this;
         }
         // 设置缩放矩阵(static)
-        static MATHLIB_CALL(Matrix4) ScaleTransform(const float32 r) noexcept
+        static MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4) ScaleTransform(const float32 r) noexcept
         {
             return Matrix4().SetScaleTransform(r);
         }
         // 从四元数载入旋转矩阵, q必须是归一化的
-        MATHLIB_CALL(Matrix4&) SetRotateTransform(const Quaternion q) noexcept
+        MATHLIB_CONSTEXPR_SIMD MATHLIB_CALL(Matrix4&) SetRotateTransform(const Quaternion q) noexcept
         {
+            if (!MATHLIB_IS_CONSTANT_EVALUATED())
+            {
+                // 记q = w + xi + yj + zk, 即(a, b, c, d) = (w, x, y, z)
+                const f32x4::Reg zero = f32x4::Splat(0.0f);
+                const f32x4::Reg p = f32x4::Shuffle<1, 2, 3, 0>(f32x4::Load(q.GetPtr()));  // p = (x, y, z, w)
+                const f32x4::Reg p2 = f32x4::Add(p, p);                         // p2 = (2x, 2y, 2z, 2w)
+                const f32x4::Reg sq = f32x4::Mul(p, p2);                        // sq = (2xx, 2yy, 2zz, 2ww)
+                // 对角线 r0 = (1 - 2yy - 2zz, 1 - 2xx - 2zz, 1 - 2xx - 2yy, _)
+                f32x4::Reg t0 = f32x4::Shuffle<1, 0, 0, 3>(sq);                 // (2yy, 2xx, 2xx, _)
+                f32x4::Reg t1 = f32x4::Shuffle<2, 2, 1, 3>(sq);                 // (2zz, 2zz, 2yy, _)
+                const f32x4::Reg r0 = f32x4::Sub(f32x4::Sub(f32x4::Splat(1.0f), t0), t1);
+                // r1 = (2xz + 2wy, 2xy + 2wz, 2yz + 2wx, _), r2 = (2xz - 2wy, 2xy - 2wz, 2yz - 2wx, _)
+                t0 = f32x4::Mul(f32x4::Shuffle<0, 0, 1, 3>(p), f32x4::Shuffle<2, 1, 2, 3>(p2));    // (2xz, 2xy, 2yz, _)
+                t1 = f32x4::Mul(f32x4::Shuffle<3, 3, 3, 3>(p), f32x4::Shuffle<1, 2, 0, 3>(p2));    // (2wy, 2wz, 2wx, _)
+                const f32x4::Reg r1 = f32x4::Add(t0, t1);
+                const f32x4::Reg r2 = f32x4::Sub(t0, t1);
+                // 第1列(r0.x, r1.y, r2.x, 0), 第2列(r2.y, r0.y, r1.z, 0), 第3列(r1.x, r2.z, r0.z, 0)
+                mval[0] = f32x4::Shuffle2<0, 2, 0, 2>(f32x4::Shuffle2<0, 0, 1, 1>(r0, r1), f32x4::Shuffle2<0, 0, 0, 0>(r2, zero));
+                mval[1] = f32x4::Shuffle2<0, 2, 0, 2>(f32x4::Shuffle2<1, 1, 1, 1>(r2, r0), f32x4::Shuffle2<2, 2, 0, 0>(r1, zero));
+                mval[2] = f32x4::Shuffle2<0, 2, 0, 2>(f32x4::Shuffle2<0, 0, 2, 2>(r1, r2), f32x4::Shuffle2<2, 2, 0, 0>(r0, zero));
+                mval[3] = f32x4::Set(0.0f, 0.0f, 0.0f, 1.0f);                   // a44 = 1 (不处理齐次坐标参数w)
+                return *this;
+            }
+            // 编译期求值时的标量实现
             SetZero();
 
             const float32 a = q.X();
@@ -121,7 +140,7 @@ namespace cirno
             return *this;
         }
         // 绕轴旋转(static), q必须是归一化的
-        static MATHLIB_CALL(Matrix4) RotateTransform(const Quaternion q) noexcept
+        static MATHLIB_CONSTEXPR_SIMD MATHLIB_CALL(Matrix4) RotateTransform(const Quaternion q) noexcept
         {
             return Matrix4().SetRotateTransform(q);
         }
@@ -170,7 +189,7 @@ namespace cirno
             return Matrix4().SetRotateTransform(angle, ax);
         }
         // 平移变换
-        MATHLIB_CALL(Matrix4&) SetTranslationTransform(const float32 offset_x, const float32 offset_y, const float32 offset_z) noexcept
+        MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4&) SetTranslationTransform(const float32 offset_x, const float32 offset_y, const float32 offset_z) noexcept
         {
             SetIdentity();
 
@@ -181,23 +200,151 @@ namespace cirno
             return *this;
         }
         // 平移变换(static)
-        static MATHLIB_CALL(Matrix4) TranslationTransform(const float32 x, const float32 y, const float32 z) noexcept
+        static MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4) TranslationTransform(const float32 x, const float32 y, const float32 z) noexcept
         {
             return Matrix4().SetTranslationTransform(x, y, z);
         }
         // 平移变换
-        MATHLIB_CALL(Matrix4&) SetTranslationTransform(const Vector3 offset) noexcept
+        MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4&) SetTranslationTransform(const Vector3 offset) noexcept
         {
             SetTranslationTransform(offset.X(), offset.Y(), offset.Z());
             return *this;
         }
         // 平移变换(static)
-        static MATHLIB_CALL(Matrix4) TranslationTransform(const Vector3 offset) noexcept
+        static MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4) TranslationTransform(const Vector3 offset) noexcept
         {
             return Matrix4().SetTranslationTransform(offset);
         }
+        // 由平移, 旋转(归一化的四元数), 缩放(可以不等比)直接构造矩阵: this = T * R * S
+        // 不需要先分别构造三个矩阵再相乘
+        MATHLIB_CONSTEXPR_SIMD MATHLIB_CALL(Matrix4&) SetTRS(const Vector3 t, const Quaternion r, const Vector3 s) noexcept
+        {
+            SetRotateTransform(r);                                  // R
+            if (!MATHLIB_IS_CONSTANT_EVALUATED())
+            {
+                const f32x4::Reg sv = f32x4::Load(s.GetPtr());
+                const f32x4::Reg tv = f32x4::Load(t.GetPtr());
+                mval[0] = f32x4::Mul(mval[0], f32x4::Shuffle<0, 0, 0, 0>(sv));  // R * S: 按列缩放
+                mval[1] = f32x4::Mul(mval[1], f32x4::Shuffle<1, 1, 1, 1>(sv));
+                mval[2] = f32x4::Mul(mval[2], f32x4::Shuffle<2, 2, 2, 2>(sv));
+                // (x, y, z, _) -> (x, y, z, 1): h = (z, z, 1, 1)
+                const f32x4::Reg h = f32x4::Shuffle2<2, 2, 0, 0>(tv, f32x4::Splat(1.0f));
+                mval[3] = f32x4::Shuffle2<0, 1, 0, 2>(tv, h);
+                return *this;
+            }
+            // 编译期求值时的标量实现
+            const float32 k[3] = { s.X(), s.Y(), s.Z() };
+            for (int i = 0; i < 3; i += 1)                          // R * S: 按列缩放
+            {
+                buff[i][0] *= k[i];
+                buff[i][1] *= k[i];
+                buff[i][2] *= k[i];
+            }
+            buff[3][0] = t.X();                                     // 第4列是平移
+            buff[3][1] = t.Y();
+            buff[3][2] = t.Z();
+            return *this;
+        }
+        // 由平移, 旋转, 缩放直接构造矩阵(static): T * R * S
+        static MATHLIB_CONSTEXPR_SIMD MATHLIB_CALL(Matrix4) FromTRS(const Vector3 t, const Quaternion r, const Vector3 s) noexcept
+        {
+            return Matrix4().SetTRS(t, r, s);
+        }
+        // 批量构造矩阵(例如填充实例缓冲区): out[k] = FromTRS(t[k], r[k], s[k])
+        // t, s为SoA, 元素个数必须相同; r至少要有t.Size()个元素; out不能与r重叠
+        static void FromTRS(const Vector3Stream &t, const Quaternion *r, const Vector3Stream &s, Matrix4 *out) noexcept
+        {
+            assert(t.Size() == s.Size());
+            MATHLIB_DISPATCH(MatrixFromTRS, t.XPtr(), t.YPtr(), t.ZPtr(), r->GetPtr(), s.XPtr(), s.YPtr(), s.ZPtr(), out->DataPtr(), t.Size());
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量构造矩阵, 分块后在pool中并行计算
+        static void FromTRS(ThreadPool &pool, const Vector3Stream &t, const Quaternion *r, const Vector3Stream &s, Matrix4 *out)
+        {
+            assert(t.Size() == s.Size());
+            pool.For(0, t.Size(), pool.Grain(t.Size()), [&](size_t b, size_t e) {
+                MATHLIB_DISPATCH(MatrixFromTRS, t.XPtr() + b, t.YPtr() + b, t.ZPtr() + b, r[b].GetPtr(), s.XPtr() + b, s.YPtr() + b, s.ZPtr() + b, out[b].DataPtr(), e - b);
+            });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 把仿射变换矩阵分解为平移, 旋转, 缩放, 是FromTRS的逆运算; 不处理切变, 有切变时旋转是近似的
+        // 行列式为负(镜像)时把x方向的缩放取反; 某个方向缩放为0时旋转无法确定, 返回false, r为单位四元数
+        MATHLIB_CALL(bool) Decompose(Vector3 &t, Quaternion &r, Vector3 &s) const noexcept
+        {
+            float32 k[3];
+            for (int i = 0; i < 3; i += 1)                          // 缩放是前三列的长度
+            {
+                k[i] = sqrtf(buff[i][0] * buff[i][0] + buff[i][1] * buff[i][1] + buff[i][2] * buff[i][2]);
+            }
+            const float32 det = buff[0][0] * (buff[1][1] * buff[2][2] - buff[1][2] * buff[2][1])
+                              + buff[0][1] * (buff[1][2] * buff[2][0] - buff[1][0] * buff[2][2])
+                              + buff[0][2] * (buff[1][0] * buff[2][1] - buff[1][1] * buff[2][0]);
+            if (det < 0.0f)
+            {
+                k[0] = -k[0];
+            }
+            t = Vector3(buff[3][0], buff[3][1], buff[3][2]);
+            s = Vector3(k[0], k[1], k[2]);
+            if (k[0] == 0.0f || k[1] == 0.0f || k[2] == 0.0f)
+            {
+                r = Quaternion();
+                return false;
+            }
+            float32 m[3][3];                                        // m[c][r] = Rrc
+            for (int i = 0; i < 3; i += 1)
+            {
+                m[i][0] = buff[i][0] / k[i];
+                m[i][1] = buff[i][1] / k[i];
+                m[i][2] = buff[i][2] / k[i];
+            }
+            // Shepperd方法: 只对4w^2, 4x^2, 4y^2, 4z^2中最大的一个开方, 其他分量用非对角线元素求得
+            const float32 tr = m[0][0] + m[1][1] + m[2][2];
+            if (tr >= m[0][0] && tr >= m[1][1] && tr >= m[2][2])
+            {
+                const float32 v = sqrtf(1.0f + tr) * 2.0f;          // 4w
+                r = Quaternion(0.25f * v, (m[1][2] - m[2][1]) / v, (m[2][0] - m[0][2]) / v, (m[0][1] - m[1][0]) / v);
+            }
+            else if (m[0][0] >= m[1][1] && m[0][0] >= m[2][2])
+            {
+                const float32 v = sqrtf(1.0f + m[0][0] - m[1][1] - m[2][2]) * 2.0f;   // 4x
+                r = Quaternion((m[1][2] - m[2][1]) / v, 0.25f * v, (m[1][0] + m[0][1]) / v, (m[2][0] + m[0][2]) / v);
+            }
+            else if (m[1][1] >= m[2][2])
+            {
+                const float32 v = sqrtf(1.0f - m[0][0] + m[1][1] - m[2][2]) * 2.0f;   // 4y
+                r = Quaternion((m[2][0] - m[0][2]) / v, (m[1][0] + m[0][1]) / v, 0.25f * v, (m[2][1] + m[1][2]) / v);
+            }
+            else
+            {
+                const float32 v = sqrtf(1.0f - m[0][0] - m[1][1] + m[2][2]) * 2.0f;   // 4z
+                r = Quaternion((m[0][1] - m[1][0]) / v, (m[2][0] + m[0][2]) / v, (m[2][1] + m[1][2]) / v, 0.25f * v);
+            }
+            r.SetNormalize<precision::Exact>();                     // 有切变时R不是正交矩阵
+            return true;
+        }
+        // 批量分解: in[k] -> t[k], r[k], s[k], t和s的大小会被设置为n; r至少要有n个元素
+        // 与单个的Decompose不同, 缩放为0时不返回标志, 旋转由剩下的列近似求得
+        static void Decompose(const Matrix4 *in, Vector3Stream &t, Quaternion *r, Vector3Stream &s, size_t n) noexcept
+        {
+            if (t.Resize(n) && s.Resize(n))
+            {
+                MATHLIB_DISPATCH(MatrixDecompose, in->DataPtr(), t.XPtr(), t.YPtr(), t.ZPtr(), r->GetPtr(), s.XPtr(), s.YPtr(), s.ZPtr(), n);
+            }
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量分解, 分块后在pool中并行计算
+        static void Decompose(ThreadPool &pool, const Matrix4 *in, Vector3Stream &t, Quaternion *r, Vector3Stream &s, size_t n)
+        {
+            if (t.Resize(n) && s.Resize(n))
+            {
+                pool.For(0, n, pool.Grain(n), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(MatrixDecompose, in[b].DataPtr(), t.XPtr() + b, t.YPtr() + b, t.ZPtr() + b, r[b].GetPtr(), s.XPtr() + b, s.YPtr() + b, s.ZPtr() + b, e - b);
+                });
+            }
+        }
+    #endif // _MATHLIB_USE_PARALLEL
         // 正射投影
-        MATHLIB_CALL(Matrix4&) SetOrthProject(const uint32_t view_w, const uint32_t view_h, const float32 near_plane, const float32 far_plane) noexcept
+        MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4&) SetOrthProject(const uint32_t view_w, const uint32_t view_h, const float32 near_plane, const float32 far_plane) noexcept
         {
             SetZero();
 
@@ -213,12 +360,12 @@ namespace cirno
             return *this;
         }
         // 正射投影(static)
-        static MATHLIB_CALL(Matrix4) OrthProject(const uint32_t view_w, const uint32_t view_h, float32 near_plane, float32 far_plane) noexcept
+        static MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4) OrthProject(const uint32_t view_w, const uint32_t view_h, float32 near_plane, float32 far_plane) noexcept
         {
             return Matrix4().SetOrthProject(view_w, view_h, near_plane, far_plane);
         }
         // 正射投影
-        MATHLIB_CALL(Matrix4&) SetOrthProject(const RectF &rc, float32 near_plane, float32 far_plane) noexcept
+        MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4&) SetOrthProject(const RectF &rc, float32 near_plane, float32 far_plane) noexcept
         {
             SetZero();
 
@@ -233,7 +380,7 @@ namespace cirno
             return *this;
         }
         // 正射投影(static)
-        static MATHLIB_CALL(Matrix4) OrthProject(const RectF &rc, float32 near_plane, float32 far_plane) noexcept
+        static MATHLIB_CONSTEXPR14 MATHLIB_CALL(Matrix4) OrthProject(const RectF &rc, float32 near_plane, float32 far_plane) noexcept
         {
             return Matrix4().SetOrthProject(rc, near_plane, far_plane);
         }
@@ -277,26 +424,26 @@ namespace cirno
             f = (at - eye).SetNormalize();
             s = f.CrossMul(up).SetNormalize();                      // s = f CROSSMUL up
             u = s.CrossMul(f);                                      // u = s CROSSMUL f
-
-            buff[0][0] = s.X();                                     // 第一行是右向量(这三行全部按照摄像机位置eY()e进行平移)
-            buff[1][0] = s.Y();
-            buff[2][0] = s.Z();
-            buff[3][0] = 0.0f;
-
-            buff[0][1] = u.X();                                     // 第二行是上向量
-            buff[1][1] = u.Y();
-            buff[2][1] = u.Z();
-            buff[3][1] = 0.0f;
-
-            buff[0][2] = -f.X();                                    // 第三行是方向向量
-            buff[1][2] = -f.Y();
-            buff[2][2] = -f.Z();
-            buff[3][3] = 0.0f;
-
-            buff[3][0] = -s.DotMul(eye);                            // 这列负责平移摄像机
-            buff[3][1] = -u.DotMul(eye);
-            buff[3][2] = +f.DotMul(eye);
-            buff[3][3] = 1.0f;
+            // 先按行组装: 第4个分量放平移量, 点乘结果一直在寄存器中
+            const f32x4::Reg zero = f32x4::Splat(0.0f);
+            const f32x4::Reg e = f32x4::Load(eye.GetPtr());
+            f32x4::Reg rs = f32x4::Load(s.GetPtr());                // 右向量
+            f32x4::Reg ru = f32x4::Load(u.GetPtr());                // 上向量
+            f32x4::Reg rf = f32x4::Load(f.GetPtr());                // 方向向量
+            const f32x4::Reg ts = f32x4::Sub(zero, f32x4::Dot3(rs, e));    // ts[0 .. 3] = -s DOTMUL eye
+            const f32x4::Reg tu = f32x4::Sub(zero, f32x4::Dot3(ru, e));    // tu[0 .. 3] = -u DOTMUL eye
+            const f32x4::Reg tf = f32x4::Dot3(rf, e);                      // tf[0 .. 3] = +f DOTMUL eye
+            rf = f32x4::Sub(zero, rf);                              // 方向向量取反
+            // (x, y, z, _), t -> (x, y, z, t): h = (z, z, t, t), r = (x, y, h[0], h[2])
+            rs = f32x4::Shuffle2<0, 1, 0, 2>(rs, f32x4::Shuffle2<2, 2, 2, 2>(rs, ts));
+            ru = f32x4::Shuffle2<0, 1, 0, 2>(ru, f32x4::Shuffle2<2, 2, 2, 2>(ru, tu));
+            rf = f32x4::Shuffle2<0, 1, 0, 2>(rf, f32x4::Shuffle2<2, 2, 2, 2>(rf, tf));
+            f32x4::Reg rw = f32x4::Set(0.0f, 0.0f, 0.0f, 1.0f);     // 最后一行是(0, 0, 0, 1)
+            f32x4::Transpose(rs, ru, rf, rw);                       // 转置为列主序
+            mval[0] = rs;
+            mval[1] = ru;
+            mval[2] = rf;
+            mval[3] = rw;
 
             return *this;
         }
@@ -310,191 +457,299 @@ namespace cirno
         MATHLIB_CALL(Matrix4) AddTransform(const Matrix4 b) const noexcept
         {
             Matrix4 res;
-        #if defined(_MATHLIB_USE_SSE)
-            for (int i = 0; i < 4; i++)
-            {
-                __m128 brod1 = _mm_set_ps1(b.buff[i][0]);           // 参见 MATHLIB_CALL(Matrix4) operator*(const Matrix4 &b) 
-                __m128 brod2 = _mm_set_ps1(b.buff[i][1]);           // 这里调换了操作数a, b的顺序
-                __m128 brod3 = _mm_set_ps1(b.buff[i][2]);
-                __m128 brod4 = _mm_set_ps1(b.buff[i][3]);
-
-                __m128 t1 = _mm_mul_ps(brod1, mval[0]);
-                __m128 t2 = _mm_mul_ps(brod2, mval[1]);
-                __m128 t3 = _mm_mul_ps(brod3, mval[2]);
-                __m128 t4 = _mm_mul_ps(brod4, mval[3]);
-
-                __m128 t5 = _mm_add_ps(t1, t2);
-                __m128 t6 = _mm_add_ps(t3, t4);
-
-                res.mval[i] = _mm_add_ps(t5, t6);
-            }
-        #else
-            res.SetZero();                                          // 全零的缓冲区
-
-            for (int i = 0; i < 4; i += 1)
-            {
-                for (int j = 0; j < 4; j += 1)
-                {
-                    for (int k = 0; k < 4; k += 1)
-                    {
-                        res[j][i] += b.buff[k][i] * buff[j][k];
-                    }
-                }
-            }
-        #endif // _MATHLIB_USE_SSE
+            MultiplyKernel(b, *this, res);
             return res;
         }
         // 在本次变换后添加一个变换
         // a.AppendTransform(b)相当于a = b * a
         MATHLIB_CALL(Matrix4&) AppendTransform(const Matrix4 b) noexcept
+        {
+            MultiplyKernel(b, *this, *this);                        // 注意是反过来的, 矩阵乘法从右往左读
+            return *this;
+        }
+        // 矩阵乘法
+        MATHLIB_CONSTEXPR_SIMD MATHLIB_CALL(Matrix4) operator*(const Matrix4 &b) const noexcept
         {
             Matrix4 res;
-        #if defined(_MATHLIB_USE_SSE)
-            for (int i = 0; i < 4; i++)
+            if (MATHLIB_IS_CONSTANT_EVALUATED())
+            {
+                MultiplyScalar(*this, b, res);                      // 编译期求值, 不能使用SIMD
+            }
+            else
             {
-                __m128 brod1 = _mm_set_ps1(b.buff[i][0]);           // 参见 MATHLIB_CALL(Matrix4) operator*(const Matrix4 &b) 
-                __m128 brod2 = _mm_set_ps1(b.buff[i][1]);           // 这里调换了操作数a, b的顺序, a.AppendTransform(b)相当于a = b * a
-                __m128 brod3 = _mm_set_ps1(b.buff[i][2]);
-                __m128 brod4 = _mm_set_ps1(b.buff[i][3]);
+                MultiplyKernel(*this, b, res);
+            }
+            return res;
+        }
+        // 批量矩阵乘法: out[k] = a[k] * b[k], out可以就是a或b
+        static void Multiply(const Matrix4 *a, const Matrix4 *b, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(MatrixMultiply, a->DataPtr(), 16, b->DataPtr(), out->DataPtr(), n);
+        }
+        // 批量矩阵乘法: out[k] = a * b[k], 例如把同一个父节点的变换叠加到一组子节点上, out可以就是b
+        static void Multiply(const Matrix4 &a, const Matrix4 *b, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(MatrixMultiply, a.DataPtr(), 0, b->DataPtr(), out->DataPtr(), n);
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量矩阵乘法: out[k] = a[k] * b[k], 分块后在pool中并行计算
+        static void Multiply(ThreadPool &pool, const Matrix4 *a, const Matrix4 *b, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t i, size_t e) { Multiply(a + i, b + i, out + i, e - i); });
+        }
+        // 批量矩阵乘法: out[k] = a * b[k], 分块后在pool中并行计算
+        static void Multiply(ThreadPool &pool, const Matrix4 &a, const Matrix4 *b, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=, &a](size_t i, size_t e) { Multiply(a, b + i, out + i, e - i); });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 应用变换: Vector4
+        MATHLIB_CALL(Vector4) operator*(const Vector4 b) const noexcept
+        {
+            const f32x4::Reg v = f32x4::Load(b.GetPtr());           // v[0 .. 3] = (b.x, b.y, b.z, b.w)
+            const f32x4::Reg x = f32x4::Shuffle<0, 0, 0, 0>(v);     // x[0 .. 3] = b.x, 直接在寄存器中广播
+            const f32x4::Reg y = f32x4::Shuffle<1, 1, 1, 1>(v);     // y[0 .. 3] = b.y
+            const f32x4::Reg z = f32x4::Shuffle<2, 2, 2, 2>(v);     // z[0 .. 3] = b.z
+            const f32x4::Reg w = f32x4::Shuffle<3, 3, 3, 3>(v);     // w[0 .. 3] = b.w
+            const f32x4::Reg tmp1 = f32x4::MulAdd(mval[1], y, f32x4::Mul(mval[0], x));  // tmp1[k] = mval[0][k] * b.x + mval[1][k] * b.y
+            const f32x4::Reg tmp2 = f32x4::MulAdd(mval[3], w, f32x4::Mul(mval[2], z));  // tmp2[k] = mval[2][k] * b.z + mval[3][k] * b.w
+            return Vector4(f32x4::Add(tmp1, tmp2));                 // 两条依赖链并行, 最后相加
+        }
+        // 应用变换: Vector3, 会补全为齐次坐标(补为1, 矩阵最后一列不参与乘法), 并进行裁剪
+        MATHLIB_CALL(Vector3) operator*(const Vector3 b) const noexcept
+        {
+            const f32x4::Reg x = f32x4::Splat(b.X());               // x[0 .. 3] = b.x
+            const f32x4::Reg y = f32x4::Splat(b.Y());               // y[0 .. 3] = b.y
+            const f32x4::Reg z = f32x4::Splat(b.Z());               // z[0 .. 3] = b.z
 
-                __m128 t1 = _mm_mul_ps(brod1, mval[0]);
-                __m128 t2 = _mm_mul_ps(brod2, mval[1]);
-                __m128 t3 = _mm_mul_ps(brod3, mval[2]);
-                __m128 t4 = _mm_mul_ps(brod4, mval[3]);
+            const f32x4::Reg col1 = f32x4::Mul(mval[0], x);         // col1[k] = mval[0][k] * b.x
+            const f32x4::Reg col2 = f32x4::Mul(mval[1], y);         // col2[k] = mval[1][k] * b.y
+            const f32x4::Reg col3 = f32x4::Mul(mval[2], z);         // col3[k] = mval[2][k] * b.z
 
-                __m128 t5 = _mm_add_ps(t1, t2);
-                __m128 t6 = _mm_add_ps(t3, t4);
+            const f32x4::Reg tmp1 = f32x4::Add(col1, col2);         // tmp1[k] = col1[k] + col2[k]
+            const f32x4::Reg tmp2 = f32x4::Add(col3, mval[3]);      // tmp2[k] = col3[k] + mval[3][k]
+            const f32x4::Reg tmp3 = f32x4::Add(tmp1, tmp2);         // tmp3[k] = tmp1[k] + tmp2[k]
 
-                res.mval[i] = _mm_add_ps(t5, t6);
+            const f32x4::Reg k = f32x4::Shuffle<3, 3, 3, 3>(tmp3);  // k[0 .. 3] = tmp3[3](齐次坐标参数w)
+            return Vector3(f32x4::Div(tmp3, k));                    // r[k] = tmp3[k] / k[k], 进行齐次坐标裁剪
+        }
+        // 批量变换点: out[k] = this * (in[k], 1), divide指定是否进行齐次坐标裁剪(除以w)
+        // 矩阵的列始终保存在寄存器中, 每次迭代处理1(SSE4.1)/2(AVX2)/4(AVX-512)个点; in和out可以是同一个数组
+        void TransformPoints(const Vector3 *in, Vector3 *out, size_t n, bool divide = true) const noexcept
+        {
+            MATHLIB_DISPATCH(TransformPoints, DataPtr(), reinterpret_cast<const float32*>(in), reinterpret_cast<float32*>(out), n, divide);
+        }
+        // 批量变换方向向量: out[k] = this * (in[k], 0), 不进行平移和齐次坐标裁剪
+        void TransformDirections(const Vector3 *in, Vector3 *out, size_t n) const noexcept
+        {
+            MATHLIB_DISPATCH(TransformDirections, DataPtr(), reinterpret_cast<const float32*>(in), reinterpret_cast<float32*>(out), n);
+        }
+        // 批量变换齐次坐标: out[k] = this * in[k], divide指定是否除以w(结果的w为1)
+        void TransformHomogeneous(const Vector4 *in, Vector4 *out, size_t n, bool divide = false) const noexcept
+        {
+            MATHLIB_DISPATCH(TransformHomogeneous, DataPtr(), reinterpret_cast<const float32*>(in), reinterpret_cast<float32*>(out), n, divide);
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量变换点, 分块后在pool中并行计算
+        // 每块是4的倍数(一个AVX-512 Pack的元素个数), 只有最后一块有标量计算的尾部, 结果与不分块时完全相同
+        void TransformPoints(ThreadPool &pool, const Vector3 *in, Vector3 *out, size_t n, bool divide = true) const
+        {
+            pool.For(0, n, pool.Grain(n, ThreadPool::MinGrain, 4), [this, in, out, divide](size_t b, size_t e) { TransformPoints(in + b, out + b, e - b, divide); });
+        }
+        // 批量变换方向向量, 分块后在pool中并行计算
+        void TransformDirections(ThreadPool &pool, const Vector3 *in, Vector3 *out, size_t n) const
+        {
+            pool.For(0, n, pool.Grain(n, ThreadPool::MinGrain, 4), [this, in, out](size_t b, size_t e) { TransformDirections(in + b, out + b, e - b); });
+        }
+        // 批量变换齐次坐标, 分块后在pool中并行计算
+        void TransformHomogeneous(ThreadPool &pool, const Vector4 *in, Vector4 *out, size_t n, bool divide = false) const
+        {
+            pool.For(0, n, pool.Grain(n, ThreadPool::MinGrain, 4), [this, in, out, divide](size_t b, size_t e) { TransformHomogeneous(in + b, out + b, e - b, divide); });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 批量变换点(SoA), 结果写入out, out可以就是in
+        void TransformPoints(const Vector3Stream &in, Vector3Stream &out, bool divide = true) const noexcept
+        {
+            if (out.Resize(in.Size()))
+            {
+                MATHLIB_DISPATCH(TransformStreamPoints, DataPtr(), in.XPtr(), in.YPtr(), in.ZPtr(), out.XPtr(), out.YPtr(), out.ZPtr(), in.Size(), divide);
             }
-
-            mval[0] = res.mval[0];
-            mval[1] = res.mval[1];
-            mval[2] = res.mval[2];
-            mval[3] = res.mval[3];
-        #else
-            res.SetZero();
-
-            for (int i = 0; i < 4; i += 1)
+        }
+        // 批量变换方向向量(SoA), 结果写入out, out可以就是in
+        void TransformDirections(const Vector3Stream &in, Vector3Stream &out) const noexcept
+        {
+            if (out.Resize(in.Size()))
             {
-                for (int j = 0; j < 4; j += 1)
-                {
-                    for (int k = 0; k < 4; k += 1)
-                    {                                               // r_ij = 求和::(b_ik * a_kj)
-                        res[j][i] += b.buff[k][i] * buff[j][k];     // 注意是反过来的, 矩阵乘法从右往左读
-                    }
-                }
+                MATHLIB_DISPATCH(TransformStreamDirections, DataPtr(), in.XPtr(), in.YPtr(), in.ZPtr(), out.XPtr(), out.YPtr(), out.ZPtr(), in.Size());
             }
-            for (int i = 0; i < 4; i += 1)
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量变换点(SoA), 分块后在pool中并行计算, 每块的起点按Vector3Stream::Alignment对齐
+        void TransformPoints(ThreadPool &pool, const Vector3Stream &in, Vector3Stream &out, bool divide = true) const
+        {
+            if (out.Resize(in.Size()))
             {
-                for (int j = 0; j < 4; j += 1)
-                {
-                    buff[i][j] = res[i][j];
-                }
+                pool.For(0, in.Size(), pool.Grain(in.Size(), ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(TransformStreamPoints, DataPtr(), in.XPtr() + b, in.YPtr() + b, in.ZPtr() + b, out.XPtr() + b, out.YPtr() + b, out.ZPtr() + b, e - b, divide);
+                });
             }
-        #endif // _MATHLIB_USE_SSE
-            return *this;
         }
-        // 矩阵乘法
-        MATHLIB_CALL(Matrix4) operator*(const Matrix4 &b) const noexcept
+        // 批量变换方向向量(SoA), 分块后在pool中并行计算
+        void TransformDirections(ThreadPool &pool, const Vector3Stream &in, Vector3Stream &out) const
         {
-            Matrix4 res;
-        #if defined(_MATHLIB_USE_SSE)
-            for (int i = 0; i < 4; i++)
+            if (out.Resize(in.Size()))
             {
-                __m128 brod1 = _mm_set_ps1(buff[i][0]);             // brod[0 .. 3]_k = buff[i列][k行]
-                __m128 brod2 = _mm_set_ps1(buff[i][1]);
-                __m128 brod3 = _mm_set_ps1(buff[i][2]);
-                __m128 brod4 = _mm_set_ps1(buff[i][3]);
-
-                __m128 t1 = _mm_mul_ps(brod1, b.mval[0]);           // t_k = buff[i列][k行] * b.buff[k列][0, 1, 2, 3行]
-                __m128 t2 = _mm_mul_ps(brod2, b.mval[1]);
-                __m128 t3 = _mm_mul_ps(brod3, b.mval[2]);
-                __m128 t4 = _mm_mul_ps(brod4, b.mval[3]);
-
-                __m128 t5 = _mm_add_ps(t1, t2);
-                __m128 t6 = _mm_add_ps(t3, t4);
-
-                res.mval[i] = _mm_add_ps(t5, t6);                   // res = Σ(t_k)
+                pool.For(0, in.Size(), pool.Grain(in.Size(), ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(TransformStreamDirections, DataPtr(), in.XPtr() + b, in.YPtr() + b, in.ZPtr() + b, out.XPtr() + b, out.YPtr() + b, out.ZPtr() + b, e - b);
+                });
             }
-        #else
-            res.SetZero();                                          // 全零的缓冲区
-
-            for (int i = 0; i < 4; i += 1)
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 取得行列式
+        MATHLIB_CALL(float32) GetDeterminant() const noexcept
+        {
+            const float32 *a = DataPtr();                           // 转置不改变行列式, 直接按行优先理解
+            const float32 s0 = a[0] * a[5] - a[4] * a[1];
+            const float32 s1 = a[0] * a[6] - a[4] * a[2];
+            const float32 s2 = a[0] * a[7] - a[4] * a[3];
+            const float32 s3 = a[1] * a[6] - a[5] * a[2];
+            const float32 s4 = a[1] * a[7] - a[5] * a[3];
+            const float32 s5 = a[2] * a[7] - a[6] * a[3];
+            const float32 c5 = a[10] * a[15] - a[14] * a[11];
+            const float32 c4 = a[9] * a[15] - a[13] * a[11];
+            const float32 c3 = a[9] * a[14] - a[13] * a[10];
+            const float32 c2 = a[8] * a[15] - a[12] * a[11];
+            const float32 c1 = a[8] * a[14] - a[12] * a[10];
+            const float32 c0 = a[8] * a[13] - a[12] * a[9];
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        }
+        // 设置为逆矩阵, 行列式为0时保持不变
+        MATHLIB_CALL(Matrix4&) SetInverse() noexcept
+        {
+            // 分块求逆: 把矩阵分成4个2x2的块 | A B |, 每个块装在一个寄存器里
+            //                                  | C D |
+            // 设逆矩阵为1/|M| * | X Y |, 则X# = |D|A - B(D#C), Y# = |B|C - D(A#B)#,
+            //                    | Z W |     Z# = |C|B - A(D#C)#, W# = |A|D - C(A#B), 其中#表示伴随矩阵
+            // |M| = |A||D| + |B||C| - tr((A#B)(D#C)); 转置的逆等于逆的转置, 所以按列存放也成立
+            const f32x4::Reg A = f32x4::Shuffle2<0, 1, 0, 1>(mval[0], mval[1]);
+            const f32x4::Reg B = f32x4::Shuffle2<2, 3, 2, 3>(mval[0], mval[1]);
+            const f32x4::Reg C = f32x4::Shuffle2<0, 1, 0, 1>(mval[2], mval[3]);
+            const f32x4::Reg D = f32x4::Shuffle2<2, 3, 2, 3>(mval[2], mval[3]);
+
+            const f32x4::Reg det_sub = f32x4::Sub(                  // det_sub = (|A|, |B|, |C|, |D|)
+                f32x4::Mul(f32x4::Shuffle2<0, 2, 0, 2>(mval[0], mval[2]), f32x4::Shuffle2<1, 3, 1, 3>(mval[1], mval[3])),
+                f32x4::Mul(f32x4::Shuffle2<1, 3, 1, 3>(mval[0], mval[2]), f32x4::Shuffle2<0, 2, 0, 2>(mval[1], mval[3])));
+            const f32x4::Reg det_a = f32x4::Shuffle<0, 0, 0, 0>(det_sub);
+            const f32x4::Reg det_b = f32x4::Shuffle<1, 1, 1, 1>(det_sub);
+            const f32x4::Reg det_c = f32x4::Shuffle<2, 2, 2, 2>(det_sub);
+            const f32x4::Reg det_d = f32x4::Shuffle<3, 3, 3, 3>(det_sub);
+
+            const f32x4::Reg d_c = Mat2AdjMul(D, C);                // D#C
+            const f32x4::Reg a_b = Mat2AdjMul(A, B);                // A#B
+            f32x4::Reg x_ = f32x4::Sub(f32x4::Mul(det_d, A), Mat2Mul(B, d_c));
+            f32x4::Reg w_ = f32x4::Sub(f32x4::Mul(det_a, D), Mat2Mul(C, a_b));
+            f32x4::Reg y_ = f32x4::Sub(f32x4::Mul(det_b, C), Mat2MulAdj(D, a_b));
+            f32x4::Reg z_ = f32x4::Sub(f32x4::Mul(det_c, B), Mat2MulAdj(A, d_c));
+
+            const f32x4::Reg tr = f32x4::Dot4(a_b, f32x4::Shuffle<0, 2, 1, 3>(d_c));   // 迹, 结果在每个分量上
+            const f32x4::Reg det_m = f32x4::Sub(f32x4::Add(f32x4::Mul(det_a, det_d), f32x4::Mul(det_b, det_c)), tr);
+            if (f32x4::First(det_m) == 0.0f)                        // 不可逆, 不进行计算
             {
-                for (int j = 0; j < 4; j += 1)
-                {
-                    for (int k = 0; k < 4; k += 1)
-                    {                                               // r_ij = 求和::(a_ik * b_kj)
-                        res[j][i] += buff[k][i] * b.buff[j][k];
-                    }
-                }
+                return *this;
             }
-        #endif // _MATHLIB_USE_SSE
-            return res;
+            const f32x4::Reg r = f32x4::Div(f32x4::Set(1.0f, -1.0f, -1.0f, 1.0f), det_m);
+            x_ = f32x4::Mul(x_, r);
+            y_ = f32x4::Mul(y_, r);
+            z_ = f32x4::Mul(z_, r);
+            w_ = f32x4::Mul(w_, r);
+
+            mval[0] = f32x4::Shuffle2<3, 1, 3, 1>(x_, y_);          // 取伴随矩阵的同时拼回4列
+            mval[1] = f32x4::Shuffle2<2, 0, 2, 0>(x_, y_);
+            mval[2] = f32x4::Shuffle2<3, 1, 3, 1>(z_, w_);
+            mval[3] = f32x4::Shuffle2<2, 0, 2, 0>(z_, w_);
+            return *this;
         }
-        // 应用变换: Vector4
-        MATHLIB_CALL(Vector4) operator*(const Vector4 b) noexcept
-        {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 x = _mm_set_ps1(b.X());                          // x[0 .. 3] = b.x
-            __m128 y = _mm_set_ps1(b.Y());                          // y[0 .. 3] = b.y
-            __m128 z = _mm_set_ps1(b.Z());                          // z[0 .. 3] = b.z
-            __m128 w = _mm_set_ps1(b.W());                          // w[0 .. 3] = b.w
-
-            __m128 col1 = _mm_mul_ps(mval[0], x);                   // col1[k] = mval[0][k] * x[k] = mval[0][k] * b.x
-            __m128 col2 = _mm_mul_ps(mval[1], y);                   // col2[k] = mval[1][k] * y[k] = mval[1][k] * b.y
-            __m128 col3 = _mm_mul_ps(mval[2], z);                   // col3[k] = mval[2][k] * z[k] = mval[2][k] * b.z
-            __m128 col4 = _mm_mul_ps(mval[3], w);                   // col4[k] = mval[3][k] * w[k] = mval[3][k] * b.w
-
-            __m128 tmp1 = _mm_add_ps(col1, col2);
-            __m128 tmp2 = _mm_add_ps(col3, col4);
-            __m128 tmp3 = _mm_add_ps(tmp1, tmp2);                   // tmp3[k] = col1[k] + col2[k] + col3[k] + col4[k]
-
-            float32 res[4];
-            _mm_store_ps(res, tmp3);                                // 存放结果
-
-            return Vector4(res[0], res[1], res[2], res[3]);
-        #else
-            const float32 rx = buff[0][0] * b.X() + buff[1][0] * b.Y() + buff[2][0] * b.Z() + buff[3][0] * b.W();
-            const float32 ry = buff[0][1] * b.X() + buff[1][1] * b.Y() + buff[2][1] * b.Z() + buff[3][1] * b.W();
-            const float32 rz = buff[0][2] * b.X() + buff[1][2] * b.Y() + buff[2][2] * b.Z() + buff[3][2] * b.W();
-            const float32 rw = buff[0][3] * b.X() + buff[1][3] * b.Y() + buff[2][3] * b.Z() + buff[3][3] * b.W();
-            return Vector4(rx, ry, rz, rw);
-        #endif // _MATHLIB_USE_SSE
+        // 取得逆矩阵, 行列式为0时返回原矩阵
+        MATHLIB_CALL(Matrix4) GetInverse() const noexcept
+        {
+            return Matrix4(*this).SetInverse();
         }
-        // 应用变换: Vector3, 会补全为齐次坐标(补为1, 矩阵最后一列不参与乘法), 并进行裁剪
-        MATHLIB_CALL(Vector3) operator*(const Vector3 b) noexcept
+        // 设置为仿射变换(旋转, 缩放, 平移等, 最后一行为0, 0, 0, 1)的逆矩阵, 比SetInverse快得多
+        // [R t]的逆为[R^-1 -R^-1 * t], 最后一行不参与计算; 左上角3x3不可逆时保持不变
+        MATHLIB_CALL(Matrix4&) SetAffineInverse() noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 x = _mm_set_ps1(b.X());                          // x[0 .. 3] = b.x
-            __m128 y = _mm_set_ps1(b.Y());                          // y[0 .. 3] = b.y
-            __m128 z = _mm_set_ps1(b.Z());                          // z[0 .. 3] = b.z
-
-            __m128 col1 = _mm_mul_ps(mval[0], x);                   // col1[k] = mval[0][k] * x[k] = mval[0][k] * b.x
-            __m128 col2 = _mm_mul_ps(mval[1], y);                   // col2[k] = mval[1][k] * y[k] = mval[0][k] * b.y
-            __m128 col3 = _mm_mul_ps(mval[2], z);                   // col3[k] = mval[2][k] * z[k] = mval[0][k] * b.z
-
-            __m128 tmp1 = _mm_add_ps(col1, col2);                   // tmp1[k] = col1[k] + col2[k]
-            __m128 tmp2 = _mm_add_ps(col3, mval[3]);                // tmp2[k] = col3[k] + mval[3][k]
-            __m128 tmp3 = _mm_add_ps(tmp1, tmp2);                   // tmp3[k] = tmp1[k] + tmp2[k]
-
-            float32 res[4];
-            _mm_store_ps(res, tmp3);                                // 缓存结果
-
-            __m128 k = _mm_set_ps1(res[3]);                         // k[0 .. 3] = res[3](齐次坐标参数w)
-            __m128 r = _mm_div_ps(tmp3, k);                         // r[k] = tmp3[k] / k[k], 进行齐次坐标裁剪
-            _mm_store_ps(res, r);                                   // r的前三个就是变换结果
-
-            return Vector3(res[0], res[1], res[2]);
-        #else
-            const float32 rx = buff[0][0] * b.X() + buff[1][0] * b.Y() + buff[2][0] * b.Z() + buff[3][0];
-            const float32 ry = buff[0][1] * b.X() + buff[1][1] * b.Y() + buff[2][1] * b.Z() + buff[3][1];
-            const float32 rz = buff[0][2] * b.X() + buff[1][2] * b.Y() + buff[2][2] * b.Z() + buff[3][2];
-            const float32 rw = buff[0][3] * b.X() + buff[1][3] * b.Y() + buff[2][3] * b.Z() + buff[3][3];
-            return Vector3(rx / rw, ry / rw, rz / rw);
-        #endif // _MATHLIB_USE_SSE
+            Matrix4 r;
+            if (Inverse3x3(*this, r))
+            {
+                f32x4::Reg zero = f32x4::Splat(0.0f);               // r的前三列是逆矩阵的三行, 转置后就是结果的三列
+                f32x4::Transpose(r.mval[0], r.mval[1], r.mval[2], zero);
+                const f32x4::Reg t = mval[3];
+                f32x4::Reg d = f32x4::Mul(r.mval[0], f32x4::Shuffle<0, 0, 0, 0>(t));
+                d = f32x4::Add(d, f32x4::Mul(r.mval[1], f32x4::Shuffle<1, 1, 1, 1>(t)));
+                d = f32x4::Add(d, f32x4::Mul(r.mval[2], f32x4::Shuffle<2, 2, 2, 2>(t)));
+                mval[0] = r.mval[0];
+                mval[1] = r.mval[1];
+                mval[2] = r.mval[2];
+                mval[3] = f32x4::Sub(f32x4::Set(0.0f, 0.0f, 0.0f, 1.0f), d);   // (-R^-1 * t, 1)
+            }
+            return *this;
         }
+        // 取得仿射变换的逆矩阵
+        MATHLIB_CALL(Matrix4) GetAffineInverse() const noexcept
+        {
+            return Matrix4(*this).SetAffineInverse();
+        }
+        // 取得法线矩阵: 左上角3x3的逆的转置, 其余部分为单位矩阵; 用于变换法线, 左上角3x3不可逆时返回单位矩阵
+        MATHLIB_CALL(Matrix4) GetNormalMatrix() const noexcept
+        {
+            Matrix4 r;
+            Inverse3x3(*this, r);                                   // 逆矩阵的第k行恰好就是结果的第k列
+            return r;
+        }
+        // 批量把四元数转换为旋转矩阵: out[k] = RotateTransform(q[k]), q[k]必须是归一化的, out不能与q重叠
+        // 每次处理Width个四元数(转置为SoA后各占SIMD寄存器的一个分量)
+        static void RotateTransform(const Quaternion *q, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(QuaternionToMatrix, q->GetPtr(), out->DataPtr(), n);
+        }
+        // 批量求逆: out[k] = in[k]的逆, 不可逆的矩阵保持不变; out可以就是in
+        // 每次处理Width个矩阵(各占SIMD寄存器的一个分量), 适合大量矩阵
+        static void Inverse(const Matrix4 *in, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(MatrixInverse, in->DataPtr(), out->DataPtr(), n, 0);
+        }
+        // 批量求仿射变换的逆, out可以就是in
+        static void AffineInverse(const Matrix4 *in, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(MatrixInverse, in->DataPtr(), out->DataPtr(), n, 1);
+        }
+        // 批量求法线矩阵, out可以就是in; 与GetNormalMatrix不同, 不可逆的矩阵保持不变
+        static void NormalMatrix(const Matrix4 *in, Matrix4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(MatrixInverse, in->DataPtr(), out->DataPtr(), n, 2);
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量把四元数转换为旋转矩阵, 分块后在pool中并行计算
+        static void RotateTransform(ThreadPool &pool, const Quaternion *q, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { RotateTransform(q + b, out + b, e - b); });
+        }
+        // 批量求逆, 分块后在pool中并行计算
+        static void Inverse(ThreadPool &pool, const Matrix4 *in, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { Inverse(in + b, out + b, e - b); });
+        }
+        // 批量求仿射变换的逆, 分块后在pool中并行计算
+        static void AffineInverse(ThreadPool &pool, const Matrix4 *in, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { AffineInverse(in + b, out + b, e - b); });
+        }
+        // 批量求法线矩阵, 分块后在pool中并行计算
+        static void NormalMatrix(ThreadPool &pool, const Matrix4 *in, Matrix4 *out, size_t n)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { NormalMatrix(in + b, out + b, e - b); });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
         // 设置转置
         Matrix4& SetTransposition() noexcept
         {
@@ -524,33 +779,113 @@ namespace cirno
             assert(i < 4);
             return data[i];
         }
-        // 取得数据区内存
+        // 取得数据区内存(整个矩阵的16个元素, 指针由整个buff得到, 而不是第一列的4个元素)
         inline float32* DataPtr() noexcept
         {
-            return &buff[0][0];
+            return reinterpret_cast<float32*>(buff);
         }
         // 取得数据区内存
         inline const float32* DataPtr() const noexcept
         {
-            return &buff[0][0];
+            return reinterpret_cast<const float32*>(buff);
+        }
+        // 取得第col列第row行的元素, 可以在编译期求值
+        inline constexpr float32 Get(unsigned int col, unsigned int row) const noexcept
+        {
+            return buff[col][row];
+        }
+    private:
+        // 矩阵乘法的内核: res = l * r, res可以就是l或r
+        // res的第i列 = Σ(r[i列][k行] * l的第k列), 求和顺序与批量乘法的内核相同; 单个矩阵不走运行时分派, 可以内联
+        static void MultiplyKernel(const Matrix4 &l, const Matrix4 &r, Matrix4 &res) noexcept
+        {
+            f32x4::Reg t[4];
+            for (int i = 0; i < 4; i += 1)
+            {
+                const f32x4::Reg c = r.mval[i];                     // c[k] = r[i列][k行]
+                const f32x4::Reg t1 = f32x4::MulAdd(l.mval[1], f32x4::Shuffle<1, 1, 1, 1>(c), f32x4::Mul(l.mval[0], f32x4::Shuffle<0, 0, 0, 0>(c)));
+                const f32x4::Reg t2 = f32x4::MulAdd(l.mval[3], f32x4::Shuffle<3, 3, 3, 3>(c), f32x4::Mul(l.mval[2], f32x4::Shuffle<2, 2, 2, 2>(c)));
+                t[i] = f32x4::Add(t1, t2);
+            }
+            res.mval[0] = t[0];                                     // 全部算完再写回, 允许res与l, r相同
+            res.mval[1] = t[1];
+            res.mval[2] = t[2];
+            res.mval[3] = t[3];
+        }
+        // 矩阵乘法的标量内核, 编译期求值时也使用它: res = l * r, res可以就是l或r
+        static MATHLIB_CONSTEXPR14 void MultiplyScalar(const Matrix4 &l, const Matrix4 &r, Matrix4 &res) noexcept
+        {
+            float32 t[4][4] = { };
+            for (int i = 0; i < 4; i += 1)
+            {
+                for (int j = 0; j < 4; j += 1)
+                {                                                   // t_ji = 求和::(l_jk * r_ki)
+                    t[i][j] = l.buff[0][j] * r.buff[i][0] + l.buff[1][j] * r.buff[i][1]
+                            + l.buff[2][j] * r.buff[i][2] + l.buff[3][j] * r.buff[i][3];
+                }
+            }
+            for (int i = 0; i < 4; i += 1)                          // 全部算完再写回, 允许res与l, r相同
+            {
+                for (int j = 0; j < 4; j += 1)
+                {
+                    res.buff[i][j] = t[i][j];
+                }
+            }
+        }
+        // 左上角3x3求逆, 结果按行写入r的前三列(r的第k列 = 逆矩阵的第k行), r的其余部分不变
+        // 设m的前三列为c0, c1, c2, 则逆矩阵的三行为(c1 × c2, c2 × c0, c0 × c1) / det; 不可逆时返回false
+        static bool Inverse3x3(const Matrix4 &m, Matrix4 &r) noexcept
+        {
+            const f32x4::Reg c0 = m.mval[0];
+            const f32x4::Reg c1 = m.mval[1];
+            const f32x4::Reg c2 = m.mval[2];
+            const f32x4::Reg r0 = f32x4::Cross3(c1, c2);
+            const f32x4::Reg r1 = f32x4::Cross3(c2, c0);
+            const f32x4::Reg r2 = f32x4::Cross3(c0, c1);
+            const f32x4::Reg det = f32x4::Dot3(c0, r0);
+            if (f32x4::First(det) == 0.0f)
+            {
+                return false;
+            }
+            const f32x4::Reg k = f32x4::Div(f32x4::Splat(1.0f), det);
+            r.mval[0] = f32x4::Mul(r0, k);
+            r.mval[1] = f32x4::Mul(r1, k);
+            r.mval[2] = f32x4::Mul(r2, k);
+            return true;
+        }
+        // 2x2矩阵(按行放在一个寄存器中)的乘法: a * b
+        static f32x4::Reg Mat2Mul(const f32x4::Reg a, const f32x4::Reg b) noexcept
+        {
+            return f32x4::Add(f32x4::Mul(a, f32x4::Shuffle<0, 3, 0, 3>(b)),
+                              f32x4::Mul(f32x4::Shuffle<1, 0, 3, 2>(a), f32x4::Shuffle<2, 1, 2, 1>(b)));
+        }
+        // 2x2矩阵的乘法: a# * b
+        static f32x4::Reg Mat2AdjMul(const f32x4::Reg a, const f32x4::Reg b) noexcept
+        {
+            return f32x4::Sub(f32x4::Mul(f32x4::Shuffle<3, 3, 0, 0>(a), b),
+                              f32x4::Mul(f32x4::Shuffle<1, 1, 2, 2>(a), f32x4::Shuffle<2, 3, 0, 1>(b)));
+        }
+        // 2x2矩阵的乘法: a * b#
+        static f32x4::Reg Mat2MulAdj(const f32x4::Reg a, const f32x4::Reg b) noexcept
+        {
+            return f32x4::Sub(f32x4::Mul(a, f32x4::Shuffle<3, 0, 3, 0>(b)),
+                              f32x4::Mul(f32x4::Shuffle<1, 0, 3, 2>(a), f32x4::Shuffle<2, 1, 2, 1>(b)));
         }
     private:
         // 内存布局:
         // union
         // { | ---- 128 ---- | ---- 128 ---- | ---- 128 ---- | ---- 128 ---- |
         //   |    Vector4    |    Vector4    |    Vector4    |    Vector4    |
-        //   |     __m128    |     __m128    |     __m128    |     __m128    |
+        //   |   f32x4::Reg  |   f32x4::Reg  |   f32x4::Reg  |   f32x4::Reg  |
         //   |    buff[4]    |    buff[4]    |    buff[4]    |    buff[4]    |
         // }
         // 数组结构: buff[第k列][第k行]
-        //          Vector4 data[], __m128 mval[]均表示每一行的值
+        //          Vector4 data[], f32x4::Reg mval[]均表示每一行的值
         union
         {
-            Vector4 data[4];
-        #if defined(_MATHLIB_USE_SSE)
-            __m128  mval[4];
-        #endif // _MATHLIB_USE_SSE
-            float32 buff[4][4];
+            Vector4    data[4];
+            f32x4::Reg mval[4];
+            float32    buff[4][4];
         };
     };
 }
@@ -0,0 +1,290 @@
+﻿/*
+ | Cirno
+ | 文件名称: matrix4d.hpp
+ | 文件作用: 双精度4x4矩阵
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 双精度4x4矩阵, 列主序(与Matrix4相同), 用于大世界中物体的世界变换
+    // 渲染前用ToMatrix4(origin)或CameraRelative转换为相对于摄像机的float32矩阵: 平移在float64下减去摄像机位置, 旋转和缩放直接转换
+    class Matrix4d final
+    {
+    public:
+        Matrix4d() noexcept : buff{ { 0.0 } }
+        {
+            buff[0][0] = 1.0;
+            buff[1][1] = 1.0;
+            buff[2][2] = 1.0;
+            buff[3][3] = 1.0;
+        }
+        explicit Matrix4d(const Matrix4 &m) noexcept
+        {
+            const float32 *p = m.DataPtr();
+            for (int i = 0; i < 16; i += 1)
+            {
+                buff[i / 4][i % 4] = p[i];
+            }
+        }
+        Matrix4d(const Matrix4d &b) noexcept
+        {
+            memcpy(buff, b.buff, sizeof(buff));
+        }
+        Matrix4d& operator=(const Matrix4d &b) noexcept
+        {
+            memcpy(buff, b.buff, sizeof(buff));
+            return *this;
+        }
+        // 单位矩阵
+        Matrix4d& SetIdentity() noexcept
+        {
+            *this = Matrix4d();
+            return *this;
+        }
+        // 平移矩阵
+        MATHLIB_CALL(Matrix4d&) SetTranslationTransform(const Vector3d &offset) noexcept
+        {
+            SetIdentity();
+            buff[3][0] = offset.X();
+            buff[3][1] = offset.Y();
+            buff[3][2] = offset.Z();
+            return *this;
+        }
+        // 平移矩阵
+        static MATHLIB_CALL(Matrix4d) TranslationTransform(const Vector3d &offset) noexcept
+        {
+            return Matrix4d().SetTranslationTransform(offset);
+        }
+        // 旋转矩阵, q必须是归一化的
+        MATHLIB_CALL(Matrix4d&) SetRotateTransform(const Quaterniond &q) noexcept
+        {
+            return SetTRS(Vector3d(), q, Vector3d(1.0));
+        }
+        // 旋转矩阵, q必须是归一化的
+        static MATHLIB_CALL(Matrix4d) RotateTransform(const Quaterniond &q) noexcept
+        {
+            return Matrix4d().SetRotateTransform(q);
+        }
+        // 由平移t, 旋转r(必须是归一化的), 缩放s直接构造T * R * S
+        MATHLIB_CALL(Matrix4d&) SetTRS(const Vector3d &t, const Quaterniond &r, const Vector3d &s) noexcept
+        {
+            const float64 a = r.X(), b = r.Y(), c = r.Z(), d = r.W();
+            const float64 k[3] = { s.X(), s.Y(), s.Z() };
+            const float64 m[3][3] = {
+                { 1.0 - 2.0 * (c * c + d * d), 2.0 * (b * c + a * d), 2.0 * (b * d - a * c) },
+                { 2.0 * (b * c - a * d), 1.0 - 2.0 * (b * b + d * d), 2.0 * (a * b + c * d) },
+                { 2.0 * (a * c + b * d), 2.0 * (c * d - a * b), 1.0 - 2.0 * (b * b + c * c) },
+            };
+            for (int i = 0; i < 3; i += 1)                      // 第i列乘以第i个缩放系数
+            {
+                buff[i][0] = m[i][0] * k[i];
+                buff[i][1] = m[i][1] * k[i];
+                buff[i][2] = m[i][2] * k[i];
+                buff[i][3] = 0.0;
+            }
+            buff[3][0] = t.X();                                 // 第4列是平移
+            buff[3][1] = t.Y();
+            buff[3][2] = t.Z();
+            buff[3][3] = 1.0;
+            return *this;
+        }
+        // 由平移, 旋转, 缩放构造T * R * S
+        static MATHLIB_CALL(Matrix4d) FromTRS(const Vector3d &t, const Quaterniond &r, const Vector3d &s) noexcept
+        {
+            return Matrix4d().SetTRS(t, r, s);
+        }
+        // 矩阵乘法: 结果的第j列 = this的4列按b的第j列线性组合
+        MATHLIB_CALL(Matrix4d) operator*(const Matrix4d &b) const noexcept
+        {
+            Matrix4d r;
+            for (int j = 0; j < 4; j += 1)
+            {
+                f64x4::Reg t = f64x4::Mul(Col(0), f64x4::Splat(b.buff[j][0]));
+                t = f64x4::MulAdd(Col(1), f64x4::Splat(b.buff[j][1]), t);
+                t = f64x4::MulAdd(Col(2), f64x4::Splat(b.buff[j][2]), t);
+                f64x4::Store(f64x4::MulAdd(Col(3), f64x4::Splat(b.buff[j][3]), t), r.buff[j]);
+            }
+            return r;
+        }
+        // 应用变换: Vector4d
+        MATHLIB_CALL(Vector4d) operator*(const Vector4d &b) const noexcept
+        {
+            const f64x4::Reg t1 = f64x4::MulAdd(Col(1), f64x4::Splat(b.Y()), f64x4::Mul(Col(0), f64x4::Splat(b.X())));
+            const f64x4::Reg t2 = f64x4::MulAdd(Col(3), f64x4::Splat(b.W()), f64x4::Mul(Col(2), f64x4::Splat(b.Z())));
+            return Vector4d(f64x4::Add(t1, t2));                // 两条依赖链并行, 最后相加
+        }
+        // 变换点(w = 1), 不进行齐次坐标裁剪
+        MATHLIB_CALL(Vector3d) TransformPoint(const Vector3d &b) const noexcept
+        {
+            const f64x4::Reg t1 = f64x4::MulAdd(Col(1), f64x4::Splat(b.Y()), f64x4::Mul(Col(0), f64x4::Splat(b.X())));
+            const f64x4::Reg t2 = f64x4::MulAdd(Col(2), f64x4::Splat(b.Z()), Col(3));
+            Vector3d r(f64x4::Add(t1, t2));
+            return Vector3d(r.X(), r.Y(), r.Z());               // 第4个分量清零
+        }
+        // 变换方向(w = 0), 不平移
+        MATHLIB_CALL(Vector3d) TransformDirection(const Vector3d &b) const noexcept
+        {
+            const f64x4::Reg t1 = f64x4::MulAdd(Col(1), f64x4::Splat(b.Y()), f64x4::Mul(Col(0), f64x4::Splat(b.X())));
+            Vector3d r(f64x4::MulAdd(Col(2), f64x4::Splat(b.Z()), t1));
+            return Vector3d(r.X(), r.Y(), r.Z());
+        }
+        // 取得平移部分
+        MATHLIB_CALL(Vector3d) GetTranslation() const noexcept
+        {
+            return Vector3d(buff[3][0], buff[3][1], buff[3][2]);
+        }
+        // 设置为仿射变换(旋转, 缩放和平移)的逆矩阵, 比SetInverse快; 与Matrix4相同, 左上角3x3不可逆时保持不变
+        MATHLIB_CALL(Matrix4d&) SetAffineInverse() noexcept
+        {
+            // 3x3部分的逆 = 伴随矩阵 / 行列式, 伴随矩阵的第i行是另外两列的叉乘
+            const float64 *c0 = buff[0], *c1 = buff[1], *c2 = buff[2];
+            const float64 r[3][3] = {
+                { c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0] },    // c1 × c2
+                { c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0] },    // c2 × c0
+                { c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0] },    // c0 × c1
+            };
+            const float64 det = buff[0][0] * r[0][0] + buff[0][1] * r[0][1] + buff[0][2] * r[0][2];
+            if (det == 0.0)
+            {
+                return *this;
+            }
+            const float64 k = 1.0 / det;
+            const float64 t[3] = { buff[3][0], buff[3][1], buff[3][2] };
+            for (int i = 0; i < 3; i += 1)                      // r[i]是逆矩阵的第i行
+            {
+                buff[0][i] = r[i][0] * k;
+                buff[1][i] = r[i][1] * k;
+                buff[2][i] = r[i][2] * k;
+                buff[3][i] = -(buff[0][i] * t[0] + buff[1][i] * t[1] + buff[2][i] * t[2]);  // 平移 = -R^-1 * t
+            }
+            return *this;
+        }
+        // 取得仿射变换的逆矩阵, 不可逆时返回原矩阵
+        MATHLIB_CALL(Matrix4d) GetAffineInverse() const noexcept
+        {
+            return Matrix4d(*this).SetAffineInverse();
+        }
+        // 设置为逆矩阵(一般情况, 余子式展开), 与Matrix4相同, 行列式为0时保持不变
+        MATHLIB_CALL(Matrix4d&) SetInverse() noexcept
+        {
+            const float64 *m = &buff[0][0];
+            float64 inv[16];
+            inv[0]  =  m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+            inv[4]  = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+            inv[8]  =  m[4] * m[9]  * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+            inv[12] = -m[4] * m[9]  * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+            inv[1]  = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+            inv[5]  =  m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+            inv[9]  = -m[0] * m[9]  * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+            inv[13] =  m[0] * m[9]  * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+            inv[2]  =  m[1] * m[6]  * m[15] - m[1] * m[7]  * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7]  - m[13] * m[3] * m[6];
+            inv[6]  = -m[0] * m[6]  * m[15] + m[0] * m[7]  * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7]  + m[12] * m[3] * m[6];
+            inv[10] =  m[0] * m[5]  * m[15] - m[0] * m[7]  * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7]  - m[12] * m[3] * m[5];
+            inv[14] = -m[0] * m[5]  * m[14] + m[0] * m[6]  * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6]  + m[12] * m[2] * m[5];
+            inv[3]  = -m[1] * m[6]  * m[11] + m[1] * m[7]  * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9]  * m[2] * m[7]  + m[9]  * m[3] * m[6];
+            inv[7]  =  m[0] * m[6]  * m[11] - m[0] * m[7]  * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8]  * m[2] * m[7]  - m[8]  * m[3] * m[6];
+            inv[11] = -m[0] * m[5]  * m[11] + m[0] * m[7]  * m[9]  + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]  - m[8]  * m[1] * m[7]  + m[8]  * m[3] * m[5];
+            inv[15] =  m[0] * m[5]  * m[10] - m[0] * m[6]  * m[9]  - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]  + m[8]  * m[1] * m[6]  - m[8]  * m[2] * m[5];
+            const float64 det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+            if (det == 0.0)
+            {
+                return *this;
+            }
+            const f64x4::Reg k = f64x4::Splat(1.0 / det);
+            for (int i = 0; i < 4; i += 1)
+            {
+                f64x4::Store(f64x4::Mul(f64x4::Load(inv + 4 * i), k), buff[i]);
+            }
+            return *this;
+        }
+        // 取得逆矩阵(一般情况), 行列式为0时返回原矩阵
+        MATHLIB_CALL(Matrix4d) GetInverse() const noexcept
+        {
+            return Matrix4d(*this).SetInverse();
+        }
+        // 转置
+        Matrix4d GetTransposition() const noexcept
+        {
+            Matrix4d r;
+            for (int i = 0; i < 4; i += 1)
+            {
+                for (int j = 0; j < 4; j += 1)
+                {
+                    r.buff[i][j] = buff[j][i];
+                }
+            }
+            return r;
+        }
+        // 转换为单精度
+        MATHLIB_CALL(Matrix4) ToMatrix4() const noexcept
+        {
+            return ToMatrix4(Vector3d());
+        }
+        // 转换为相对于origin(例如摄像机位置)的单精度矩阵, 等于TranslationTransform(-origin) * this
+        // 平移在float64下减去origin, 远离原点时也不损失精度
+        MATHLIB_CALL(Matrix4) ToMatrix4(const Vector3d &origin) const noexcept
+        {
+            Matrix4 r;
+            float32 *p = r.DataPtr();
+            f64x4::StoreFloat(Col(0), p);
+            f64x4::StoreFloat(Col(1), p + 4);
+            f64x4::StoreFloat(Col(2), p + 8);
+            f64x4::StoreFloat(f64x4::Sub(Col(3), origin.GetReg()), p + 12);   // origin的第4个分量是0
+            return r;
+        }
+        // 批量转换为相对于origin的单精度矩阵: out[k] = in[k].ToMatrix4(origin), 用于上传渲染数据
+        static void CameraRelative(const Matrix4d *in, const Vector3d &origin, Matrix4 *out, size_t n) noexcept
+        {
+            const float64 o[16] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, origin.X(), origin.Y(), origin.Z(), 0.0 };
+            MATHLIB_DISPATCH(ConvertRelative, in->DataPtr(), o, 16, out->DataPtr(), n);
+        }
+        // 取得数据指针, 16个float64, 按列存放
+        inline float64* DataPtr() noexcept
+        {
+            return reinterpret_cast<float64*>(buff);
+        }
+        // 取得数据指针, 16个float64, 按列存放
+        inline const float64* DataPtr() const noexcept
+        {
+            return reinterpret_cast<const float64*>(buff);
+        }
+    private:
+        // 读入第i列(不要求对齐)
+        inline f64x4::Reg Col(int i) const noexcept
+        {
+            return f64x4::Load(buff[i]);
+        }
+        // 内存布局:
+        // | ---- 256 ---- | ---- 256 ---- | ---- 256 ---- | ---- 256 ---- |
+        // |    buff[0]    |    buff[1]    |    buff[2]    |    buff[3]    |
+        // 数组结构: buff[第k列][第k行]; 只按float64存储, 运算时用Col读入寄存器, 不要求32字节对齐
+        alignas(16) float64 buff[4][4];
+    };
+}
@@ -0,0 +1,295 @@
+﻿/*
+ | Cirno
+ | 文件名称: packed.hpp
+ | 文件作用: 量化存储格式(半精度, 八面体映射, 10:10:10:2, 最小三分量四元数)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "vector4.hpp"
+#include "quater.hpp"
+#include "kernel.hpp"
+namespace cirno
+{
+    // 量化存储格式: 用于顶点流和动画数据等受内存带宽限制的场合, 计算时解包为Vector3, Vector4, Quaternion
+    // 批量版本每次处理Width个元素, 解包后的Vector3的第4个float32为0
+    namespace quantize
+    {
+        // 把v限制在[-1, 1]后乘以scale并舍入为整数(舍入到最近的偶数, 与SIMD指令相同)
+        inline int32_t Snorm(float32 v, float32 scale) noexcept
+        {
+            v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+            return static_cast<int32_t>(nearbyintf(v * scale));
+        }
+        // 把整数的低bits位作为有符号数扩展为int32_t
+        template<int bits>
+        inline int32_t SignExtend(uint32_t v) noexcept
+        {
+            return static_cast<int32_t>(v << (32 - bits)) >> (32 - bits);
+        }
+    }
+    // 半精度空间向量, 6字节(Vector3为16字节)
+    // 误差: 每个分量的相对误差不超过2^-11(约4.9e-4); 绝对值小于2^-14时为非规格化数, 绝对误差不超过2^-25;
+    // 舍入后超过65504时变为无穷大; NaN保持为NaN, 但不同指令集保留的payload可能不同
+    struct HalfVector3
+    {
+        uint16_t x, y, z;
+
+        // 打包
+        static HalfVector3 Encode(const Vector3 v) noexcept
+        {
+            return HalfVector3{ kernel::FloatToHalf(v.X()), kernel::FloatToHalf(v.Y()), kernel::FloatToHalf(v.Z()) };
+        }
+        // 解包
+        MATHLIB_CALL(Vector3) Decode() const noexcept
+        {
+            return Vector3(kernel::HalfToFloat(x), kernel::HalfToFloat(y), kernel::HalfToFloat(z));
+        }
+        // 批量打包, AVX2和AVX-512使用F16C指令
+        static void Encode(const Vector3 *in, HalfVector3 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(EncodeHalf3, reinterpret_cast<const float32*>(in), &out->x, n);
+        }
+        // 批量解包
+        static void Decode(const HalfVector3 *in, Vector3 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(DecodeHalf3, &in->x, reinterpret_cast<float32*>(out), n);
+        }
+    };
+    // 八面体映射的单位向量(法线, 切线), 4字节: 投影到八面体|x| + |y| + |z| = 1上, z < 0的一半沿对角线折叠到外侧,
+    // 然后把(u, v)量化为两个snorm16; 低16位是u, 高16位是v
+    // 误差: 解包后重新归一化, 与原向量的夹角不超过6.6e-5弧度(约0.004度): u, v的误差h不超过半个步长1 / 65534,
+    // 八面体上的点移动不超过√6 h, 而点到原点的距离不小于1 / √3, 所以夹角不超过3√2 h, 再加上float32的舍入
+    struct OctNormal
+    {
+        uint32_t bits;
+
+        // 打包, v必须是归一化的(长度为0时得到(0, 0, 1))
+        static OctNormal Encode(const Vector3 v) noexcept
+        {
+            const float32 s = fabsf(v.X()) + fabsf(v.Y()) + fabsf(v.Z());
+            const float32 k = s != 0.0f ? 1.0f / s : 0.0f;
+            float32 u = v.X() * k, w = v.Y() * k;
+            if (v.Z() < 0.0f)
+            {
+                const float32 t = u;
+                u = (1.0f - fabsf(w)) * (u < 0.0f ? -1.0f : 1.0f);
+                w = (1.0f - fabsf(t)) * (w < 0.0f ? -1.0f : 1.0f);
+            }
+            const uint32_t qu = static_cast<uint32_t>(quantize::Snorm(u, 32767.0f)) & 0xffffu;
+            const uint32_t qv = static_cast<uint32_t>(quantize::Snorm(w, 32767.0f));
+            return OctNormal{ qu | (qv << 16) };
+        }
+        // 解包, 结果是归一化的
+        MATHLIB_CALL(Vector3) Decode() const noexcept
+        {
+            float32 x = fmaxf(static_cast<float32>(quantize::SignExtend<16>(bits)) / 32767.0f, -1.0f);
+            float32 y = fmaxf(static_cast<float32>(quantize::SignExtend<16>(bits >> 16)) / 32767.0f, -1.0f);
+            const float32 z = 1.0f - fabsf(x) - fabsf(y);
+            const float32 t = z < 0.0f ? -z : 0.0f;             // z < 0时展开折叠的部分
+            x += x < 0.0f ? t : -t;
+            y += y < 0.0f ? t : -t;
+            return Vector3(x, y, z).GetNormalize<precision::Exact>();
+        }
+        // 批量打包
+        static void Encode(const Vector3 *in, OctNormal *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(EncodeOctahedral, reinterpret_cast<const float32*>(in), &out->bits, n);
+        }
+        // 批量解包
+        static void Decode(const OctNormal *in, Vector3 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(DecodeOctahedral, &in->bits, reinterpret_cast<float32*>(out), n);
+        }
+    };
+    // 10:10:10:2方向向量, 4字节: x, y, z各10位snorm(±511), 最高2位是w(-1, 0, 1, 例如切线空间的手性)
+    // 与图形API的有符号2_10_10_10格式的位布局相同
+    // 误差: 每个分量的绝对误差不超过9.8e-4(半个量化步长1 / 1022 = 9.785e-4, 加上float32的舍入), 解包后不重新归一化
+    struct Packed1010102
+    {
+        uint32_t bits;
+
+        // 打包, 各分量限制在[-1, 1]内, w舍入为-1, 0, 1
+        static Packed1010102 Encode(const Vector3 v, float32 w = 0.0f) noexcept
+        {
+            const uint32_t x = static_cast<uint32_t>(quantize::Snorm(v.X(), 511.0f)) & 0x3ffu;
+            const uint32_t y = static_cast<uint32_t>(quantize::Snorm(v.Y(), 511.0f)) & 0x3ffu;
+            const uint32_t z = static_cast<uint32_t>(quantize::Snorm(v.Z(), 511.0f)) & 0x3ffu;
+            const uint32_t k = static_cast<uint32_t>(quantize::Snorm(w, 1.0f));
+            return Packed1010102{ x | (y << 10) | (z << 20) | (k << 30) };
+        }
+        // 解包方向
+        MATHLIB_CALL(Vector3) Decode() const noexcept
+        {
+            return Vector3(fmaxf(static_cast<float32>(quantize::SignExtend<10>(bits)) / 511.0f, -1.0f),
+                           fmaxf(static_cast<float32>(quantize::SignExtend<10>(bits >> 10)) / 511.0f, -1.0f),
+                           fmaxf(static_cast<float32>(quantize::SignExtend<10>(bits >> 20)) / 511.0f, -1.0f));
+        }
+        // 取得w
+        inline float32 W() const noexcept
+        {
+            return fmaxf(static_cast<float32>(quantize::SignExtend<2>(bits >> 30)), -1.0f);
+        }
+        // 批量打包, w为0
+        static void Encode(const Vector3 *in, Packed1010102 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(Encode1010102, reinterpret_cast<const float32*>(in), &out->bits, n, false);
+        }
+        // 批量打包, 包括w
+        static void Encode(const Vector4 *in, Packed1010102 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(Encode1010102, reinterpret_cast<const float32*>(in), &out->bits, n, true);
+        }
+        // 批量解包方向
+        static void Decode(const Packed1010102 *in, Vector3 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(Decode1010102, &in->bits, reinterpret_cast<float32*>(out), n, false);
+        }
+        // 批量解包, 包括w
+        static void Decode(const Packed1010102 *in, Vector4 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(Decode1010102, &in->bits, reinterpret_cast<float32*>(out), n, true);
+        }
+    };
+    // 最小三分量(smallest three)编码的单位四元数, 6字节:
+    // 去掉绝对值最大的分量(使它为正, q与-q表示同一个旋转), 其余三个分量在[-1/√2, 1/√2]内, 各量化为15位;
+    // 下标的两位放在前两个uint16_t的最高位. 解包时最大的分量由单位长度求得
+    // 误差: 存储的三个分量的绝对误差d不超过2.2e-5(半个量化步长(1/√2) / 32766 = 2.16e-5, 加上float32的舍入);
+    // 由单位长度求得的分量w是最大的(不小于1/2), |dw| <= Σ|f_i|d / w <= 3d, 即6.7e-5(四个分量都接近±1/2时);
+    // 两个四元数的距离不超过√12 d, 旋转角的误差在0.009度以内
+    struct PackedQuaternion48
+    {
+        uint16_t v[3];
+
+        // 打包, q必须是归一化的
+        static PackedQuaternion48 Encode(const Quaternion q) noexcept
+        {
+            int32_t c[3];
+            const uint32_t idx = SmallestThree(q, 16383.0f, c);
+            PackedQuaternion48 r;
+            r.v[0] = static_cast<uint16_t>((static_cast<uint32_t>(c[0]) & 0x7fffu) | ((idx & 1u) << 15));
+            r.v[1] = static_cast<uint16_t>((static_cast<uint32_t>(c[1]) & 0x7fffu) | ((idx & 2u) << 14));
+            r.v[2] = static_cast<uint16_t>(static_cast<uint32_t>(c[2]) & 0x7fffu);
+            return r;
+        }
+        // 解包
+        MATHLIB_CALL(Quaternion) Decode() const noexcept
+        {
+            const int32_t c[3] = { quantize::SignExtend<15>(v[0]), quantize::SignExtend<15>(v[1]), quantize::SignExtend<15>(v[2]) };
+            return SmallestThreeDecode(c, (v[0] >> 15) | ((v[1] >> 15) << 1), 16383.0f);
+        }
+        // 批量打包
+        static void Encode(const Quaternion *in, PackedQuaternion48 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(EncodeQuaternion48, in->GetPtr(), out->v, n);
+        }
+        // 批量解包
+        static void Decode(const PackedQuaternion48 *in, Quaternion *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(DecodeQuaternion48, in->v, out->GetPtr(), n);
+        }
+        // 找出绝对值最大的分量的下标, 其余三个分量乘以√2(最大为正时)后按scale量化到c中
+        static uint32_t SmallestThree(const Quaternion q, float32 scale, int32_t *c) noexcept
+        {
+            const float32 e[4] = { q.X(), q.Y(), q.Z(), q.W() };
+            uint32_t idx = 0;
+            for (uint32_t k = 1; k < 4; k += 1)
+            {
+                if (fabsf(e[idx]) < fabsf(e[k]))
+                {
+                    idx = k;
+                }
+            }
+            const float32 s = e[idx] < 0.0f ? -1.41421356f : 1.41421356f;
+            for (uint32_t j = 0; j < 3; j += 1)
+            {
+                c[j] = quantize::Snorm(e[j < idx ? j : j + 1] * s, scale);
+            }
+            return idx;
+        }
+        // SmallestThree的逆操作
+        static Quaternion SmallestThreeDecode(const int32_t *c, uint32_t idx, float32 scale) noexcept
+        {
+            const float32 k = 0.70710678f / scale;
+            const float32 f[3] = { c[0] * k, c[1] * k, c[2] * k };
+            const float32 s = 1.0f - f[0] * f[0] - f[1] * f[1] - f[2] * f[2];
+            float32 e[4];
+            for (uint32_t j = 0, m = 0; j < 4; j += 1)
+            {
+                e[j] = j == idx ? sqrtf(s > 0.0f ? s : 0.0f) : f[m++];
+            }
+            return Quaternion(e[0], e[1], e[2], e[3]);
+        }
+    };
+    // 最小三分量编码的单位四元数, 8字节: 三个分量各20位, 下标2位(最高2位未使用)
+    // 第1个uint32_t = c0 | c1的低12位 << 20, 第2个uint32_t = c1的高8位 | c2 << 8 | idx << 28
+    // 误差: 推导方法同PackedQuaternion48. 存储的三个分量的绝对误差不超过1.1e-6(半个量化步长6.7e-7, 加上float32的舍入),
+    // 由单位长度求得的分量不超过3.4e-6, 旋转角的误差在0.0005度以内
+    struct PackedQuaternion64
+    {
+        uint32_t v[2];
+
+        // 打包, q必须是归一化的
+        static PackedQuaternion64 Encode(const Quaternion q) noexcept
+        {
+            int32_t c[3];
+            const uint32_t idx = PackedQuaternion48::SmallestThree(q, 524287.0f, c);
+            const uint32_t c1 = static_cast<uint32_t>(c[1]);
+            PackedQuaternion64 r;
+            r.v[0] = (static_cast<uint32_t>(c[0]) & 0xfffffu) | (c1 << 20);
+            r.v[1] = ((c1 >> 12) & 0xffu) | ((static_cast<uint32_t>(c[2]) & 0xfffffu) << 8) | (idx << 28);
+            return r;
+        }
+        // 解包
+        MATHLIB_CALL(Quaternion) Decode() const noexcept
+        {
+            const int32_t c[3] = {
+                quantize::SignExtend<20>(v[0]),
+                quantize::SignExtend<20>((v[0] >> 20) | ((v[1] & 0xffu) << 12)),
+                quantize::SignExtend<20>(v[1] >> 8),
+            };
+            return PackedQuaternion48::SmallestThreeDecode(c, (v[1] >> 28) & 3u, 524287.0f);
+        }
+        // 批量打包
+        static void Encode(const Quaternion *in, PackedQuaternion64 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(EncodeQuaternion64, in->GetPtr(), out->v, n);
+        }
+        // 批量解包
+        static void Decode(const PackedQuaternion64 *in, Quaternion *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(DecodeQuaternion64, in->v, out->GetPtr(), n);
+        }
+    };
+    static_assert(sizeof(HalfVector3) == 6, "HalfVector3 must be 6 bytes");
+    static_assert(sizeof(OctNormal) == 4, "OctNormal must be 4 bytes");
+    static_assert(sizeof(Packed1010102) == 4, "Packed1010102 must be 4 bytes");
+    static_assert(sizeof(PackedQuaternion48) == 6, "PackedQuaternion48 must be 6 bytes");
+    static_assert(sizeof(PackedQuaternion64) == 8, "PackedQuaternion64 must be 8 bytes");
+}
@@ -0,0 +1,299 @@
+﻿/*
+ | Cirno
+ | 文件名称: parallel.hpp
+ | 文件作用: 工作窃取线程池与并行循环
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 工作窃取(work-stealing)线程池: 每个工作线程有自己的任务队列, 从队尾取任务, 空闲时从其他队列的队首窃取
+    // 并行循环把[begin, end)按grain分块, 任务不断对半拆分, 拆出的后一半放入队列, 因此被窃取的总是较大的一段;
+    // 调用者也参与计算, 等待期间会执行其他任务, 所以可以在任务中再次调用For(嵌套)
+    // 任务函数不能抛出异常
+    class ThreadPool final
+    {
+    public:
+        // 自动分块时每块至少这么多元素(批量内核处理一块约几微秒, 远大于任务调度的开销)
+        static const size_t MinGrain = 4096;
+
+        // threads为参与计算的线程数(包括调用者), 0表示使用所有硬件线程
+        explicit ThreadPool(size_t threads = 0) : stop(false), queued(0)
+        {
+            if (threads == 0)
+            {
+                threads = std::thread::hardware_concurrency();
+            }
+            threads = threads == 0 ? 1 : threads;
+            for (size_t k = 0; k < threads; k += 1)         // 最后一个队列给池外的线程(调用者)使用
+            {
+                queues.emplace_back(new Queue());
+            }
+            workers.reserve(threads - 1);
+            for (size_t k = 0; k + 1 < threads; k += 1)
+            {
+                workers.emplace_back(&ThreadPool::WorkerMain, this, k);
+            }
+        }
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stop = true;
+            }
+            sleep_cv.notify_all();
+            for (auto &w : workers)
+            {
+                w.join();
+            }
+        }
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool& operator=(const ThreadPool &) = delete;
+        // 参与计算的线程数(工作线程 + 调用者)
+        inline size_t Size() const noexcept
+        {
+            return workers.size() + 1;
+        }
+        // 默认的线程池, 使用所有硬件线程, 第一次使用时创建
+        static ThreadPool& Default()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+        // 自动选择分块大小: 每个线程约4块(负载不均时可以窃取), 至少minimum个元素, 并且是align的倍数
+        size_t Grain(size_t n, size_t minimum = MinGrain, size_t align = 1) const noexcept
+        {
+            const size_t parts = Size() * 4;
+            size_t g = (n + parts - 1) / parts;
+            g = g > minimum ? g : minimum;
+            g = (g + align - 1) / align * align;
+            return g == 0 ? 1 : g;
+        }
+        // 并行循环: 对[begin, end)的每一块调用f(b, e), 块的起点是begin + grain的倍数, 每块最多grain个元素
+        // 全部完成后返回; 只有一块或线程池只有一个线程时直接在调用者中执行
+        template<class F>
+        void For(size_t begin, size_t end, size_t grain, const F &f)
+        {
+            if (end <= begin)
+            {
+                return;
+            }
+            grain = grain == 0 ? 1 : grain;
+            const size_t chunks = (end - begin + grain - 1) / grain;
+            if (chunks == 1 || Size() == 1)
+            {
+                f(begin, end);
+                return;
+            }
+            Job job(&ThreadPool::Invoke<F>, &f, begin, end, grain, chunks);
+            Run(job);
+        }
+        // 并行归约: 每一块的结果为map(b, e), 再按块的顺序依次combine(前面的结果, 这一块的结果), 初值为init
+        // 块的划分只取决于grain, 与线程数和执行顺序无关, 所以浮点数的结果也是确定的
+        template<class T, class M, class C>
+        T Reduce(size_t begin, size_t end, size_t grain, T init, const M &map, const C &combine)
+        {
+            if (end <= begin)
+            {
+                return init;
+            }
+            grain = grain == 0 ? 1 : grain;
+            const size_t chunks = (end - begin + grain - 1) / grain;
+            std::vector<T> partial(chunks, init);
+            For(begin, end, grain, [&](size_t b, size_t e) {
+                partial[(b - begin) / grain] = map(b, e);
+            });
+            for (size_t k = 0; k < chunks; k += 1)
+            {
+                init = combine(init, partial[k]);
+            }
+            return init;
+        }
+    private:
+        // 一次并行循环
+        struct Job
+        {
+            void      (*invoke)(const void *f, size_t b, size_t e);
+            const void *f;
+            size_t      begin, end, grain;
+            std::atomic<size_t> remaining;                  // 尚未完成的块数
+
+            Job(void (*_invoke)(const void*, size_t, size_t), const void *_f, size_t _begin, size_t _end, size_t _grain, size_t chunks) noexcept
+                : invoke(_invoke), f(_f), begin(_begin), end(_end), grain(_grain), remaining(chunks)
+            {
+                // nothing to do
+            }
+        };
+        // 任务: job中下标为[first, last)的块
+        struct Task
+        {
+            Job   *job;
+            size_t first, last;
+        };
+        // 任务队列, 每个队列单独加锁
+        struct Queue
+        {
+            std::mutex       mutex;
+            std::deque<Task> tasks;
+        };
+
+        template<class F>
+        static void Invoke(const void *f, size_t b, size_t e)
+        {
+            (*static_cast<const F*>(f))(b, e);
+        }
+        // 当前线程在哪个线程池中, 使用第几个队列
+        struct ThreadSlot
+        {
+            const ThreadPool *pool;
+            size_t            index;
+        };
+        static ThreadSlot& CurrentSlot() noexcept
+        {
+            static thread_local ThreadSlot slot = { nullptr, 0 };
+            return slot;
+        }
+        // 当前线程自己的队列, 池外的线程共用最后一个队列
+        size_t OwnQueue() const noexcept
+        {
+            const ThreadSlot &slot = CurrentSlot();
+            return slot.pool == this ? slot.index : queues.size() - 1;
+        }
+        void Push(size_t q, const Task &t)
+        {
+            queued.fetch_add(1, std::memory_order_release);    // 先计数, 取出任务时计数不会小于0
+            {
+                std::lock_guard<std::mutex> lock(queues[q]->mutex);
+                queues[q]->tasks.push_back(t);
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);  // 与WorkerMain中的检查互斥, 不会丢失唤醒
+            }
+            sleep_cv.notify_one();
+        }
+        // 先从自己的队尾取(最近拆出的小任务, 数据还在缓存中), 再从其他队列的队首窃取(最早拆出的大任务)
+        bool Pop(size_t own, Task &t)
+        {
+            const size_t n = queues.size();
+            for (size_t k = 0; k < n; k += 1)
+            {
+                const size_t q = (own + k) % n;
+                std::lock_guard<std::mutex> lock(queues[q]->mutex);
+                std::deque<Task> &d = queues[q]->tasks;
+                if (!d.empty())
+                {
+                    if (k == 0)
+                    {
+                        t = d.back();
+                        d.pop_back();
+                    }
+                    else {
+                        t = d.front();
+                        d.pop_front();
+                    }
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+        // 执行任务: 不断对半拆分, 后一半放入自己的队列, 最后执行剩下的一块
+        void Execute(size_t own, Task t)
+        {
+            while (t.last - t.first > 1)
+            {
+                const size_t mid = t.first + (t.last - t.first) / 2;
+                Push(own, Task{ t.job, mid, t.last });
+                t.last = mid;
+            }
+            Job &job = *t.job;
+            const size_t b = job.begin + t.first * job.grain;
+            const size_t e = job.end - b > job.grain ? b + job.grain : job.end;
+            job.invoke(job.f, b, e);
+            job.remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        // 调用者: 放入整个任务后一起执行, 直到所有块都完成
+        void Run(Job &job)
+        {
+            const size_t own = OwnQueue();
+            Execute(own, Task{ &job, 0, job.remaining.load(std::memory_order_relaxed) });
+            Task t;
+            while (job.remaining.load(std::memory_order_acquire) != 0)
+            {
+                if (Pop(own, t))
+                {
+                    Execute(own, t);
+                }
+                else {
+                    std::this_thread::yield();              // 剩下的块正在其他线程中执行
+                }
+            }
+        }
+        void WorkerMain(size_t index)
+        {
+            CurrentSlot() = ThreadSlot{ this, index };
+            Task t;
+            for (;;)
+            {
+                if (Pop(index, t))
+                {
+                    Execute(index, t);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleep_cv.wait(lock, [this]() { return stop || queued.load(std::memory_order_acquire) != 0; });
+                if (stop)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> queues;         // queues[k]属于第k个工作线程, 最后一个属于池外的线程
+        std::vector<std::thread>            workers;
+        std::mutex                          sleep_mutex;    // 空闲的工作线程在sleep_cv上等待
+        std::condition_variable             sleep_cv;
+        bool                                stop;
+        std::atomic<size_t>                 queued;         // 所有队列中的任务数
+    };
+    // 并行循环, 使用默认的线程池; grain为0时自动选择(见ThreadPool::Grain)
+    template<class F>
+    inline void ParallelFor(size_t begin, size_t end, size_t grain, const F &f)
+    {
+        ThreadPool &pool = ThreadPool::Default();
+        pool.For(begin, end, grain == 0 ? pool.Grain(end - begin, 1) : grain, f);
+    }
+    // 并行归约, 使用默认的线程池; grain为0时自动选择(见ThreadPool::Grain)
+    template<class T, class M, class C>
+    inline T ParallelReduce(size_t begin, size_t end, size_t grain, T init, const M &map, const C &combine)
+    {
+        ThreadPool &pool = ThreadPool::Default();
+        return pool.Reduce(begin, end, grain == 0 ? pool.Grain(end - begin, 1) : grain, init, map, combine);
+    }
+}
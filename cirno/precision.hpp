@@ -0,0 +1,148 @@
+﻿/*
+ | Cirno
+ | 文件名称: precision.hpp
+ | 文件作用: 倒数与归一化的精度策略
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 精度策略, 作为SetNormalize, GetNormalize, SetInverse等函数的模板参数使用, 例如:
+    //   v.SetNormalize<precision::Fast>();
+    //   q.GetInverse<precision::Exact>();
+    // 不指定时使用precision::Default
+    // 不使用SSE时没有近似指令, 三种策略都使用除法和sqrtf
+    namespace precision
+    {
+        // rcpss/rsqrtss近似, 相对误差约1.5 * 2^-12, 延迟最低
+        struct Fast
+        {
+            static const int Level = 0;
+        };
+        // 近似值再做一次Newton-Raphson迭代, 相对误差约2^-22
+        struct Refined
+        {
+            static const int Level = 1;
+        };
+        // 除法与平方根, 正确舍入
+        struct Exact
+        {
+            static const int Level = 2;
+        };
+        // 默认策略, 可以通过定义_MATHLIB_PRECISION_DEFAULT为Fast, Refined, Exact修改
+    #if !defined(_MATHLIB_PRECISION_DEFAULT)
+        #define _MATHLIB_PRECISION_DEFAULT  Refined
+    #endif // _MATHLIB_PRECISION_DEFAULT
+        using Default = _MATHLIB_PRECISION_DEFAULT;
+
+        // 1 / x
+        inline float32 Recip(float32 x, Fast) noexcept
+        {
+        #if defined(_MATHLIB_USE_SSE)
+            return _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(x)));
+        #else
+            return 1.0f / x;
+        #endif // _MATHLIB_USE_SSE
+        }
+        // 1 / x
+        inline float32 Recip(float32 x, Refined) noexcept
+        {
+        #if defined(_MATHLIB_USE_SSE)
+            const float32 y = Recip(x, Fast());
+            return y * (2.0f - x * y);                          // y' = y(2 - xy)
+        #else
+            return 1.0f / x;
+        #endif // _MATHLIB_USE_SSE
+        }
+        // 1 / x
+        inline float32 Recip(float32 x, Exact) noexcept
+        {
+            return 1.0f / x;
+        }
+        // 1 / sqrt(x)
+        inline float32 RecipSqrt(float32 x, Fast) noexcept
+        {
+        #if defined(_MATHLIB_USE_SSE)
+            return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        #else
+            return 1.0f / sqrtf(x);
+        #endif // _MATHLIB_USE_SSE
+        }
+        // 1 / sqrt(x)
+        inline float32 RecipSqrt(float32 x, Refined) noexcept
+        {
+        #if defined(_MATHLIB_USE_SSE)
+            const float32 y = RecipSqrt(x, Fast());
+            return y * (1.5f - 0.5f * x * y * y);               // y' = y(3 - xy^2) / 2
+        #else
+            return 1.0f / sqrtf(x);
+        #endif // _MATHLIB_USE_SSE
+        }
+        // 1 / sqrt(x)
+        inline float32 RecipSqrt(float32 x, Exact) noexcept
+        {
+            return 1.0f / sqrtf(x);
+        }
+    #if defined(_MATHLIB_USE_SSE)
+        // r[k] = 1 / x[k]
+        inline __m128 Recip(const __m128 x, Fast) noexcept
+        {
+            return _mm_rcp_ps(x);
+        }
+        // r[k] = 1 / x[k]
+        inline __m128 Recip(const __m128 x, Refined) noexcept
+        {
+            const __m128 y = _mm_rcp_ps(x);
+            return _mm_mul_ps(y, _mm_sub_ps(_mm_set_ps1(2.0f), _mm_mul_ps(x, y)));
+        }
+        // r[k] = 1 / x[k]
+        inline __m128 Recip(const __m128 x, Exact) noexcept
+        {
+            return _mm_div_ps(_mm_set_ps1(1.0f), x);
+        }
+        // r[k] = 1 / sqrt(x[k])
+        inline __m128 RecipSqrt(const __m128 x, Fast) noexcept
+        {
+            return _mm_rsqrt_ps(x);
+        }
+        // r[k] = 1 / sqrt(x[k])
+        inline __m128 RecipSqrt(const __m128 x, Refined) noexcept
+        {
+            const __m128 y = _mm_rsqrt_ps(x);
+            const __m128 t = _mm_mul_ps(_mm_mul_ps(x, y), y);        // t = xy^2
+            return _mm_mul_ps(_mm_mul_ps(_mm_set_ps1(0.5f), y), _mm_sub_ps(_mm_set_ps1(3.0f), t));
+        }
+        // r[k] = 1 / sqrt(x[k])
+        inline __m128 RecipSqrt(const __m128 x, Exact) noexcept
+        {
+            return _mm_div_ps(_mm_set_ps1(1.0f), _mm_sqrt_ps(x));
+        }
+    #endif // _MATHLIB_USE_SSE
+    }
+}
@@ -3,7 +3,7 @@
  | 文件名称: quater.hpp
  | 文件作用: 四元数
  | 创建日期: 2021-03-26
- | 更新日期: 2021-04-01
+ | 更新日期: 2026-10-17
  | 开发人员: JuYan
  +----------------------------
  Copyright (C) JuYan, all rights reserved.
@@ -36,17 +36,17 @@
 namespace cirno
 {
     // 四元数
-    class Quaternion final : public Vector4
+    class alignas(16) Quaternion final : public Vector4
     {
     public:
         // 虚数部分
         using ImaginaryNum = Vector3;
 
-        Quaternion() noexcept : Vector4(1.0f, 0.0f, 0.0f, 0.0f)
+        constexpr Quaternion() noexcept : Vector4(1.0f, 0.0f, 0.0f, 0.0f)
         {
             // nothing to do...
         }
-        Quaternion(const Vector3 imag) noexcept : Vector4(0.0f, imag.X(), imag.Y(), imag.Z())
+        constexpr Quaternion(const Vector3 imag) noexcept : Vector4(0.0f, imag.X(), imag.Y(), imag.Z())
         {
             // nothing to do...
         }
@@ -58,16 +58,14 @@ namespace cirno
         {
             SetByEulerAngle(pitch, yaw, roll);
         }
-        Quaternion(float32 _a, float32 _b, float32 _c, float32 _d) noexcept : Vector4(_a, _b, _c, _d)
+        constexpr Quaternion(float32 _a, float32 _b, float32 _c, float32 _d) noexcept : Vector4(_a, _b, _c, _d)
         {
             // nothing to do...
         }
-    #if defined(_MATHLIB_USE_SSE)
-        Quaternion(__m128 _val) noexcept : Vector4(_val)
+        Quaternion(f32x4::Reg _val) noexcept : Vector4(_val)
         {
             // nothing to do...
         }
-    #endif // _MATHLIB_USE_SSE
         Quaternion(float32 v) = delete;
         ~Quaternion() = default;
         Quaternion(const Quaternion &) = default;
@@ -138,200 +136,153 @@ namespace cirno
             r.d = -d;
             return r;
         }
-        // 逆
+        // 逆, q^-1 = q共轭 / (||q||^2), P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Quaternion& SetInverse() noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 tmp[4];
-            // 首先计算||this||^2, 结果存放在 tmp[0]中
-            __m128 r = _mm_mul_ps(val, val);
-            _mm_store_ps(tmp, r);
-            tmp[0] = tmp[0] + tmp[1] + tmp[2] + tmp[3];
-            // 得到1 / length2
-            __m128 t = _mm_load_ps1(tmp);                       // t[0 .. 3] = length
-            __m128 k = _mm_rcp_ps(t);                           // k = 1 / length
-            // 计算数乘结果
-            __m128 o = _mm_mul_ps(k, t);
-            // 取得结果
-            _mm_store_ps(tmp, o);
-            // 最后取共轭, 因为q^-1 = q共轭 / (||q||^2), 因此就是最终答案
-            a = tmp[0];
-            b = -tmp[1];                                        // 反转虚部得到共轭
-            c = -tmp[2];
-            d = -tmp[3];
-        #else
-            float32 lensq = GetNormL2Square();                  // 模长的平方
-            SetConjugate();                                     // 求得共轭
-            this->operator*=(1.0f / lensq);                     // q^-1 = q共轭 / (||q||^2)
-        #endif // _MATHLIB_USE_SSE
+            const f32x4::Reg k = f32x4::Recip(f32x4::Dot4(val, val), P());    // k[0 .. 3] = 1 / ||q||^2
+            val = f32x4::Mul(val, f32x4::Mul(k, f32x4::Set(1.0f, -1.0f, -1.0f, -1.0f)));   // 实部乘k, 虚部乘-k得到共轭
             return *this;
         }
-        // 取得四元数的逆
+        // 取得四元数的逆, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         MATHLIB_CALL(Quaternion) GetInverse() const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 tmp[4];
-            __m128 r = _mm_mul_ps(val, val);
-            _mm_store_ps(tmp, r);
-            tmp[0] = tmp[0] + tmp[1] + tmp[2] + tmp[3];
-
-            __m128 t = _mm_load_ps1(tmp);
-            __m128 k = _mm_rcp_ps(t);
-
-            __m128 o = _mm_mul_ps(k, t);
-
-            _mm_store_ps(tmp, o);
-
-            return Quaternion(tmp[0], -tmp[1], -tmp[2], -tmp[3]);
-        #else
             Quaternion r(*this);
-            r.SetInverse();
-            return r;
-        #endif // _MATHLIB_USE_SSE
+            return r.SetInverse<P>();
         }
         // 四元数加法
         MATHLIB_CALL(Quaternion&) operator+=(const Quaternion b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_add_ps(val, b.val);
-        #else
-            x += b.x;
-            y += b.y;
-            z += b.z;
-            w += b.w;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Add(val, b.val);
             return *this;
         }
         // 四元数加法
         MATHLIB_CALL(Quaternion) operator+(const Quaternion b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Quaternion(_mm_add_ps(val, b.val));
-        #else
-            return Quaternion(x + b.x, y + b.y, z + b.z, w + b.w);
-        #endif // _MATHLIB_USE_SSE
+            return Quaternion(f32x4::Add(val, b.val));
         }
         // 四元数减法
         MATHLIB_CALL(Quaternion&) operator-=(const Quaternion b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_sub_ps(val, b.val);
-        #else
-            x -= b.x;
-            y -= b.y;
-            z -= b.z;
-            w -= b.w;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Sub(val, b.val);
             return *this;
         }
         // 四元数减法
         MATHLIB_CALL(Quaternion) operator-(const Quaternion b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Quaternion(_mm_sub_ps(val, b.val));
-        #else
-            return Quaternion(x - b.x, y - b.y, z - b.z, w - b.w);
-        #endif // _MATHLIB_USE_SSE
+            return Quaternion(f32x4::Sub(val, b.val));
         }
         // 四元数数乘
         MATHLIB_CALL(Quaternion&) operator*=(const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            val = _mm_mul_ps(val, t);
-        #else
-            x *= v;
-            y *= v;
-            z *= v;
-            w *= v;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Mul(val, f32x4::Splat(v));
             return *this;
         }
         // 四元数乘法(GraBmann积)
         MATHLIB_CALL(Quaternion&) operator*=(const Quaternion _b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 buff_v[4] = { b, c, d };
-            float32 buff_u[4] = { _b.b, _b.c, _b.d };
-            // 取得q1(b), q2(this)的虚部u, v
-            __m128 u = _mm_load_ps(buff_u);                     // q1 = [b.a u] u[0 .. 3] = (_b.b, _b.c. _b.d, _)
-            __m128 v = _mm_load_ps(buff_v);                     // q1 = [this.a v], v[0 .. 3] = (this.b, this.c. this.d, _)
-            // uleng = ||u||^2
-            float32 tmp_uleng[4];
-            __m128  ulengsq = _mm_mul_ps(u, u);                 // ulengsq[0 .. 3] = u[k] * u[k] = (u[k])^2
-            _mm_store_ps(tmp_uleng, ulengsq);                   // tmp_uleng[0]是计算得到的u的模长的平方
-            tmp_uleng[0] = tmp_uleng[0] + tmp_uleng[1] + tmp_uleng[2];
-            __m128 uleng = _mm_load_ss(tmp_uleng);
-            //   v CROSSMUL u
-            // = r1 - r2
-            // = v(y, z, x) MUL u(z, x, y) - v(z, x, y) MUL u(y, z, x)
-            // = t1 * t2 - t3 * t4
-            __m128 t1 = _mm_shuffle_ps(v, v, 0xc9);             // t1(y, z, x) := v(x, y, z)
-            __m128 t2 = _mm_shuffle_ps(u, u, 0xd2);             // t2(z, x, y) := u(x, y, z)
-            __m128 r1 = _mm_mul_ps(t1, t2);                     // r1[k] = t1[k] * t2[k]
-            __m128 t3 = _mm_shuffle_ps(v, v, 0xd2);             // t3(z, x, y) := v(x, y, z)
-            __m128 t4 = _mm_shuffle_ps(u, u, 0xc9);             // t4(y, z, x) := u(x, y, z)
-            __m128 r2 = _mm_mul_ps(t3, t4);                     // r2[k] = t3[k] * t4[k]
-            __m128 cr = _mm_sub_ps(r1, r2);                     // cr[k] = r1[k] - r2[k]   
-            //   this.a NUMBER_MUL u + b.a NUMBER_MUL v + v CROSSMUL u
-            // = this.a NUMBER_MUL u + b.a NUMBER_MUL v + cr
-            // = tv + tu + cr
-            // = tr
-            __m128 this_a = _mm_load_ps1(&a);
-            __m128 b_a = _mm_load_ps1(&_b.a);
-            __m128 tv = _mm_mul_ps(b_a, v);                     // tv[k] = b_a[k] * v[k]
-            __m128 tu = _mm_mul_ps(this_a, u);                  // tu[k] = this_a[k] * u[k]
-            __m128 ts = _mm_add_ps(tv, tu);                     // ts[k] = tu[k] + tv[k]
-            __m128 tr = _mm_add_ps(ts, cr);                     // tr[k] = ts[k] + cr[k]
-            //   a * _b.a - tmp_uleng[0]
-            // = this_a[0] * b_a[0] - tmp_uleng[0]
-            // = tm - uleng
-            // = ra
-            __m128 tm = _mm_mul_ss(this_a, b_a);
-            __m128 ra = _mm_sub_ss(tm, uleng);
-            //   tr(x, y, z, w)
-            // = ri(w, x, y, z)
-            __m128 ri = _mm_shuffle_ps(tr, tr, 0x93);           // ri(w, x, y, z) = tr(x, y, z, w)
-            // store
-            _mm_store_ps(buff, ri);                             // a, b, c, d = ri[0 .. 3]
-            _mm_store_ss(buff, ra);                             // a = ra[0]
-        #else
-            ImaginaryNum v = GetImaginaryPart();                // q1 = [this.a v]
-            ImaginaryNum u = _b.GetImaginaryPart();             // q2 = [b.a u]
-
-            float32 r = a * _b.a - u.GetNormL2Square();
-
-            ImaginaryNum t = v.CrossMul(u);                     // t = v CROSSMUL u
-            u *= a;
-            v *= _b.a;
-            t += u;
-            t += v;                                             // t = this.a * u + b.a * v + v * u
-
-            a = r;                                              // q1*q2 = [r t]
-            b = t.X();
-            c = t.Y();
-            d = t.Z();
-        #endif // _MATHLIB_USE_SSE
+            *this = Product(*this, _b);
             return *this;
         }
         // 四元数数乘
         friend MATHLIB_CALL(Quaternion) operator*(const Quaternion vec, const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            __m128 r = _mm_mul_ps(vec.val, t);
-            return Quaternion(r);
-        #else
-            return Quaternion(vec.x * v, vec.y * v, vec.z * v, vec.w * v);
-        #endif // _MATHLIB_USE_SSE
+            return Quaternion(f32x4::Mul(vec.val, f32x4::Splat(v)));
         }
         // 四元数乘法
-        MATHLIB_CALL(Quaternion) operator*(const Quaternion _b) noexcept
+        MATHLIB_CALL(Quaternion) operator*(const Quaternion _b) const noexcept
         {
-            Quaternion t(*this);
-            t *= _b;
-            return t;
+            return Product(*this, _b);                          // 直接得到结果, 不需要先复制*this
         }
+        // 旋转向量: v' = q * v * q^-1, q必须是归一化的
+        // u = (b, c, d), t = 2(u CROSSMUL v), v' = v + a * t + u CROSSMUL t, 不需要先转换为矩阵
+        MATHLIB_CALL(Vector3) Rotate(const Vector3 v) const noexcept
+        {
+            const ImaginaryNum u(f32x4::Shuffle<1, 2, 3, 0>(val));  // u[0 .. 3] = (b, c, d, a)
+            const Vector3 t = u.CrossMul(v) * 2.0f;
+            return v + t * a + u.CrossMul(t);
+        }
+        // 沿最短路径: 如果与from的点乘为负则取反(q与-q表示同一个旋转), 这样从from插值到this时走的是较短的一段弧
+        MATHLIB_CALL(Quaternion&) SetShortestPath(const Quaternion from) noexcept
+        {
+            if (DotMul(from) < 0.0f)
+            {
+                this->operator*=(-1.0f);
+            }
+            return *this;
+        }
+        // 取得沿最短路径的四元数
+        MATHLIB_CALL(Quaternion) GetShortestPath(const Quaternion from) const noexcept
+        {
+            return Quaternion(*this).SetShortestPath(from);
+        }
+        // 线性插值后归一化(nlerp), t ∈ [0, 1], 比Slerp快但角速度不均匀; shortest指定是否沿最短路径
+        template<class P = precision::Default>
+        static MATHLIB_CALL(Quaternion) Nlerp(const Quaternion q1, const Quaternion q2, const float32 t, bool shortest = true) noexcept
+        {
+            Quaternion q = shortest ? q2.GetShortestPath(q1) : q2;
+            return Normalized<P>(q1 * (1.0f - t) + q * t);
+        }
+        // 球面线性插值(slerp), t ∈ [0, 1], 角速度均匀; shortest指定是否沿最短路径
+        // q1, q2几乎重合时退化为Nlerp
+        template<class P = precision::Default>
+        static MATHLIB_CALL(Quaternion) Slerp(const Quaternion q1, const Quaternion q2, const float32 t, bool shortest = true) noexcept
+        {
+            Quaternion q = shortest ? q2.GetShortestPath(q1) : q2;
+            const float32 d = q1.DotMul(q);
+            float32 k1 = 1.0f - t;
+            float32 k2 = t;
+            if (fabsf(d) < 0.9995f)
+            {
+                const float32 theta = acosf(d);
+                const float32 s = 1.0f / sinf(theta);
+                k1 = sinf(k1 * theta) * s;                      // sin((1 - t)θ) / sinθ
+                k2 = sinf(k2 * theta) * s;                      // sin(tθ) / sinθ
+            }
+            return Normalized<P>(q1 * k1 + q * k2);
+        }
+        // 批量线性插值后归一化: out[k] = Nlerp(q1[k], q2[k], t[k]), out可以就是q1或q2
+        static void Nlerp(const Quaternion *q1, const Quaternion *q2, const float32 *t, Quaternion *out, size_t n, bool shortest = true) noexcept
+        {
+            MATHLIB_DISPATCH(QuaternionNlerp, q1->GetPtr(), q2->GetPtr(), t, out->GetPtr(), n, shortest);
+        }
+        // 批量球面线性插值: out[k] = Slerp(q1[k], q2[k], t[k]), out可以就是q1或q2
+        // acos, sin使用多项式近似(误差约1e-7), 每次处理Width个四元数
+        static void Slerp(const Quaternion *q1, const Quaternion *q2, const float32 *t, Quaternion *out, size_t n, bool shortest = true) noexcept
+        {
+            MATHLIB_DISPATCH(QuaternionSlerp, q1->GetPtr(), q2->GetPtr(), t, out->GetPtr(), n, shortest);
+        }
+        // 批量旋转向量(SoA): out[k] = q[k].Rotate(in[k]), q至少要有in.Size()个元素, out可以就是in
+        static void Rotate(const Quaternion *q, const Vector3Stream &in, Vector3Stream &out) noexcept
+        {
+            if (out.Resize(in.Size()))
+            {
+                MATHLIB_DISPATCH(QuaternionRotate, q->GetPtr(), in.XPtr(), in.YPtr(), in.ZPtr(), out.XPtr(), out.YPtr(), out.ZPtr(), in.Size());
+            }
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 批量线性插值后归一化, 分块后在pool中并行计算
+        static void Nlerp(ThreadPool &pool, const Quaternion *q1, const Quaternion *q2, const float32 *t, Quaternion *out, size_t n, bool shortest = true)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { Nlerp(q1 + b, q2 + b, t + b, out + b, e - b, shortest); });
+        }
+        // 批量球面线性插值, 分块后在pool中并行计算
+        static void Slerp(ThreadPool &pool, const Quaternion *q1, const Quaternion *q2, const float32 *t, Quaternion *out, size_t n, bool shortest = true)
+        {
+            pool.For(0, n, pool.Grain(n), [=](size_t b, size_t e) { Slerp(q1 + b, q2 + b, t + b, out + b, e - b, shortest); });
+        }
+        // 批量旋转向量(SoA), 分块后在pool中并行计算
+        static void Rotate(ThreadPool &pool, const Quaternion *q, const Vector3Stream &in, Vector3Stream &out)
+        {
+            if (out.Resize(in.Size()))
+            {
+                pool.For(0, in.Size(), pool.Grain(in.Size(), ThreadPool::MinGrain, Vector3Stream::Alignment), [&](size_t b, size_t e) {
+                    MATHLIB_DISPATCH(QuaternionRotate, q[b].GetPtr(), in.XPtr() + b, in.YPtr() + b, in.ZPtr() + b, out.XPtr() + b, out.YPtr() + b, out.ZPtr() + b, e - b);
+                });
+            }
+        }
+    #endif // _MATHLIB_USE_PARALLEL
         // 按照下标取得值, [0] = x, [1] = y, [2] = z, [3] = w
         float32& operator[](unsigned int i) noexcept
         {
@@ -345,6 +296,43 @@ namespace cirno
             return buff[i];
         }
     private:
+        // 四元数乘法: l * _b
+        static MATHLIB_CALL(Quaternion) Product(const Quaternion l, const Quaternion _b) noexcept
+        {
+            // 取得q1(l), q2(b)的虚部v, u, 第4个分量是实部, 不参与点乘
+            const f32x4::Reg v = f32x4::Shuffle<1, 2, 3, 0>(l.val);     // q1 = [l.a v], v[0 .. 3] = (l.b, l.c, l.d, l.a)
+            const f32x4::Reg u = f32x4::Shuffle<1, 2, 3, 0>(_b.val);    // q2 = [b.a u], u[0 .. 3] = (_b.b, _b.c, _b.d, _b.a)
+            // vu[0 .. 3] = v DOTMUL u, 不离开寄存器
+            const f32x4::Reg vu = f32x4::Dot3(v, u);
+            //   v CROSSMUL u
+            // = r1 - r2
+            // = v(y, z, x) MUL u(z, x, y) - v(z, x, y) MUL u(y, z, x)
+            const f32x4::Reg r1 = f32x4::Mul(f32x4::Shuffle<1, 2, 0, 3>(v), f32x4::Shuffle<2, 0, 1, 3>(u));
+            const f32x4::Reg r2 = f32x4::Mul(f32x4::Shuffle<2, 0, 1, 3>(v), f32x4::Shuffle<1, 2, 0, 3>(u));
+            const f32x4::Reg cr = f32x4::Sub(r1, r2);                   // cr[k] = r1[k] - r2[k]
+            //   l.a NUMBER_MUL u + b.a NUMBER_MUL v + v CROSSMUL u
+            // = tv + tu + cr
+            // = tr
+            const f32x4::Reg l_a = f32x4::Shuffle<0, 0, 0, 0>(l.val);   // l_a[0 .. 3] = l.a
+            const f32x4::Reg b_a = f32x4::Shuffle<0, 0, 0, 0>(_b.val);  // b_a[0 .. 3] = _b.a
+            const f32x4::Reg ts = f32x4::Add(f32x4::Mul(b_a, v), f32x4::Mul(l_a, u));
+            const f32x4::Reg tr = f32x4::Add(ts, cr);                   // tr[k] = ts[k] + cr[k]
+            //   l.a * _b.a - v DOTMUL u
+            // = l_a[0] * b_a[0] - vu[0]
+            // = ra
+            const f32x4::Reg ra = f32x4::Sub(f32x4::Mul(l_a, b_a), vu);
+            //   tr(x, y, z, w)
+            // = ri(w, x, y, z)
+            const f32x4::Reg ri = f32x4::Shuffle<3, 0, 1, 2>(tr);       // ri(w, x, y, z) = tr(x, y, z, w)
+            return Quaternion(f32x4::MoveFirst(ri, ra));                // a = ra[0], b, c, d = ri[1 .. 3]
+        }
+        // 归一化, 返回Quaternion而不是Vector4
+        template<class P>
+        static Quaternion Normalized(Quaternion q) noexcept
+        {
+            q.SetNormalize<P>();
+            return q;
+        }
         // 内存布局:
         // Z = a + bi + cj + dk
         // union
@@ -0,0 +1,179 @@
+﻿/*
+ | Cirno
+ | 文件名称: quaterd.hpp
+ | 文件作用: 双精度四元数
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 双精度四元数, Z = a + bi + cj + dk, 内存布局与Quaternion相同(a是实部)
+    class Quaterniond final : public Vector4d
+    {
+    public:
+        constexpr Quaterniond() noexcept : Vector4d(1.0, 0.0, 0.0, 0.0)
+        {
+            // nothing to do...
+        }
+        constexpr Quaterniond(const Vector3d &imag) noexcept : Vector4d(0.0, imag.X(), imag.Y(), imag.Z())
+        {
+            // nothing to do...
+        }
+        Quaterniond(const float64 angle, const Vector3d &axis) noexcept
+        {
+            SetByRotateAxis(angle, axis);
+        }
+        constexpr Quaterniond(float64 _a, float64 _b, float64 _c, float64 _d) noexcept : Vector4d(_a, _b, _c, _d)
+        {
+            // nothing to do...
+        }
+        explicit constexpr Quaterniond(const Quaternion q) noexcept : Vector4d(q.X(), q.Y(), q.Z(), q.W())
+        {
+            // nothing to do...
+        }
+        Quaterniond(const f64x4::Reg _val) noexcept : Vector4d(_val)
+        {
+            // nothing to do...
+        }
+        Quaterniond(float64 v) = delete;
+        ~Quaterniond() = default;
+        Quaterniond(const Quaterniond &) = default;
+        Quaterniond& operator=(const Quaterniond &) = default;
+        // 从绕某个向量旋转一个角度来设置四元数
+        MATHLIB_CALL(Quaterniond&) SetByRotateAxis(const float64 angle, const Vector3d &_axis) noexcept
+        {
+            const Vector3d axis = _axis.GetNormalize();
+            const float64 si = sin(0.5 * angle);
+            a = cos(0.5 * angle);
+            b = si * axis.X();
+            c = si * axis.Y();
+            d = si * axis.Z();
+            return *this;
+        }
+        // 从绕某个向量旋转一个角度来创建四元数
+        static MATHLIB_CALL(Quaterniond) RotateAxis(const float64 angle, const Vector3d &axis) noexcept
+        {
+            return Quaterniond(angle, axis);
+        }
+        // 取得虚数部分
+        MATHLIB_CALL(Vector3d) GetImaginaryPart() const noexcept
+        {
+            return Vector3d(b, c, d);
+        }
+        // 共轭
+        Quaterniond& SetConjugate() noexcept
+        {
+            b = -b;                                             // 反转虚部得到共轭
+            c = -c;
+            d = -d;
+            return *this;
+        }
+        // 取得四元数的共轭结果
+        MATHLIB_CALL(Quaterniond) GetConjugate() const noexcept
+        {
+            return Quaterniond(a, -b, -c, -d);
+        }
+        // 逆, q^-1 = q共轭 / (||q||^2)
+        Quaterniond& SetInverse() noexcept
+        {
+            const float64 k = 1.0 / DotMul(*this);
+            f64x4::Store(f64x4::Mul(GetReg(), f64x4::Set(k, -k, -k, -k)), buff);  // 实部乘k, 虚部乘-k得到共轭
+            return *this;
+        }
+        // 取得四元数的逆
+        MATHLIB_CALL(Quaterniond) GetInverse() const noexcept
+        {
+            Quaterniond t(*this);
+            return t.SetInverse();
+        }
+        // 四元数乘法(GraBmann积): [a1 v] * [a2 u] = [a1 * a2 - v · u, a1 * u + a2 * v + v × u]
+        MATHLIB_CALL(Quaterniond) operator*(const Quaterniond &q) const noexcept
+        {
+            return Quaterniond(a * q.a - b * q.b - c * q.c - d * q.d,
+                               a * q.b + b * q.a + c * q.d - d * q.c,
+                               a * q.c + c * q.a + d * q.b - b * q.d,
+                               a * q.d + d * q.a + b * q.c - c * q.b);
+        }
+        // 四元数乘法
+        MATHLIB_CALL(Quaterniond&) operator*=(const Quaterniond &q) noexcept
+        {
+            return *this = *this * q;
+        }
+        // 四元数数乘
+        friend MATHLIB_CALL(Quaterniond) operator*(const Quaterniond &q, const float64 v) noexcept
+        {
+            return Quaterniond(f64x4::Mul(q.GetReg(), f64x4::Splat(v)));
+        }
+        // 旋转向量: v' = q * v * q^-1, q必须是归一化的
+        // u = (b, c, d), t = 2(u CROSSMUL v), v' = v + a * t + u CROSSMUL t
+        MATHLIB_CALL(Vector3d) Rotate(const Vector3d &v) const noexcept
+        {
+            const Vector3d u = GetImaginaryPart();
+            const Vector3d t = u.CrossMul(v) * 2.0;
+            return v + t * a + u.CrossMul(t);
+        }
+        // 沿最短路径: 如果与from的点乘为负则取反(q与-q表示同一个旋转)
+        MATHLIB_CALL(Quaterniond) GetShortestPath(const Quaterniond &from) const noexcept
+        {
+            return DotMul(from) < 0.0 ? Quaterniond(-a, -b, -c, -d) : *this;
+        }
+        // 球面线性插值(slerp), t ∈ [0, 1], 角速度均匀; shortest指定是否沿最短路径
+        // q1, q2几乎重合时退化为线性插值后归一化
+        static MATHLIB_CALL(Quaterniond) Slerp(const Quaterniond &q1, const Quaterniond &q2, const float64 t, bool shortest = true) noexcept
+        {
+            const Quaterniond q = shortest ? q2.GetShortestPath(q1) : q2;
+            const float64 d = q1.DotMul(q);
+            float64 k1 = 1.0 - t;
+            float64 k2 = t;
+            if (fabs(d) < 0.9999999)
+            {
+                const float64 theta = acos(d);
+                const float64 s = 1.0 / sin(theta);
+                k1 = sin(k1 * theta) * s;                       // sin((1 - t)θ) / sinθ
+                k2 = sin(k2 * theta) * s;                       // sin(tθ) / sinθ
+            }
+            return Normalized(Quaterniond(f64x4::MulAdd(q1.GetReg(), f64x4::Splat(k1), f64x4::Mul(q.GetReg(), f64x4::Splat(k2)))));
+        }
+        // 归一化, 返回Quaterniond而不是Vector4d
+        static Quaterniond Normalized(Quaterniond q) noexcept
+        {
+            q.SetNormalize();
+            return q;
+        }
+        // 转换为单精度
+        MATHLIB_CALL(Quaternion) ToQuaternion() const noexcept
+        {
+        #if defined(_MATHLIB_USE_SSE)
+            return Quaternion(f64x4::ToFloat(GetReg()));
+        #else
+            return Quaternion(static_cast<float32>(a), static_cast<float32>(b), static_cast<float32>(c), static_cast<float32>(d));
+        #endif // _MATHLIB_USE_SSE
+        }
+    };
+}
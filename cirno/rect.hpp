@@ -1,9 +1,9 @@
 ﻿/*
  | Cirno
  | 文件名称: rect.hpp
- | 文件作用: 矩形
+ | 文件作用: 矩形与矩形流(SoA批量运算)
  | 创建日期: 2021-03-26
- | 更新日期: 2021-03-27
+ | 更新日期: 2026-10-17
  | 开发人员: JuYan
  +----------------------------
  Copyright (C) JuYan, all rights reserved.
@@ -31,39 +31,125 @@
  SOFTWARE.
 */
 #pragma once
+#include "kernel.hpp"
+#include "allocator.hpp"
 namespace cirno
 {
     // 浮点数矩形
+    // 范围是[left, right) x [top, bottom)(左闭右开), left >= right或top >= bottom时是空矩形
     struct RectF
     {
         float32 left, right;
         float32 top, bottom;
         RectF() = default;
-        RectF(float32 l, float32 r, float32 t, float32 b) noexcept
+        constexpr RectF(float32 l, float32 r, float32 t, float32 b) noexcept : left(l), right(r), top(t), bottom(b)
         {
-            left = l;
-            right = r;
-
-            top = t;
-            bottom = b;
+            // nothing to do
+        }
+        // 宽度
+        constexpr float32 Width() const noexcept
+        {
+            return right - left;
+        }
+        // 高度
+        constexpr float32 Height() const noexcept
+        {
+            return bottom - top;
+        }
+        // 是否是空矩形
+        constexpr bool IsEmpty() const noexcept
+        {
+            return !(left < right && top < bottom);
+        }
+        // 是否包含点(x, y)
+        constexpr bool Contains(float32 x, float32 y) const noexcept
+        {
+            return left <= x && x < right && top <= y && y < bottom;
+        }
+        // 是否完全包含b, 空矩形不被任何矩形包含
+        constexpr bool Contains(const RectF &b) const noexcept
+        {
+            return !b.IsEmpty() && left <= b.left && b.right <= right && top <= b.top && b.bottom <= bottom;
+        }
+        // 是否与b相交(交集不是空矩形)
+        constexpr bool Intersects(const RectF &b) const noexcept
+        {
+            return left < b.right && b.left < right && top < b.bottom && b.top < bottom && !IsEmpty() && !b.IsEmpty();
+        }
+        // 取得交集, 不相交时结果是空矩形
+        constexpr RectF GetIntersection(const RectF &b) const noexcept
+        {
+            return RectF(
+                left > b.left ? left : b.left,
+                right < b.right ? right : b.right,
+                top > b.top ? top : b.top,
+                bottom < b.bottom ? bottom : b.bottom
+            );
+        }
+        // 取得包围两个矩形的最小矩形, 忽略空矩形
+        constexpr RectF GetUnion(const RectF &b) const noexcept
+        {
+            return IsEmpty() ? b : b.IsEmpty() ? *this : RectF(
+                left < b.left ? left : b.left,
+                right > b.right ? right : b.right,
+                top < b.top ? top : b.top,
+                bottom > b.bottom ? bottom : b.bottom
+            );
+        }
+        // 裁剪到bounds的范围内(求交集)
+        MATHLIB_CONSTEXPR14 RectF& Clip(const RectF &bounds) noexcept
+        {
+            *this = GetIntersection(bounds);
+            return *this;
+        }
+        // 交换left > right或top > bottom的边, 例如y轴向上时top > bottom
+        MATHLIB_CONSTEXPR14 RectF& SetNormalize() noexcept
+        {
+            if (right < left)
+            {
+                const float32 t = left;
+                left = right;
+                right = t;
+            }
+            if (bottom < top)
+            {
+                const float32 t = top;
+                top = bottom;
+                bottom = t;
+            }
+            return *this;
+        }
+        constexpr RectF GetNormalize() const noexcept
+        {
+            return RectF(
+                right < left ? right : left,
+                right < left ? left : right,
+                bottom < top ? bottom : top,
+                bottom < top ? top : bottom
+            );
+        }
+        constexpr bool operator==(const RectF &b) const noexcept
+        {
+            return left == b.left && right == b.right && top == b.top && bottom == b.bottom;
+        }
+        constexpr bool operator!=(const RectF &b) const noexcept
+        {
+            return !(*this == b);
         }
     };
     // 整数矩形
+    // 范围是[left, right) x [top, bottom)(左闭右开), left >= right或top >= bottom时是空矩形
     struct RectI32
     {
         int32_t left, right;
         int32_t top, bottom;
         RectI32() = default;
-        RectI32(int32_t l, int32_t r, int32_t t, int32_t b) noexcept
+        constexpr RectI32(int32_t l, int32_t r, int32_t t, int32_t b) noexcept : left(l), right(r), top(t), bottom(b)
         {
-            left = l;
-            right = r;
-
-            top = t;
-            bottom = b;
+            // nothing to do
         }
         // 隐式转换
-        operator RectF() const noexcept
+        constexpr operator RectF() const noexcept
         {
             return RectF(
                 static_cast<float32>(left),
@@ -72,6 +158,364 @@ namespace cirno
                 static_cast<float32>(bottom)
             );
         }
+        // 宽度
+        constexpr int32_t Width() const noexcept
+        {
+            return right - left;
+        }
+        // 高度
+        constexpr int32_t Height() const noexcept
+        {
+            return bottom - top;
+        }
+        // 是否是空矩形
+        constexpr bool IsEmpty() const noexcept
+        {
+            return !(left < right && top < bottom);
+        }
+        // 是否包含点(x, y)
+        constexpr bool Contains(int32_t x, int32_t y) const noexcept
+        {
+            return left <= x && x < right && top <= y && y < bottom;
+        }
+        // 是否完全包含b, 空矩形不被任何矩形包含
+        constexpr bool Contains(const RectI32 &b) const noexcept
+        {
+            return !b.IsEmpty() && left <= b.left && b.right <= right && top <= b.top && b.bottom <= bottom;
+        }
+        // 是否与b相交(交集不是空矩形)
+        constexpr bool Intersects(const RectI32 &b) const noexcept
+        {
+            return left < b.right && b.left < right && top < b.bottom && b.top < bottom && !IsEmpty() && !b.IsEmpty();
+        }
+        // 取得交集, 不相交时结果是空矩形
+        constexpr RectI32 GetIntersection(const RectI32 &b) const noexcept
+        {
+            return RectI32(
+                left > b.left ? left : b.left,
+                right < b.right ? right : b.right,
+                top > b.top ? top : b.top,
+                bottom < b.bottom ? bottom : b.bottom
+            );
+        }
+        // 取得包围两个矩形的最小矩形, 忽略空矩形
+        constexpr RectI32 GetUnion(const RectI32 &b) const noexcept
+        {
+            return IsEmpty() ? b : b.IsEmpty() ? *this : RectI32(
+                left < b.left ? left : b.left,
+                right > b.right ? right : b.right,
+                top < b.top ? top : b.top,
+                bottom > b.bottom ? bottom : b.bottom
+            );
+        }
+        // 裁剪到bounds的范围内(求交集)
+        MATHLIB_CONSTEXPR14 RectI32& Clip(const RectI32 &bounds) noexcept
+        {
+            *this = GetIntersection(bounds);
+            return *this;
+        }
+        // 交换left > right或top > bottom的边, 例如y轴向上时top > bottom
+        MATHLIB_CONSTEXPR14 RectI32& SetNormalize() noexcept
+        {
+            if (right < left)
+            {
+                const int32_t t = left;
+                left = right;
+                right = t;
+            }
+            if (bottom < top)
+            {
+                const int32_t t = top;
+                top = bottom;
+                bottom = t;
+            }
+            return *this;
+        }
+        constexpr RectI32 GetNormalize() const noexcept
+        {
+            return RectI32(
+                right < left ? right : left,
+                right < left ? left : right,
+                bottom < top ? bottom : top,
+                bottom < top ? top : bottom
+            );
+        }
+        constexpr bool operator==(const RectI32 &b) const noexcept
+        {
+            return left == b.left && right == b.right && top == b.top && bottom == b.bottom;
+        }
+        constexpr bool operator!=(const RectI32 &b) const noexcept
+        {
+            return !(*this == b);
+        }
     };
-}
 
+    // 矩形流, left, right, top, bottom分别存放在四段64字节对齐的数组中(SoA), R为RectF或RectI32
+    // 批量运算每条指令处理4(SSE4.1), 8(AVX2)或16(AVX-512)个矩形; 容量按16个元素向上取整
+    template<class R>
+    class RectStream final
+    {
+    public:
+        // 分量的类型: float32或int32_t
+        using Scalar = decltype(R::left);
+        // 容量的粒度
+        static const size_t Alignment = 16;
+
+        RectStream() noexcept : buff(nullptr), count(0), capacity(0)
+        {
+            // nothing to do
+        }
+        explicit RectStream(size_t n) noexcept : buff(nullptr), count(0), capacity(0)
+        {
+            Resize(n);
+        }
+        RectStream(const R *rects, size_t n) noexcept : buff(nullptr), count(0), capacity(0)
+        {
+            Load(rects, n);
+        }
+        // 内存分配失败时是空流
+        RectStream(const RectStream &b) noexcept : buff(nullptr), count(0), capacity(0)
+        {
+            Assign(b);
+        }
+        RectStream(RectStream &&b) noexcept : buff(b.buff), count(b.count), capacity(b.capacity)
+        {
+            b.buff = nullptr;
+            b.count = 0;
+            b.capacity = 0;
+        }
+        // 内存分配失败时与复制构造一样成为空流, 需要保留原有数据时使用Assign
+        RectStream& operator=(const RectStream &b) noexcept
+        {
+            if (!Assign(b))
+            {
+                Clear();
+            }
+            return *this;
+        }
+        RectStream& operator=(RectStream &&b) noexcept
+        {
+            std::swap(buff, b.buff);
+            std::swap(count, b.count);
+            std::swap(capacity, b.capacity);
+            return *this;
+        }
+        ~RectStream()
+        {
+            AlignedFree(buff);
+        }
+        // 预留至少n个元素的空间. 内存分配失败返回false, 原有数据保持不变
+        bool Reserve(size_t n) noexcept
+        {
+            if (n <= capacity)
+            {
+                return true;
+            }
+            const size_t cap = (n + Alignment - 1) / Alignment * Alignment;
+            Scalar *p = static_cast<Scalar*>(AlignedAlloc(4 * cap * sizeof(Scalar), 64));
+            if (p == nullptr)
+            {
+                return false;
+            }
+            for (int c = 0; c < 4; c += 1)
+            {
+                if (count != 0)
+                {
+                    memcpy(p + c * cap, buff + c * capacity, count * sizeof(Scalar));
+                }
+            }
+            AlignedFree(buff);
+            buff = p;
+            capacity = cap;
+            return true;
+        }
+        // 改变元素个数, 新增的元素为(0, 0, 0, 0). 内存分配失败返回false, 原有数据保持不变
+        bool Resize(size_t n) noexcept
+        {
+            if (!Reserve(n))
+            {
+                return false;
+            }
+            if (n > count)
+            {
+                for (int c = 0; c < 4; c += 1)
+                {
+                    memset(buff + c * capacity + count, 0, (n - count) * sizeof(Scalar));
+                }
+            }
+            count = n;
+            return true;
+        }
+        // 复制b的全部元素. 内存分配失败返回false, 原有数据保持不变
+        bool Assign(const RectStream &b) noexcept
+        {
+            if (this == &b)
+            {
+                return true;
+            }
+            if (!Resize(b.count))
+            {
+                return false;
+            }
+            if (count != 0)                                 // 空流的buff可能是nullptr
+            {
+                for (int c = 0; c < 4; c += 1)
+                {
+                    memcpy(buff + c * capacity, b.buff + c * b.capacity, count * sizeof(Scalar));
+                }
+            }
+            return true;
+        }
+        // 在末尾添加一个矩形, 容量按2倍增长
+        bool Push(const R &rc) noexcept
+        {
+            if (count == capacity && !Reserve(capacity == 0 ? Alignment : 2 * capacity))
+            {
+                return false;
+            }
+            count += 1;
+            Set(count - 1, rc);
+            return true;
+        }
+        // 清空
+        void Clear() noexcept
+        {
+            count = 0;
+        }
+        // 元素个数
+        inline size_t Size() const noexcept
+        {
+            return count;
+        }
+        // 已分配的容量(Alignment的倍数)
+        inline size_t Capacity() const noexcept
+        {
+            return capacity;
+        }
+        // 从矩形数组载入
+        bool Load(const R *rects, size_t n) noexcept
+        {
+            count = 0;
+            if (!Resize(n))
+            {
+                return false;
+            }
+            Scalar *pl = LeftPtr(), *pr = RightPtr(), *pt = TopPtr(), *pb = BottomPtr();
+            for (size_t i = 0; i < n; i += 1)
+            {
+                pl[i] = rects[i].left;
+                pr[i] = rects[i].right;
+                pt[i] = rects[i].top;
+                pb[i] = rects[i].bottom;
+            }
+            return true;
+        }
+        // 写出到矩形数组, rects至少要有Size()个元素
+        void Store(R *rects) const noexcept
+        {
+            for (size_t i = 0; i < count; i += 1)
+            {
+                rects[i] = Get(i);
+            }
+        }
+        // 取得第i个元素
+        inline R Get(size_t i) const noexcept
+        {
+            assert(i < count);
+            return R(LeftPtr()[i], RightPtr()[i], TopPtr()[i], BottomPtr()[i]);
+        }
+        // 设置第i个元素
+        inline void Set(size_t i, const R &rc) noexcept
+        {
+            assert(i < count);
+            LeftPtr()[i] = rc.left;
+            RightPtr()[i] = rc.right;
+            TopPtr()[i] = rc.top;
+            BottomPtr()[i] = rc.bottom;
+        }
+        // 与q相交的矩形的下标按顺序写入hits(至少要有Size()个元素), 返回个数
+        size_t Overlaps(const R &q, uint32_t *hits) const noexcept
+        {
+            if (q.IsEmpty())
+            {
+                return 0;
+            }
+            const Scalar qv[4] = { q.left, q.right, q.top, q.bottom };
+            size_t n = 0;
+            MATHLIB_DISPATCH(RectOverlaps, LeftPtr(), RightPtr(), TopPtr(), BottomPtr(), count, qv, hits, n);
+            return n;
+        }
+        // 完全在q内的矩形的下标按顺序写入hits, 返回个数
+        size_t Inside(const R &q, uint32_t *hits) const noexcept
+        {
+            const Scalar qv[4] = { q.left, q.right, q.top, q.bottom };
+            size_t n = 0;
+            MATHLIB_DISPATCH(RectInside, LeftPtr(), RightPtr(), TopPtr(), BottomPtr(), count, qv, hits, n);
+            return n;
+        }
+        // 包含点(x, y)的矩形的下标按顺序写入hits, 返回个数(例如界面的点击测试)
+        size_t ContainPoint(Scalar x, Scalar y, uint32_t *hits) const noexcept
+        {
+            size_t n = 0;
+            MATHLIB_DISPATCH(RectContainPoint, LeftPtr(), RightPtr(), TopPtr(), BottomPtr(), count, x, y, hits, n);
+            return n;
+        }
+        // 每个矩形裁剪到bounds的范围内, 完全在外面的矩形变为空矩形
+        RectStream& Clip(const R &bounds) noexcept
+        {
+            const Scalar qv[4] = { bounds.left, bounds.right, bounds.top, bounds.bottom };
+            MATHLIB_DISPATCH(RectClip, LeftPtr(), RightPtr(), TopPtr(), BottomPtr(), count, qv);
+            return *this;
+        }
+        // 包围所有非空矩形的最小矩形, 没有非空矩形时为(0, 0, 0, 0)
+        R Bounds() const noexcept
+        {
+            Scalar r[4];
+            MATHLIB_DISPATCH(RectBounds, LeftPtr(), RightPtr(), TopPtr(), BottomPtr(), count, r);
+            return R(r[0], r[1], r[2], r[3]);
+        }
+        // 取得left分量数组
+        inline Scalar* LeftPtr() noexcept
+        {
+            return buff;
+        }
+        inline const Scalar* LeftPtr() const noexcept
+        {
+            return buff;
+        }
+        // 取得right分量数组
+        inline Scalar* RightPtr() noexcept
+        {
+            return buff + capacity;
+        }
+        inline const Scalar* RightPtr() const noexcept
+        {
+            return buff + capacity;
+        }
+        // 取得top分量数组
+        inline Scalar* TopPtr() noexcept
+        {
+            return buff + 2 * capacity;
+        }
+        inline const Scalar* TopPtr() const noexcept
+        {
+            return buff + 2 * capacity;
+        }
+        // 取得bottom分量数组
+        inline Scalar* BottomPtr() noexcept
+        {
+            return buff + 3 * capacity;
+        }
+        inline const Scalar* BottomPtr() const noexcept
+        {
+            return buff + 3 * capacity;
+        }
+    private:
+        // 内存布局: left[capacity], right[capacity], top[capacity], bottom[capacity], 每段起始地址都是64字节对齐
+        Scalar *buff;
+        size_t  count;
+        size_t  capacity;
+    };
+    using RectFStream = RectStream<RectF>;
+    using RectI32Stream = RectStream<RectI32>;
+}
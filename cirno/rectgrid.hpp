@@ -0,0 +1,254 @@
+﻿/*
+ | Cirno
+ | 文件名称: rectgrid.hpp
+ | 文件作用: 二维均匀网格空间索引(矩形的重叠查询)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "rect.hpp"
+#include "kernel.hpp"
+namespace cirno
+{
+    // 二维均匀网格: 把所有矩形的包围范围分成cols x rows个相同大小的格子, 每个格子记录与它重叠的矩形
+    // 格子中的矩形按SoA存放(RectFStream), 查询时对每个格子调用批量相交测试; 跨多个格子的矩形只在交集左上角所在的格子报告一次
+    // 建立索引是O(n)的计数排序(没有逐个格子的小数组), 矩形每帧都移动时直接重新Build
+    class RectGrid final
+    {
+    public:
+        RectGrid() noexcept : bounds(0.0f, 0.0f, 0.0f, 0.0f), inv_w(0.0f), inv_h(0.0f), cols(0), rows(0), size(0)
+        {
+            // nothing to do
+        }
+        // 用rects[0 .. n)建立索引, 矩形的编号就是下标, 空矩形不会被查询到
+        // cell_size为格子的边长, 0表示按矩形的平均尺寸自动选择; 格子数不超过非空矩形数的4倍
+        void Build(const RectF *rects, size_t n, float32 cell_size = 0.0f)
+        {
+            size = n;
+            cols = 0;
+            rows = 0;
+            cell_begin.clear();
+            ids.clear();
+            entries.Clear();
+            // 包围范围与平均尺寸
+            RectF all(0.0f, 0.0f, 0.0f, 0.0f);
+            float64 extent = 0.0;
+            size_t valid = 0;
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (!rects[i].IsEmpty())
+                {
+                    all = all.GetUnion(rects[i]);
+                    extent += rects[i].Width() > rects[i].Height() ? rects[i].Width() : rects[i].Height();
+                    valid += 1;
+                }
+            }
+            if (valid == 0)
+            {
+                return;
+            }
+            bounds = all;
+            const float64 w = bounds.Width(), h = bounds.Height();
+            float64 cell = cell_size > 0.0f ? cell_size : 2.0 * extent / static_cast<float64>(valid);
+            const float64 limit = 4.0 * static_cast<float64>(valid);
+            if (w * h > limit * cell * cell)
+            {
+                cell = sqrt(w * h / limit);
+            }
+            cols = CellCount(w / cell);
+            rows = CellCount(h / cell);
+            inv_w = static_cast<float32>(cols / w);
+            inv_h = static_cast<float32>(rows / h);
+            // 第一遍: 统计每个格子的矩形个数, cell_begin[c + 1] = 格子c的个数
+            cell_begin.assign(static_cast<size_t>(cols) * rows + 1, 0);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (!rects[i].IsEmpty())
+                {
+                    const int32_t x0 = CellX(rects[i].left), x1 = CellX(rects[i].right);
+                    const int32_t y0 = CellY(rects[i].top), y1 = CellY(rects[i].bottom);
+                    for (int32_t y = y0; y <= y1; y += 1)
+                    {
+                        for (int32_t x = x0; x <= x1; x += 1)
+                        {
+                            cell_begin[static_cast<size_t>(y) * cols + x + 1] += 1;
+                        }
+                    }
+                }
+            }
+            for (size_t c = 1; c < cell_begin.size(); c += 1)
+            {
+                cell_begin[c] += cell_begin[c - 1];
+            }
+            // 第二遍: 按格子的顺序写入, 格子内按编号的顺序排列
+            const size_t total = cell_begin.back();
+            ids.resize(total);
+            if (!entries.Resize(total))
+            {
+                cols = 0;
+                rows = 0;
+                return;
+            }
+            cursor.assign(cell_begin.begin(), cell_begin.end() - 1);
+            for (size_t i = 0; i < n; i += 1)
+            {
+                if (!rects[i].IsEmpty())
+                {
+                    const int32_t x0 = CellX(rects[i].left), x1 = CellX(rects[i].right);
+                    const int32_t y0 = CellY(rects[i].top), y1 = CellY(rects[i].bottom);
+                    for (int32_t y = y0; y <= y1; y += 1)
+                    {
+                        for (int32_t x = x0; x <= x1; x += 1)
+                        {
+                            const uint32_t k = cursor[static_cast<size_t>(y) * cols + x]++;
+                            ids[k] = static_cast<uint32_t>(i);
+                            entries.Set(k, rects[i]);
+                        }
+                    }
+                }
+            }
+        }
+        // 与q相交的矩形的编号追加到out的末尾(没有排序, 每个矩形只出现一次), 返回追加的个数
+        size_t Query(const RectF &q, std::vector<uint32_t> &out) const
+        {
+            if (cols == 0 || !q.Intersects(bounds))
+            {
+                return 0;
+            }
+            const size_t start = out.size();
+            const float32 qv[4] = { q.left, q.right, q.top, q.bottom };
+            const int32_t qx0 = CellX(q.left), qx1 = CellX(q.right);
+            const int32_t qy0 = CellY(q.top), qy1 = CellY(q.bottom);
+            for (int32_t y = qy0; y <= qy1; y += 1)
+            {
+                // 同一行的格子在entries中是连续的, 整行一起测试
+                const size_t row = static_cast<size_t>(y) * cols;
+                const size_t b = cell_begin[row + qx0], n = cell_begin[row + qx1 + 1] - b;
+                if (n == 0)
+                {
+                    continue;
+                }
+                // 先把相对下标写入out的末尾, 再原地换成编号并去掉重复的
+                const size_t base = out.size();
+                out.resize(base + n);
+                size_t hit = 0;
+                MATHLIB_DISPATCH(RectOverlaps, entries.LeftPtr() + b, entries.RightPtr() + b, entries.TopPtr() + b, entries.BottomPtr() + b,
+                                 n, qv, out.data() + base, hit);
+                size_t k = base;
+                for (size_t j = 0; j < hit; j += 1)
+                {
+                    const size_t e = b + out[base + j];
+                    // 交集的左上角所在的格子是(max(矩形的起始格子, 查询的起始格子)), 只在这个格子报告
+                    // 矩形在一行中占连续的格子, 所以e在该格子内等价于e小于该格子的结束位置
+                    const int32_t ex = CellX(entries.LeftPtr()[e]), ey = CellY(entries.TopPtr()[e]);
+                    if (y == (ey > qy0 ? ey : qy0) && e < cell_begin[row + (ex > qx0 ? ex : qx0) + 1])
+                    {
+                        out[k] = ids[e];
+                        k += 1;
+                    }
+                }
+                out.resize(k);
+            }
+            return out.size() - start;
+        }
+        // 包含点(x, y)的矩形的编号追加到out的末尾(按编号排序), 返回追加的个数
+        size_t QueryPoint(float32 x, float32 y, std::vector<uint32_t> &out) const
+        {
+            if (cols == 0 || !bounds.Contains(x, y))
+            {
+                return 0;
+            }
+            const size_t c = static_cast<size_t>(CellY(y)) * cols + CellX(x);
+            const size_t b = cell_begin[c], n = cell_begin[c + 1] - b;
+            const size_t base = out.size();
+            out.resize(base + n);
+            size_t hit = 0;
+            MATHLIB_DISPATCH(RectContainPoint, entries.LeftPtr() + b, entries.RightPtr() + b, entries.TopPtr() + b, entries.BottomPtr() + b,
+                             n, x, y, out.data() + base, hit);
+            for (size_t j = 0; j < hit; j += 1)
+            {
+                out[base + j] = ids[b + out[base + j]];
+            }
+            out.resize(base + hit);
+            return hit;
+        }
+        // Build时的矩形个数(包括空矩形)
+        inline size_t Size() const noexcept
+        {
+            return size;
+        }
+        // 所有非空矩形的包围范围
+        inline const RectF& Bounds() const noexcept
+        {
+            return bounds;
+        }
+        // 格子的列数
+        inline int32_t Cols() const noexcept
+        {
+            return cols;
+        }
+        // 格子的行数
+        inline int32_t Rows() const noexcept
+        {
+            return rows;
+        }
+        // 所有格子中记录的矩形总数(跨多个格子的矩形记录多次)
+        inline size_t Entries() const noexcept
+        {
+            return ids.size();
+        }
+    private:
+        // 一个方向上的格子数, 至少1个, 最多65536个
+        static int32_t CellCount(float64 v) noexcept
+        {
+            v = ceil(v);
+            return v < 1.0 ? 1 : v > 65536.0 ? 65536 : static_cast<int32_t>(v);
+        }
+        // 坐标所在的列, 超出范围时取最近的格子
+        inline int32_t CellX(float32 x) const noexcept
+        {
+            const float32 f = (x - bounds.left) * inv_w;
+            return f > 0.0f ? (f < static_cast<float32>(cols - 1) ? static_cast<int32_t>(f) : cols - 1) : 0;     // NaN也取0
+        }
+        // 坐标所在的行
+        inline int32_t CellY(float32 y) const noexcept
+        {
+            const float32 f = (y - bounds.top) * inv_h;
+            return f > 0.0f ? (f < static_cast<float32>(rows - 1) ? static_cast<int32_t>(f) : rows - 1) : 0;     // NaN也取0
+        }
+
+        RectF                 bounds;                       // 所有非空矩形的包围范围
+        float32               inv_w, inv_h;                 // 格子宽度和高度的倒数
+        int32_t               cols, rows;
+        size_t                size;
+        std::vector<uint32_t> cell_begin;                   // 格子c的记录为[cell_begin[c], cell_begin[c + 1])
+        std::vector<uint32_t> ids;                          // 每条记录的矩形编号
+        std::vector<uint32_t> cursor;                       // Build的第二遍中每个格子的写入位置
+        RectFStream           entries;                      // 每条记录的矩形(SoA), 与ids一一对应
+    };
+}
@@ -0,0 +1,88 @@
+﻿/*
+ | Cirno
+ | 文件名称: reduce.hpp
+ | 文件作用: SSE寄存器内的水平归约
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#if defined(_MATHLIB_USE_SSE)
+namespace cirno
+{
+    // 水平归约(点乘, 分量求和), 结果广播到__m128的全部4个分量
+    // 全程不经过内存, 可以直接参与后续的SIMD运算(乘法, rsqrt等), 避免store-forward的往返
+    // 编译选项打开SSE4.1(-msse4.1)时点乘使用dpps, 否则使用shuffle + add
+    namespace reduce
+    {
+        // r[0 .. 3] = v[0] + v[1]
+        inline __m128 Sum2(const __m128 v) noexcept
+        {
+            return _mm_add_ps(_mm_shuffle_ps(v, v, 0x00), _mm_shuffle_ps(v, v, 0x55));
+        }
+        // r[0 .. 3] = v[0] + v[1] + v[2]
+        inline __m128 Sum3(const __m128 v) noexcept
+        {
+            __m128 t = _mm_add_ps(_mm_shuffle_ps(v, v, 0x00), _mm_shuffle_ps(v, v, 0x55));
+            return _mm_add_ps(t, _mm_shuffle_ps(v, v, 0xaa));
+        }
+        // r[0 .. 3] = v[0] + v[1] + v[2] + v[3]
+        inline __m128 Sum4(const __m128 v) noexcept
+        {
+            __m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, 0xb1));   // t = (v0 + v1, v0 + v1, v2 + v3, v2 + v3)
+            return _mm_add_ps(t, _mm_shuffle_ps(t, t, 0x4e));       // 交换高低两半再相加
+        }
+        // r[0 .. 3] = a[0] * b[0] + a[1] * b[1]
+        inline __m128 Dot2(const __m128 a, const __m128 b) noexcept
+        {
+        #if defined(__SSE4_1__)
+            return _mm_dp_ps(a, b, 0x3f);
+        #else
+            return Sum2(_mm_mul_ps(a, b));
+        #endif // __SSE4_1__
+        }
+        // r[0 .. 3] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2], 不读取第4个分量
+        inline __m128 Dot3(const __m128 a, const __m128 b) noexcept
+        {
+        #if defined(__SSE4_1__)
+            return _mm_dp_ps(a, b, 0x7f);
+        #else
+            return Sum3(_mm_mul_ps(a, b));
+        #endif // __SSE4_1__
+        }
+        // r[0 .. 3] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]
+        inline __m128 Dot4(const __m128 a, const __m128 b) noexcept
+        {
+        #if defined(__SSE4_1__)
+            return _mm_dp_ps(a, b, 0xff);
+        #else
+            return Sum4(_mm_mul_ps(a, b));
+        #endif // __SSE4_1__
+        }
+    }
+}
+#endif // _MATHLIB_USE_SSE
@@ -0,0 +1,129 @@
+﻿/*
+ | Cirno
+ | 文件名称: skinning.hpp
+ | 文件作用: 线性混合蒙皮(矩阵调色板, 多线程)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3stream.hpp"
+#include "matrix4.hpp"
+#include "kernel.hpp"
+namespace cirno
+{
+    // 蒙皮输出的顶点缓冲区, 顶点交错存放(例如映射的GPU缓冲区)
+    // 第k个顶点的位置写入position + stride * k, 法线写入normal + stride * k, 各3个float32, 其他属性不会被修改
+    struct SkinVertexBuffer
+    {
+        float32 *position;                                  // 第0个顶点的位置
+        float32 *normal;                                    // 第0个顶点的法线, nullptr表示不写法线
+        size_t   stride;                                    // 相邻顶点相隔的float32个数, 例如位置 + 法线 + 纹理坐标为8
+    };
+    // 线性混合蒙皮(LBS): v' = Σ(w[j] * palette[joints[j]]) * v, 每个顶点最多4个骨骼
+    // joints[4 * k + j]是第k个顶点的第j个骨骼在palette中的下标, weights[4 * k + j]是对应的权重(不使用的骨骼权重为0, 下标仍需有效)
+    // 每次处理Width个顶点: 按骨骼下标转置读取矩阵, 在寄存器中混合后直接变换, 不逐个调用Matrix4 * Vector4;
+    // 定义了_MATHLIB_USE_PARALLEL时, 顶点较多时分块交给线程池, 每块是连续的一段, 直接写入输出的顶点缓冲区
+    class LinearBlendSkinning final
+    {
+    public:
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 顶点至少有这么多时才分给多个线程, 每个线程至少处理这么多顶点
+        static const size_t ParallelGrain = 4096;
+
+        // 只变换位置, 在默认线程池中计算, threads为最多使用的线程数(包括调用者), 0表示不限制
+        static void Skin(const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const SkinVertexBuffer &out, size_t threads = 0)
+        {
+            Run(ThreadPool::Default(), palette, joints, weights, pos, nullptr, out, threads);
+        }
+        // 变换位置和法线, pos与nrm的元素个数必须相同; 法线变换后重新归一化(假设骨骼矩阵没有非均匀缩放)
+        static void Skin(const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const Vector3Stream &nrm, const SkinVertexBuffer &out, size_t threads = 0)
+        {
+            assert(pos.Size() == nrm.Size());
+            Run(ThreadPool::Default(), palette, joints, weights, pos, &nrm, out, threads);
+        }
+        // 只变换位置, 在pool中计算
+        static void Skin(ThreadPool &pool, const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const SkinVertexBuffer &out)
+        {
+            Run(pool, palette, joints, weights, pos, nullptr, out, 0);
+        }
+        // 变换位置和法线, 在pool中计算
+        static void Skin(ThreadPool &pool, const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const Vector3Stream &nrm, const SkinVertexBuffer &out)
+        {
+            assert(pos.Size() == nrm.Size());
+            Run(pool, palette, joints, weights, pos, &nrm, out, 0);
+        }
+    #else
+        // 只变换位置, 没有定义_MATHLIB_USE_PARALLEL时在调用者的线程中计算, 忽略threads
+        static void Skin(const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const SkinVertexBuffer &out, size_t threads = 0) noexcept
+        {
+            (void)threads;
+            SkinRange(palette, joints, weights, pos, nullptr, out, 0, pos.Size());
+        }
+        // 变换位置和法线, pos与nrm的元素个数必须相同; 法线变换后重新归一化(假设骨骼矩阵没有非均匀缩放)
+        static void Skin(const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                         const Vector3Stream &pos, const Vector3Stream &nrm, const SkinVertexBuffer &out, size_t threads = 0) noexcept
+        {
+            assert(pos.Size() == nrm.Size());
+            (void)threads;
+            SkinRange(palette, joints, weights, pos, &nrm, out, 0, pos.Size());
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+    private:
+        // 处理[begin, end)中的顶点
+        static void SkinRange(const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                              const Vector3Stream &pos, const Vector3Stream *nrm, const SkinVertexBuffer &out,
+                              size_t begin, size_t end) noexcept
+        {
+            const bool has_n = nrm != nullptr && out.normal != nullptr;
+            MATHLIB_DISPATCH(MatrixSkin, palette->DataPtr(), joints + 4 * begin, weights + 4 * begin,
+                             pos.XPtr() + begin, pos.YPtr() + begin, pos.ZPtr() + begin,
+                             has_n ? nrm->XPtr() + begin : nullptr, has_n ? nrm->YPtr() + begin : nullptr, has_n ? nrm->ZPtr() + begin : nullptr,
+                             out.position + out.stride * begin, has_n ? out.normal + out.stride * begin : nullptr, out.stride, end - begin);
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        static void Run(ThreadPool &pool, const Matrix4 *palette, const uint16_t *joints, const float32 *weights,
+                        const Vector3Stream &pos, const Vector3Stream *nrm, const SkinVertexBuffer &out, size_t threads)
+        {
+            const size_t n = pos.Size();
+            // 每块按Vector3Stream::Alignment取整, 只有最后一块有不满一个Pack的尾部; 限制线程数时把块分大, 块数不超过threads
+            size_t grain = pool.Grain(n, ParallelGrain, Vector3Stream::Alignment);
+            if (threads != 0)
+            {
+                const size_t step = (n + threads - 1) / threads;
+                grain = grain > step ? grain : (step + Vector3Stream::Alignment - 1) / Vector3Stream::Alignment * Vector3Stream::Alignment;
+            }
+            pool.For(0, n, grain, [&](size_t b, size_t e) { SkinRange(palette, joints, weights, pos, nrm, out, b, e); });
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+    };
+}
@@ -39,38 +39,41 @@ namespace cirno
         float32 x, y;
     };
     // 平面向量, 16字节对齐分配, 大小16字节
-    class Vector2 final
+    class alignas(16) Vector2 final
     {
     public:
-        Vector2() noexcept : x(0.0f), y(0.0f)
+        constexpr Vector2() noexcept : x(0.0f), y(0.0f)
         {
             // nothing to do
         }
-        Vector2(float32 _v) noexcept : x(_v), y(_v)
+        constexpr Vector2(float32 _v) noexcept : x(_v), y(_v)
         {
             // nothing to do
         }
-        Vector2(float32 _x, float32 _y) noexcept : x(_x), y(_y)
+        constexpr Vector2(float32 _x, float32 _y) noexcept : x(_x), y(_y)
         {
             // nothing to do
         }
-        Vector2(const CompactVector2 &vec2) noexcept : x(vec2.x), y(vec2.y)
+        constexpr Vector2(const CompactVector2 &vec2) noexcept : x(vec2.x), y(vec2.y)
         {
             // nothing to do
         }
-    #if defined(_MATHLIB_USE_SSE)
-        Vector2(__m128 _val) noexcept : val{ _val }
+        Vector2(f32x4::Reg _val) noexcept : val{ _val }
         {
             // nothing to do
         }
-    #endif // _MATHLIB_USE_SSE
         Vector2(const Vector2 &) = default;
         Vector2& operator=(const Vector2 &) = default;
         ~Vector2() = default;
         // 取得模长的平方
         float32 GetNormL2Square() const noexcept
         {
-            return x * x + y * y;
+            return f32x4::First(f32x4::Dot2(val, val));
+        }
+        // 取得模长的平方, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector2) GetNormL2SquareV() const noexcept
+        {
+            return Vector2(f32x4::Dot2(val, val));
         }
         // 取得L2范数模长
         inline float32 GetNormL2() const noexcept
@@ -82,107 +85,69 @@ namespace cirno
         {
             return GetNormL2();
         }
-        // 归一化
+        // 取得模长, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector2) LengthV() const noexcept
+        {
+            return Vector2(f32x4::Sqrt(f32x4::Dot2(val, val)));
+        }
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector2& SetNormalize() noexcept
         {
-            float32 s = Length();
-            if (s == 0.0f)                                  // 长度精确为0, 不进行计算
-            {
-                // nothing to do
-            }
-            else {
-            #if defined(_MATHLIB_USE_SSE)
-                __m128 t = _mm_load_ps1(&s);                // t[0 .. 3] = length
-                __m128 k = _mm_rcp_ps(t);                   // k = 1 / length
-                val = _mm_mul_ps(val, k);
-            #else
-                s = 1.0f / s;
-                x *= s;
-                y *= s;
-            #endif // _MATHLIB_USE_SSE
-            }
+            const f32x4::Reg s = f32x4::Dot2(val, val);         // s[0 .. 3] = length^2
+            const f32x4::Reg k = f32x4::RecipSqrt(s, P());      // k[0 .. 3] = 1 / length
+            val = f32x4::KeepNonZero(f32x4::Mul(val, k), s);    // 长度精确为0时结果为0
             return *this;
         }
-        // 归一化
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector2 GetNormalize() const noexcept
         {
             Vector2 t(*this);
-            return t.SetNormalize();
+            return t.SetNormalize<P>();
         }
         // 点乘
         MATHLIB_CALL(float32) DotMul(const Vector2 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 buff[4];
-            __m128 t = _mm_mul_ps(val, b.val);              // t[k] = val[k] * b.val[k]
-            _mm_store_ps(buff, t);
-            return buff[0] + buff[1];
-        #else
-            return x * b.x + y * b.y;
-        #endif // _MATHLIB_USE_SSE
+            return f32x4::First(f32x4::Dot2(val, b.val));
+        }
+        // 点乘, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector2) DotMulV(const Vector2 b) const noexcept
+        {
+            return Vector2(f32x4::Dot2(val, b.val));
         }
         // 平面向量加法
         MATHLIB_CALL(Vector2&) operator+=(const Vector2 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_add_ps(val, b.val);
-        #else
-            x += b.x;
-            y += b.y;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Add(val, b.val);
             return *this;
         }
         // 平面向量加法
         MATHLIB_CALL(Vector2) operator+(const Vector2 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector2(_mm_add_ps(val, b.val));
-        #else
-            return Vector2(x + b.x, y + b.y);
-        #endif // _MATHLIB_USE_SSE
+            return Vector2(f32x4::Add(val, b.val));
         }
         // 平面向量减法
         MATHLIB_CALL(Vector2&) operator-=(const Vector2 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_sub_ps(val, b.val);
-        #else
-            x -= b.x;
-            y -= b.y;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Sub(val, b.val);
             return *this;
         }
         // 平面向量减法
         MATHLIB_CALL(Vector2) operator-(const Vector2 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector2(_mm_sub_ps(val, b.val));
-        #else
-            return Vector2(x - b.x, y - b.y);
-        #endif // _MATHLIB_USE_SSE
+            return Vector2(f32x4::Sub(val, b.val));
         }
         // 平面向量数乘
         MATHLIB_CALL(Vector2&) operator*=(const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            val = _mm_mul_ps(val, t);
-        #else
-            x *= v;
-            y *= v;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Mul(val, f32x4::Splat(v));
             return *this;
         }
         // 平面向量数乘
         friend MATHLIB_CALL(Vector2) operator*(const Vector2 vec, const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            __m128 r = _mm_mul_ps(vec.val, t);
-            return Vector2(r);
-        #else
-            return Vector2(vec.x * v, vec.y * v);
-        #endif // _MATHLIB_USE_SSE
+            return Vector2(f32x4::Mul(vec.val, f32x4::Splat(v)));
         }
         // 取反
         MATHLIB_CALL(Vector2) operator-() const noexcept
@@ -202,12 +167,12 @@ namespace cirno
             return buff[i];
         }
         // 取得X值
-        inline float32 X() const noexcept
+        inline constexpr float32 X() const noexcept
         {
             return x;
         }
         // 取得Y值
-        inline float32 Y() const noexcept
+        inline constexpr float32 Y() const noexcept
         {
             return y;
         }
@@ -230,7 +195,7 @@ namespace cirno
         // 内存布局:
         // union
         // { | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- |
-        //   |                         __m128 val                        |
+        //   |                       f32x4::Reg val                      |
         //   |                        float32 buff[4]                    |
         //   |   float32 x  |   float32 y  |   (noused)   |   (noused)   |
         // }
@@ -241,9 +206,7 @@ namespace cirno
                 float32 x, y;
             };
             float32 buff[4];
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 val;
-        #endif // _MATHLIB_USE_SSE
+            f32x4::Reg val;
         };
     };
 }
@@ -39,46 +39,41 @@ namespace cirno
         float32 x, y, z;
     };
     // 空间向量, 16字节对齐分配, 大小16字节
-    class Vector3 final
+    class alignas(16) Vector3 final
     {
     public:
-        Vector3() noexcept : x(0.0f), y(0.0f), z(0.0f)
+        constexpr Vector3() noexcept : x(0.0f), y(0.0f), z(0.0f), pad(0.0f)
         {
             // nothing to do
         }
-        Vector3(float32 _v) noexcept : x(_v), y(_v), z(_v)
+        constexpr Vector3(float32 _v) noexcept : x(_v), y(_v), z(_v), pad(0.0f)
         {
             // nothing to do
         }
-        Vector3(float32 _x, float32 _y, float32 _z) noexcept : x(_x), y(_y), z(_z)
+        constexpr Vector3(float32 _x, float32 _y, float32 _z) noexcept : x(_x), y(_y), z(_z), pad(0.0f)
         {
             // nothing to do
         }
-        Vector3(const CompactVector3 &vec3) noexcept : x(vec3.x), y(vec3.y), z(vec3.z)
+        constexpr Vector3(const CompactVector3 &vec3) noexcept : x(vec3.x), y(vec3.y), z(vec3.z), pad(0.0f)
         {
             // nothing to do
         }
-    #if defined(_MATHLIB_USE_SSE)
-        Vector3(__m128 _val) noexcept : val{ _val }
+        Vector3(f32x4::Reg _val) noexcept : val{ _val }
         {
             // nothing to do
         }
-    #endif // _MATHLIB_USE_SSE
         Vector3(const Vector3 &) = default;
         Vector3& operator=(const Vector3 &) = default;
         ~Vector3() = default;
         // 取得模长的平方
         float32 GetNormL2Square() const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 tmp[4];
-            __m128 t = _mm_load_ps(buff);                   // t[0 .. 3] = (x, y, z, _)
-            __m128 r = _mm_mul_ps(t, t);
-            _mm_store_ps(tmp, r);
-            return tmp[0] + tmp[1] + tmp[2];
-        #else
-            return x * x + y * y + z * z;
-        #endif // _MATHLIB_USE_SSE
+            return f32x4::First(f32x4::Dot3(val, val));
+        }
+        // 取得模长的平方, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector3) GetNormL2SquareV() const noexcept
+        {
+            return Vector3(f32x4::Dot3(val, val));
         }
         // 取得L2范数模长
         inline float32 GetNormL2() const noexcept
@@ -90,133 +85,74 @@ namespace cirno
         {
             return GetNormL2();
         }
-        // 归一化
+        // 取得模长, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector3) LengthV() const noexcept
+        {
+            return Vector3(f32x4::Sqrt(f32x4::Dot3(val, val)));
+        }
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector3& SetNormalize() noexcept
         {
-            float32 s = Length();
-            if (s == 0.0f)                                  // 长度精确为0, 不进行计算
-            {
-                // nothing to do
-            }
-            else {
-            #if defined(_MATHLIB_USE_SSE)
-                __m128 t = _mm_load_ps1(&s);                // t[0 .. 3] = length
-                __m128 k = _mm_rcp_ps(t);                   // k = 1 / length
-                val = _mm_mul_ps(val, k);
-            #else
-                s = 1.0f / s;
-                x *= s;
-                y *= s;
-                z *= s;
-            #endif // _MATHLIB_USE_SSE
-            }
+            const f32x4::Reg s = f32x4::Dot3(val, val);         // s[0 .. 3] = length^2
+            const f32x4::Reg k = f32x4::RecipSqrt(s, P());      // k[0 .. 3] = 1 / length
+            val = f32x4::KeepNonZero(f32x4::Mul(val, k), s);    // 长度精确为0时结果为0
             return *this;
         }
-        // 归一化
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector3 GetNormalize() const noexcept
         {
             Vector3 t(*this);
-            return t.SetNormalize();
+            return t.SetNormalize<P>();
         }
         // 点乘
         MATHLIB_CALL(float32) DotMul(const Vector3 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 buff[4];
-            __m128 t = _mm_mul_ps(val, b.val);              // t[k] = val[k] * b.val[k]
-            _mm_store_ps(buff, t);
-            return buff[0] + buff[1] + buff[2];
-        #else
-            return x * b.x + y * b.y + z * b.z;
-        #endif // _MATHLIB_USE_SSE
+            return f32x4::First(f32x4::Dot3(val, b.val));
+        }
+        // 点乘, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector3) DotMulV(const Vector3 b) const noexcept
+        {
+            return Vector3(f32x4::Dot3(val, b.val));
         }
         // 叉乘
         MATHLIB_CALL(Vector3) CrossMul(const Vector3 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t1 = _mm_shuffle_ps(val, val, 0xc9);     // t1(y, z, x) := val(x, y, z)
-            __m128 t2 = _mm_shuffle_ps(b.val, b.val, 0xd2); // t2(z, x, y) := b(x, y, z)
-            __m128 r1 = _mm_mul_ps(t1, t2);                 // r1[k] = t1[k] * t2[k]
-
-            __m128 t3 = _mm_shuffle_ps(val, val, 0xd2);     // t3(z, x, y) := val(x, y, z)
-            __m128 t4 = _mm_shuffle_ps(b.val, b.val, 0xc9); // t4(y, z, x) := val(x, y, z)
-            __m128 r2 = _mm_mul_ps(t3, t4);                 // r2[k] = t3[k] * t4[k]
-
-            __m128 res = _mm_sub_ps(r1, r2);                // res[k] = r1[k] - r2[k]   
-            return Vector3(res);
-        #else
-            Vector3 r;
-            r.x = y * b.z - z * b.y;
-            r.y = z * b.x - x * b.z;
-            r.z = x * b.y - y * b.x;
-            return r;
-        #endif // _MATHLIB_USE_SSE
+            return Vector3(f32x4::Cross3(val, b.val));
         }
         // 空间向量加法
         MATHLIB_CALL(Vector3&) operator+=(const Vector3 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_add_ps(val, b.val);
-        #else
-            x += b.x;
-            y += b.y;
-            z += b.z;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Add(val, b.val);
             return *this;
         }
         // 空间向量加法
         MATHLIB_CALL(Vector3) operator+(const Vector3 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector3(_mm_add_ps(val, b.val));
-        #else
-            return Vector3(x + b.x, y + b.y, z + b.z);
-        #endif // _MATHLIB_USE_SSE
+            return Vector3(f32x4::Add(val, b.val));
         }
         // 空间向量减法
         MATHLIB_CALL(Vector3&) operator-=(const Vector3 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_sub_ps(val, b.val);
-        #else
-            x -= b.x;
-            y -= b.y;
-            z -= b.z;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Sub(val, b.val);
             return *this;
         }
         // 空间向量减法
         MATHLIB_CALL(Vector3) operator-(const Vector3 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector3(_mm_sub_ps(val, b.val));
-        #else
-            return Vector3(x - b.x, y - b.y, z - b.z);
-        #endif // _MATHLIB_USE_SSE
+            return Vector3(f32x4::Sub(val, b.val));
         }
         // 空间向量数乘
         MATHLIB_CALL(Vector3&) operator*=(const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            val = _mm_mul_ps(val, t);
-        #else
-            x *= v;
-            y *= v;
-            z *= v;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Mul(val, f32x4::Splat(v));
             return *this;
         }
         // 空间向量数乘
         friend MATHLIB_CALL(Vector3) operator*(const Vector3 vec, const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            __m128 r = _mm_mul_ps(vec.val, t);
-            return Vector3(r);
-        #else
-            return Vector3(vec.x * v, vec.y * v, vec.z * v);
-        #endif // _MATHLIB_USE_SSE
+            return Vector3(f32x4::Mul(vec.val, f32x4::Splat(v)));
         }
         // 取反
         MATHLIB_CALL(Vector3) operator-() const noexcept
@@ -236,17 +172,17 @@ namespace cirno
             return buff[i];
         }
         // 取得X值
-        inline float32 X() const noexcept
+        inline constexpr float32 X() const noexcept
         {
             return x;
         }
         // 取得Y值
-        inline float32 Y() const noexcept
+        inline constexpr float32 Y() const noexcept
         {
             return y;
         }
         // 取得Z值
-        inline float32 Z() const noexcept
+        inline constexpr float32 Z() const noexcept
         {
             return z;
         }
@@ -269,20 +205,19 @@ namespace cirno
         // 内存布局:
         // union
         // { | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- |
-        //   |                         __m128 val                        |
+        //   |                       f32x4::Reg val                      |
         //   |                        float32 buff[3]                    |
-        //   |   float32 x  |   float32 y  |   float32 z  |   (noused)   |
+        //   |   float32 x  |   float32 y  |   float32 z  |  float32 pad |
         // }
         union
         {
             struct
             {
                 float32 x, y, z;
+                float32 pad;                            // 不使用, 构造时置0, 整个寄存器运算时不读到未初始化的值
             };
             float32 buff[4];
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 val;
-        #endif // _MATHLIB_USE_SSE
+            f32x4::Reg val;
         };
     };
 }
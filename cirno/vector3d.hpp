@@ -0,0 +1,218 @@
+﻿/*
+ | Cirno
+ | 文件名称: vector3d.hpp
+ | 文件作用: 双精度空间向量
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+namespace cirno
+{
+    // 双精度空间向量, 用于远离原点的大世界坐标, 大小32字节(第4个分量总是0)
+    // 渲染前用ToVector3(origin)或CameraRelative转换为相对于摄像机的float32坐标, 减法在float64下完成, 不损失精度
+    class Vector3d final
+    {
+    public:
+        constexpr Vector3d() noexcept : x(0.0), y(0.0), z(0.0), w(0.0)
+        {
+            // nothing to do
+        }
+        constexpr Vector3d(float64 _v) noexcept : x(_v), y(_v), z(_v), w(0.0)
+        {
+            // nothing to do
+        }
+        constexpr Vector3d(float64 _x, float64 _y, float64 _z) noexcept : x(_x), y(_y), z(_z), w(0.0)
+        {
+            // nothing to do
+        }
+        explicit constexpr Vector3d(const Vector3 v) noexcept : x(v.X()), y(v.Y()), z(v.Z()), w(0.0)
+        {
+            // nothing to do
+        }
+        Vector3d(const f64x4::Reg _val) noexcept
+        {
+            f64x4::Store(_val, buff);
+        }
+        Vector3d(const Vector3d &) = default;
+        Vector3d& operator=(const Vector3d &) = default;
+        ~Vector3d() = default;
+        // 取得模长的平方
+        inline float64 GetNormL2Square() const noexcept
+        {
+            return f64x4::Dot3(GetReg(), GetReg());
+        }
+        // 取得L2范数模长
+        inline float64 GetNormL2() const noexcept
+        {
+            return sqrt(GetNormL2Square());
+        }
+        // 取得模长
+        inline float64 Length() const noexcept
+        {
+            return GetNormL2();
+        }
+        // 归一化, 长度为0时保持不变
+        Vector3d& SetNormalize() noexcept
+        {
+            const float64 s = GetNormL2Square();
+            if (s != 0.0)
+            {
+                f64x4::Store(f64x4::Mul(GetReg(), f64x4::Splat(1.0 / sqrt(s))), buff);
+            }
+            return *this;
+        }
+        // 归一化
+        Vector3d GetNormalize() const noexcept
+        {
+            Vector3d t(*this);
+            return t.SetNormalize();
+        }
+        // 点乘
+        MATHLIB_CALL(float64) DotMul(const Vector3d &b) const noexcept
+        {
+            return f64x4::Dot3(GetReg(), b.GetReg());
+        }
+        // 叉乘
+        MATHLIB_CALL(Vector3d) CrossMul(const Vector3d &b) const noexcept
+        {
+            return Vector3d(y * b.z - z * b.y, z * b.x - x * b.z, x * b.y - y * b.x);
+        }
+        // 加法
+        MATHLIB_CALL(Vector3d&) operator+=(const Vector3d &b) noexcept
+        {
+            f64x4::Store(f64x4::Add(GetReg(), b.GetReg()), buff);
+            return *this;
+        }
+        // 加法
+        MATHLIB_CALL(Vector3d) operator+(const Vector3d &b) const noexcept
+        {
+            return Vector3d(f64x4::Add(GetReg(), b.GetReg()));
+        }
+        // 减法
+        MATHLIB_CALL(Vector3d&) operator-=(const Vector3d &b) noexcept
+        {
+            f64x4::Store(f64x4::Sub(GetReg(), b.GetReg()), buff);
+            return *this;
+        }
+        // 减法
+        MATHLIB_CALL(Vector3d) operator-(const Vector3d &b) const noexcept
+        {
+            return Vector3d(f64x4::Sub(GetReg(), b.GetReg()));
+        }
+        // 数乘
+        MATHLIB_CALL(Vector3d&) operator*=(const float64 v) noexcept
+        {
+            f64x4::Store(f64x4::Mul(GetReg(), f64x4::Splat(v)), buff);
+            return *this;
+        }
+        // 数乘
+        friend MATHLIB_CALL(Vector3d) operator*(const Vector3d &vec, const float64 v) noexcept
+        {
+            return Vector3d(f64x4::Mul(vec.GetReg(), f64x4::Splat(v)));
+        }
+        // 取反
+        MATHLIB_CALL(Vector3d) operator-() const noexcept
+        {
+            return Vector3d(-x, -y, -z);
+        }
+        // 按照下标取得值, [0] = x, [1] = y, [2] = z
+        float64& operator[](unsigned int i) noexcept
+        {
+            assert(i < 3);
+            return buff[i];
+        }
+        // 按照下标取得值, [0] = x, [1] = y, [2] = z
+        float64 operator[](unsigned int i) const noexcept
+        {
+            assert(i < 3);
+            return buff[i];
+        }
+        // 取得X值
+        inline constexpr float64 X() const noexcept
+        {
+            return x;
+        }
+        // 取得Y值
+        inline constexpr float64 Y() const noexcept
+        {
+            return y;
+        }
+        // 取得Z值
+        inline constexpr float64 Z() const noexcept
+        {
+            return z;
+        }
+        // 取得ptr, 原始类型是float64[4](第4个是0)
+        inline float64* GetPtr() noexcept
+        {
+            return buff;
+        }
+        // 取得ptr, 原始类型是float64[4](第4个是0)
+        inline const float64* GetPtr() const noexcept
+        {
+            return buff;
+        }
+        // 读入寄存器(不要求对齐)
+        inline f64x4::Reg GetReg() const noexcept
+        {
+            return f64x4::Load(buff);
+        }
+        // 转换为单精度
+        MATHLIB_CALL(Vector3) ToVector3() const noexcept
+        {
+            return Vector3(f64x4::ToFloat(GetReg()));
+        }
+        // 转换为相对于origin(例如摄像机位置)的单精度坐标: 先在float64下相减, 再转换
+        MATHLIB_CALL(Vector3) ToVector3(const Vector3d &origin) const noexcept
+        {
+            return Vector3d(f64x4::Sub(GetReg(), origin.GetReg())).ToVector3();
+        }
+        // 批量转换为相对于origin的单精度坐标: out[k] = in[k] - origin, 用于上传渲染数据
+        // 每次处理Width个float64(SSE4.1: 4, AVX2: 8, AVX-512: 16), 运行时分派, 不需要-mavx编译选项
+        static void CameraRelative(const Vector3d *in, const Vector3d &origin, Vector3 *out, size_t n) noexcept
+        {
+            MATHLIB_DISPATCH(ConvertRelative, in->GetPtr(), origin.GetPtr(), 4, reinterpret_cast<float32*>(out), n);
+        }
+    protected:
+        // 内存布局:
+        // union
+        // { | ---- 64 ---- | ---- 64 ---- | ---- 64 ---- | ---- 64 ---- |
+        //   |                       float64 buff[4]                     |
+        //   |   float64 x  |   float64 y  |   float64 z  |  float64 w(0) |
+        // }
+        // 只按float64存储, 运算时用GetReg读入寄存器: 不要求32字节对齐, 可以直接放在std::vector等容器中
+        union
+        {
+            struct
+            {
+                float64 x, y, z, w;
+            };
+            alignas(16) float64 buff[4];
+        };
+    };
+}
@@ -0,0 +1,470 @@
+﻿/*
+ | Cirno
+ | 文件名称: vector3stream.hpp
+ | 文件作用: 空间向量流(SoA布局)
+ | 创建日期: 2026-10-17
+ | 更新日期: 2026-10-17
+ | 开发人员: JuYan
+ +----------------------------
+ Copyright (C) JuYan, all rights reserved.
+
+ MIT License
+
+ Copyright (C) JuYan
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#pragma once
+#include "vector3.hpp"
+#include "kernel.hpp"
+#include "allocator.hpp"
+namespace cirno
+{
+    // 空间向量流, x/y/z分量分别存放在三段64字节对齐的数组中
+    // 容量按16个元素向上取整, 尾部填充的元素始终为0, 因此内核可以按整个向量宽度处理
+    class Vector3Stream final
+    {
+    public:
+        // 容量的粒度, 等于最宽的内核一次处理的元素个数(AVX-512: 16)
+        static const size_t Alignment = 16;
+
+        Vector3Stream() noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            // nothing to do
+        }
+        explicit Vector3Stream(size_t n) noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            Resize(n);
+        }
+        Vector3Stream(const Vector3 *vecs, size_t n) noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            Load(vecs, n);
+        }
+        Vector3Stream(const CompactVector3 *vecs, size_t n) noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            Load(vecs, n);
+        }
+        // 在arena中分配n个元素(初始为0), 不使用堆内存, 用于每帧的临时数据和批量内核的输出
+        // arena空间不足时退回堆分配; arena Reset或Rewind之后不能再使用这个流(Resize超过容量时会换成堆内存)
+        Vector3Stream(FrameArena &arena, size_t n) noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            const size_t cap = (n + Alignment - 1) / Alignment * Alignment;
+            float32 *p = arena.Alloc<float32>(3 * cap, 64);
+            if (p == nullptr)
+            {
+                Resize(n);
+                return;
+            }
+            memset(p, 0, 3 * cap * sizeof(float32));
+            buff = p;
+            count = n;
+            capacity = cap;
+            owned = false;
+        }
+        // 内存分配失败时是空流
+        Vector3Stream(const Vector3Stream &b) noexcept : buff(nullptr), count(0), capacity(0), owned(true)
+        {
+            Assign(b);
+        }
+        Vector3Stream(Vector3Stream &&b) noexcept : buff(b.buff), count(b.count), capacity(b.capacity), owned(b.owned)
+        {
+            b.buff = nullptr;
+            b.count = 0;
+            b.capacity = 0;
+        }
+        // 内存分配失败时与复制构造一样成为空流, 需要保留原有数据时使用Assign
+        Vector3Stream& operator=(const Vector3Stream &b) noexcept
+        {
+            if (!Assign(b))
+            {
+                Clear();
+            }
+            return *this;
+        }
+        Vector3Stream& operator=(Vector3Stream &&b) noexcept
+        {
+            std::swap(buff, b.buff);
+            std::swap(count, b.count);
+            std::swap(capacity, b.capacity);
+            std::swap(owned, b.owned);
+            return *this;
+        }
+        ~Vector3Stream()
+        {
+            if (owned)
+            {
+                FreeBuffer(buff);
+            }
+        }
+        // 改变元素个数, 新增的元素为0. 内存分配失败返回false, 原有数据保持不变
+        bool Resize(size_t n) noexcept
+        {
+            if (n <= capacity)
+            {
+                if (n < count)                              // 缩小时把多出来的元素清零, 保证尾部为0
+                {
+                    memset(XPtr() + n, 0, (count - n) * sizeof(float32));
+                    memset(YPtr() + n, 0, (count - n) * sizeof(float32));
+                    memset(ZPtr() + n, 0, (count - n) * sizeof(float32));
+                }
+                count = n;
+                return true;
+            }
+            const size_t cap = (n + Alignment - 1) / Alignment * Alignment;
+            float32 *p = AllocBuffer(3 * cap);
+            if (p == nullptr)
+            {
+                return false;
+            }
+            memset(p, 0, 3 * cap * sizeof(float32));
+            if (count != 0)
+            {
+                memcpy(p, XPtr(), count * sizeof(float32));
+                memcpy(p + cap, YPtr(), count * sizeof(float32));
+                memcpy(p + 2 * cap, ZPtr(), count * sizeof(float32));
+            }
+            if (owned)
+            {
+                FreeBuffer(buff);
+            }
+            buff = p;
+            count = n;
+            capacity = cap;
+            owned = true;
+            return true;
+        }
+        // 清空
+        void Clear() noexcept
+        {
+            Resize(0);
+        }
+        // 元素个数
+        inline size_t Size() const noexcept
+        {
+            return count;
+        }
+        // 已分配的容量(Alignment的倍数)
+        inline size_t Capacity() const noexcept
+        {
+            return capacity;
+        }
+        // 按Alignment向上取整后的元素个数, 内核按这个长度处理
+        inline size_t PaddedSize() const noexcept
+        {
+            return (count + Alignment - 1) / Alignment * Alignment;
+        }
+        // 复制b的全部元素. 内存分配失败返回false, 原有数据保持不变
+        bool Assign(const Vector3Stream &b) noexcept
+        {
+            if (this == &b)
+            {
+                return true;
+            }
+            if (!Resize(b.count))
+            {
+                return false;
+            }
+            if (count != 0)                                 // 空流的buff可能是nullptr
+            {
+                memcpy(XPtr(), b.XPtr(), count * sizeof(float32));
+                memcpy(YPtr(), b.YPtr(), count * sizeof(float32));
+                memcpy(ZPtr(), b.ZPtr(), count * sizeof(float32));
+            }
+            return true;
+        }
+        // 从Vector3数组载入
+        bool Load(const Vector3 *vecs, size_t n) noexcept
+        {
+            if (!Resize(n))
+            {
+                return false;
+            }
+            float32 *px = XPtr(), *py = YPtr(), *pz = ZPtr();
+            for (size_t i = 0; i < n; i += 1)
+            {
+                px[i] = vecs[i].X();
+                py[i] = vecs[i].Y();
+                pz[i] = vecs[i].Z();
+            }
+            return true;
+        }
+        // 从CompactVector3数组载入
+        bool Load(const CompactVector3 *vecs, size_t n) noexcept
+        {
+            if (!Resize(n))
+            {
+                return false;
+            }
+            float32 *px = XPtr(), *py = YPtr(), *pz = ZPtr();
+            for (size_t i = 0; i < n; i += 1)
+            {
+                px[i] = vecs[i].x;
+                py[i] = vecs[i].y;
+                pz[i] = vecs[i].z;
+            }
+            return true;
+        }
+        // 写出到Vector3数组, vecs至少要有Size()个元素
+        void Store(Vector3 *vecs) const noexcept
+        {
+            const float32 *px = XPtr(), *py = YPtr(), *pz = ZPtr();
+            for (size_t i = 0; i < count; i += 1)
+            {
+                vecs[i] = Vector3(px[i], py[i], pz[i]);
+            }
+        }
+        // 写出到CompactVector3数组, vecs至少要有Size()个元素
+        void Store(CompactVector3 *vecs) const noexcept
+        {
+            const float32 *px = XPtr(), *py = YPtr(), *pz = ZPtr();
+            for (size_t i = 0; i < count; i += 1)
+            {
+                vecs[i] = CompactVector3{ px[i], py[i], pz[i] };
+            }
+        }
+        // 取得第i个元素
+        inline Vector3 Get(size_t i) const noexcept
+        {
+            assert(i < count);
+            return Vector3(XPtr()[i], YPtr()[i], ZPtr()[i]);
+        }
+        // 设置第i个元素
+        inline void Set(size_t i, const Vector3 v) noexcept
+        {
+            assert(i < count);
+            XPtr()[i] = v.X();
+            YPtr()[i] = v.Y();
+            ZPtr()[i] = v.Z();
+        }
+        // 空间向量流加法(逐元素)
+        Vector3Stream& operator+=(const Vector3Stream &b) noexcept
+        {
+            assert(b.count == count);
+            const size_t n = PaddedSize();                  // b的容量可能不同, 逐段处理
+            MATHLIB_DISPATCH(StreamAdd, XPtr(), b.XPtr(), XPtr(), n);
+            MATHLIB_DISPATCH(StreamAdd, YPtr(), b.YPtr(), YPtr(), n);
+            MATHLIB_DISPATCH(StreamAdd, ZPtr(), b.ZPtr(), ZPtr(), n);
+            return *this;
+        }
+        // 空间向量流减法(逐元素)
+        Vector3Stream& operator-=(const Vector3Stream &b) noexcept
+        {
+            assert(b.count == count);
+            const size_t n = PaddedSize();
+            MATHLIB_DISPATCH(StreamSub, XPtr(), b.XPtr(), XPtr(), n);
+            MATHLIB_DISPATCH(StreamSub, YPtr(), b.YPtr(), YPtr(), n);
+            MATHLIB_DISPATCH(StreamSub, ZPtr(), b.ZPtr(), ZPtr(), n);
+            return *this;
+        }
+        // 空间向量流数乘
+        Vector3Stream& operator*=(const float32 v) noexcept
+        {
+            const size_t n = PaddedSize();
+            MATHLIB_DISPATCH(StreamScale, XPtr(), v, XPtr(), n);
+            MATHLIB_DISPATCH(StreamScale, YPtr(), v, YPtr(), n);
+            MATHLIB_DISPATCH(StreamScale, ZPtr(), v, ZPtr(), n);
+            ClearTail();                                    // v为inf或NaN时0 * v不是0
+            return *this;
+        }
+        // 点乘(逐元素), out至少要有Size()个元素
+        void DotMul(const Vector3Stream &b, float32 *out) const noexcept
+        {
+            assert(b.count == count);
+            MATHLIB_DISPATCH(StreamDot, XPtr(), YPtr(), ZPtr(), b.XPtr(), b.YPtr(), b.ZPtr(), out, count);
+        }
+        // 叉乘(逐元素), 结果写入out, out可以就是this或b; 内存分配失败时不进行计算, out保持不变
+        void CrossMul(const Vector3Stream &b, Vector3Stream &out) const noexcept
+        {
+            assert(b.count == count);
+            if (!out.Resize(count))
+            {
+                return;
+            }
+            if (&out == this || &out == &b)                 // 原地计算需要临时缓冲区
+            {
+                Vector3Stream tmp;
+                if (!tmp.Resize(count))
+                {
+                    return;
+                }
+                MATHLIB_DISPATCH(StreamCross, XPtr(), YPtr(), ZPtr(), b.XPtr(), b.YPtr(), b.ZPtr(), tmp.XPtr(), tmp.YPtr(), tmp.ZPtr(), PaddedSize());
+                out = std::move(tmp);
+            }
+            else {
+                MATHLIB_DISPATCH(StreamCross, XPtr(), YPtr(), ZPtr(), b.XPtr(), b.YPtr(), b.ZPtr(), out.XPtr(), out.YPtr(), out.ZPtr(), PaddedSize());
+            }
+        }
+        // 取得模长的平方(逐元素), out至少要有Size()个元素
+        void GetNormL2Square(float32 *out) const noexcept
+        {
+            MATHLIB_DISPATCH(StreamDot, XPtr(), YPtr(), ZPtr(), XPtr(), YPtr(), ZPtr(), out, count);
+        }
+        // 取得模长(逐元素), out至少要有Size()个元素
+        void Length(float32 *out) const noexcept
+        {
+            MATHLIB_DISPATCH(StreamLength, XPtr(), YPtr(), ZPtr(), out, count);
+        }
+        // 归一化(逐元素), 长度精确为0的元素不进行计算, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
+        Vector3Stream& SetNormalize() noexcept
+        {
+            MATHLIB_DISPATCH(StreamNormalize, XPtr(), YPtr(), ZPtr(), PaddedSize(), P::Level);
+            return *this;
+        }
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 加法(逐元素), 分块后在pool中并行计算
+        Vector3Stream& Add(ThreadPool &pool, const Vector3Stream &b)
+        {
+            assert(b.count == count);
+            pool.For(0, PaddedSize(), ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamAdd, XPtr() + i, b.XPtr() + i, XPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamAdd, YPtr() + i, b.YPtr() + i, YPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamAdd, ZPtr() + i, b.ZPtr() + i, ZPtr() + i, e - i);
+            });
+            return *this;
+        }
+        // 减法(逐元素), 分块后在pool中并行计算
+        Vector3Stream& Sub(ThreadPool &pool, const Vector3Stream &b)
+        {
+            assert(b.count == count);
+            pool.For(0, PaddedSize(), ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamSub, XPtr() + i, b.XPtr() + i, XPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamSub, YPtr() + i, b.YPtr() + i, YPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamSub, ZPtr() + i, b.ZPtr() + i, ZPtr() + i, e - i);
+            });
+            return *this;
+        }
+        // 数乘, 分块后在pool中并行计算
+        Vector3Stream& Scale(ThreadPool &pool, const float32 v)
+        {
+            pool.For(0, PaddedSize(), ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamScale, XPtr() + i, v, XPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamScale, YPtr() + i, v, YPtr() + i, e - i);
+                MATHLIB_DISPATCH(StreamScale, ZPtr() + i, v, ZPtr() + i, e - i);
+            });
+            ClearTail();
+            return *this;
+        }
+        // 点乘(逐元素), 分块后在pool中并行计算
+        void DotMul(ThreadPool &pool, const Vector3Stream &b, float32 *out) const
+        {
+            assert(b.count == count);
+            pool.For(0, count, ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamDot, XPtr() + i, YPtr() + i, ZPtr() + i, b.XPtr() + i, b.YPtr() + i, b.ZPtr() + i, out + i, e - i);
+            });
+        }
+        // 叉乘(逐元素), 分块后在pool中并行计算; out不能是this或b
+        void CrossMul(ThreadPool &pool, const Vector3Stream &b, Vector3Stream &out) const
+        {
+            assert(b.count == count && &out != this && &out != &b);
+            if (out.Resize(count))
+            {
+                pool.For(0, PaddedSize(), ParallelGrain(pool), [&](size_t i, size_t e) {
+                    MATHLIB_DISPATCH(StreamCross, XPtr() + i, YPtr() + i, ZPtr() + i, b.XPtr() + i, b.YPtr() + i, b.ZPtr() + i,
+                                     out.XPtr() + i, out.YPtr() + i, out.ZPtr() + i, e - i);
+                });
+            }
+        }
+        // 取得模长(逐元素), 分块后在pool中并行计算
+        void Length(ThreadPool &pool, float32 *out) const
+        {
+            pool.For(0, count, ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamLength, XPtr() + i, YPtr() + i, ZPtr() + i, out + i, e - i);
+            });
+        }
+        // 归一化(逐元素), 分块后在pool中并行计算
+        template<class P = precision::Default>
+        Vector3Stream& SetNormalize(ThreadPool &pool)
+        {
+            pool.For(0, PaddedSize(), ParallelGrain(pool), [&](size_t i, size_t e) {
+                MATHLIB_DISPATCH(StreamNormalize, XPtr() + i, YPtr() + i, ZPtr() + i, e - i, P::Level);
+            });
+            return *this;
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 取得x分量数组
+        inline float32* XPtr() noexcept
+        {
+            return buff;
+        }
+        // 取得x分量数组
+        inline const float32* XPtr() const noexcept
+        {
+            return buff;
+        }
+        // 取得y分量数组
+        inline float32* YPtr() noexcept
+        {
+            return buff + capacity;
+        }
+        // 取得y分量数组
+        inline const float32* YPtr() const noexcept
+        {
+            return buff + capacity;
+        }
+        // 取得z分量数组
+        inline float32* ZPtr() noexcept
+        {
+            return buff + 2 * capacity;
+        }
+        // 取得z分量数组
+        inline const float32* ZPtr() const noexcept
+        {
+            return buff + 2 * capacity;
+        }
+    private:
+    #if defined(_MATHLIB_USE_PARALLEL)
+        // 并行计算时的分块大小, 每块的起点按Alignment对齐
+        size_t ParallelGrain(const ThreadPool &pool) const noexcept
+        {
+            return pool.Grain(PaddedSize(), ThreadPool::MinGrain, Alignment);
+        }
+    #endif // _MATHLIB_USE_PARALLEL
+        // 把[count, PaddedSize())范围内的填充元素重新置0
+        void ClearTail() noexcept
+        {
+            const size_t n = PaddedSize() - count;
+            if (n != 0)
+            {
+                memset(XPtr() + count, 0, n * sizeof(float32));
+                memset(YPtr() + count, 0, n * sizeof(float32));
+                memset(ZPtr() + count, 0, n * sizeof(float32));
+            }
+        }
+        // 分配64字节(缓存行)对齐的内存
+        static float32* AllocBuffer(size_t n) noexcept
+        {
+            return static_cast<float32*>(AlignedAlloc(n * sizeof(float32), 64));
+        }
+        // 释放AllocBuffer分配的内存
+        static void FreeBuffer(float32 *p) noexcept
+        {
+            AlignedFree(p);
+        }
+    private:
+        // 内存布局:
+        // | ---- capacity ---- | ---- capacity ---- | ---- capacity ---- |
+        // |    float32 x[]     |    float32 y[]     |    float32 z[]     |
+        // 每段起始地址都是64字节对齐, [count, capacity)范围内的元素始终为0
+        float32 *buff;
+        size_t   count;
+        size_t   capacity;
+        bool     owned;                                     // buff是否由AllocBuffer分配(否则在FrameArena中)
+    };
+}
@@ -38,41 +38,37 @@ namespace cirno
 
     using CompactVector4 = Vector4;
 
-    class Vector4
+    class alignas(16) Vector4
     {
     public:
-        Vector4() noexcept : x(0.0f), y(0.0f), z(0.0f), w(0.0f)
+        constexpr Vector4() noexcept : x(0.0f), y(0.0f), z(0.0f), w(0.0f)
         {
             // nothing to do...
         }
-        Vector4(float32 _v) noexcept : x(_v), y(_v), z(_v), w(_v)
+        constexpr Vector4(float32 _v) noexcept : x(_v), y(_v), z(_v), w(_v)
         {
             // nothing to do
         }
-        Vector4(float32 _x, float32 _y, float32 _z, float32 _w) noexcept : x(_x), y(_y), z(_z), w(_w)
+        constexpr Vector4(float32 _x, float32 _y, float32 _z, float32 _w) noexcept : x(_x), y(_y), z(_z), w(_w)
         {
             // nothing to do...
         }
-    #if defined(_MATHLIB_USE_SSE)
-        Vector4(__m128 _val) noexcept : val{ _val }
+        Vector4(f32x4::Reg _val) noexcept : val{ _val }
         {
             // nothing to do...
         }
-    #endif // _MATHLIB_USE_SSE
         ~Vector4() = default;
         Vector4(const Vector4 &) = default;
         Vector4& operator=(const Vector4 &) = default;
         // 取得模长的平方
         float32 GetNormL2Square() const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 tmp[4];
-            __m128 r = _mm_mul_ps(val, val);
-            _mm_store_ps(tmp, r);
-            return tmp[0] + tmp[1] + tmp[2] + tmp[3];
-        #else
-            return x * x + y * y + z * z;
-        #endif // _MATHLIB_USE_SSE
+            return f32x4::First(f32x4::Dot4(val, val));
+        }
+        // 取得模长的平方, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector4) GetNormL2SquareV() const noexcept
+        {
+            return Vector4(f32x4::Dot4(val, val));
         }
         // 取得L2范数模长
         inline float32 GetNormL2() const noexcept
@@ -84,114 +80,69 @@ namespace cirno
         {
             return GetNormL2();
         }
-        // 归一化
+        // 取得模长, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector4) LengthV() const noexcept
+        {
+            return Vector4(f32x4::Sqrt(f32x4::Dot4(val, val)));
+        }
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector4& SetNormalize() noexcept
         {
-            float32 s = Length();
-            if (s == 0.0f)                                  // 长度精确为0, 不进行计算
-            {
-                // nothing to do
-            }
-            else {
-            #if defined(_MATHLIB_USE_SSE)
-                __m128 t = _mm_load_ps1(&s);                // t[0 .. 3] = length
-                __m128 k = _mm_rcp_ps(t);                   // k = 1 / length
-                val = _mm_mul_ps(val, k);
-            #else
-                s = 1.0f / s;
-                x *= s;
-                y *= s;
-                z *= s;
-            #endif // _MATHLIB_USE_SSE
-            }
+            const f32x4::Reg s = f32x4::Dot4(val, val);         // s[0 .. 3] = length^2
+            const f32x4::Reg k = f32x4::RecipSqrt(s, P());      // k[0 .. 3] = 1 / length
+            val = f32x4::KeepNonZero(f32x4::Mul(val, k), s);    // 长度精确为0时结果为0
             return *this;
         }
-        // 归一化
+        // 归一化, P为精度策略(precision::Fast, Refined, Exact)
+        template<class P = precision::Default>
         Vector4 GetNormalize() const noexcept
         {
             Vector4 t(*this);
-            return t.SetNormalize();
+            return t.SetNormalize<P>();
         }
         // 点乘
         MATHLIB_CALL(float32) DotMul(const Vector4 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            float32 buff[4];
-            __m128 t = _mm_mul_ps(val, b.val);              // t[k] = val[k] * b.val[k]
-            _mm_store_ps(buff, t);
-            return buff[0] + buff[1] + buff[2] + buff[3];
-        #else
-            return x * b.x + y * b.y + z * b.z + w * b.w;
-        #endif // _MATHLIB_USE_SSE
+            return f32x4::First(f32x4::Dot4(val, b.val));
+        }
+        // 点乘, 结果广播到全部分量, 不离开寄存器
+        MATHLIB_CALL(Vector4) DotMulV(const Vector4 b) const noexcept
+        {
+            return Vector4(f32x4::Dot4(val, b.val));
         }
         // 四维向量加法
         MATHLIB_CALL(Vector4&) operator+=(const Vector4 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_add_ps(val, b.val);
-        #else
-            x += b.x;
-            y += b.y;
-            z += b.z;
-            w += b.w;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Add(val, b.val);
             return *this;
         }
         // 四维向量加法
         MATHLIB_CALL(Vector4) operator+(const Vector4 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector4(_mm_add_ps(val, b.val));
-        #else
-            return Vector4(x + b.x, y + b.y, z + b.z, w + b.w);
-        #endif // _MATHLIB_USE_SSE
+            return Vector4(f32x4::Add(val, b.val));
         }
         // 四维向量减法
         MATHLIB_CALL(Vector4&) operator-=(const Vector4 b) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            val = _mm_sub_ps(val, b.val);
-        #else
-            x -= b.x;
-            y -= b.y;
-            z -= b.z;
-            w -= b.w;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Sub(val, b.val);
             return *this;
         }
         // 四维向量减法
         MATHLIB_CALL(Vector4) operator-(const Vector4 b) const noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            return Vector4(_mm_sub_ps(val, b.val));
-        #else
-            return Vector4(x - b.x, y - b.y, z - b.z, w - b.w);
-        #endif // _MATHLIB_USE_SSE
+            return Vector4(f32x4::Sub(val, b.val));
         }
         // 四维向量数乘
         MATHLIB_CALL(Vector4&) operator*=(const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            val = _mm_mul_ps(val, t);
-        #else
-            x *= v;
-            y *= v;
-            z *= v;
-            w *= v;
-        #endif // _MATHLIB_USE_SSE
+            val = f32x4::Mul(val, f32x4::Splat(v));
             return *this;
         }
         // 空间向量数乘
         friend MATHLIB_CALL(Vector4) operator*(const Vector4 vec, const float32 v) noexcept
         {
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 t = _mm_load_ps1(&v);
-            __m128 r = _mm_mul_ps(vec.val, t);
-            return Vector4(r);
-        #else
-            return Vector4(vec.x * v, vec.y * v, vec.z * v, vec.w * v);
-        #endif // _MATHLIB_USE_SSE
+            return Vector4(f32x4::Mul(vec.val, f32x4::Splat(v)));
         }
         // 取反
         MATHLIB_CALL(Vector4) operator-() const noexcept
@@ -211,22 +162,22 @@ namespace cirno
             return buff[i];
         }
         // 取得X值
-        inline float32 X() const noexcept
+        inline constexpr float32 X() const noexcept
         {
             return x;
         }
         // 取得Y值
-        inline float32 Y() const noexcept
+        inline constexpr float32 Y() const noexcept
         {
             return y;
         }
         // 取得Z值
-        inline float32 Z() const noexcept
+        inline constexpr float32 Z() const noexcept
         {
             return z;
         }
         // 取得W值
-        inline float32 W() const noexcept
+        inline constexpr float32 W() const noexcept
         {
             return w;
         }
@@ -249,7 +200,7 @@ namespace cirno
         // 内存布局:
         // union
         // { | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- | ---- 32 ---- |
-        //   |                         __m128 val                        |
+        //   |                       f32x4::Reg val                      |
         //   |                        float32 buff[4]                    |
         //   |   float32 x  |   float32 y  |   float32 z  |   float32 w  |
         //   |   float32 a  |   float32 b  |   float32 c  |   float32 d  |
@@ -265,9 +216,7 @@ namespace cirno
                 float32 a, b, c, d;
             };
             float32 buff[4];
-        #if defined(_MATHLIB_USE_SSE)
-            __m128 val;
-        #endif // _MATHLIB_USE_SSE
+            f32x4::Reg val;
         };
     };
 }